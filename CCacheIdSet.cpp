@@ -0,0 +1,166 @@
+#include "CCacheIdSet.h"
+#include <algorithm>
+
+CCacheIdSet::CCacheIdSet()
+{
+	Clear();
+}
+
+// Empties the set
+void CCacheIdSet::Clear()
+{
+	m_Ids.assign(CACHE_ID_SET_MIN, 0);
+	m_States.assign(CACHE_ID_SET_MIN, CACHE_ID_FREE);
+
+	m_Count = 0;
+	m_Taken = 0;
+}
+
+// Returns the slot an id hashes to. The ids of the caches are mostly close numbers: multiplying them by a large odd
+// number spreads them over the table, and folding the upper bits of the product, the best mixed, into the lower ones
+// spreads them over the slots of a small table too.
+DWORD CCacheIdSet::Hash(long Id, long Slots)
+{
+	DWORD Product = (DWORD) Id * 2654435761UL;
+
+	return (Product ^ (Product >> 16)) & (Slots - 1);
+}
+
+// Returns the slot holding the id, or -1
+long CCacheIdSet::Find(long Id) const
+{
+	long	Slots = m_Ids.size();
+	DWORD	Slot = Hash(Id, Slots);
+
+	// There is always a free slot: the search ends
+	while (m_States[Slot] != CACHE_ID_FREE)
+	{
+		if (m_States[Slot] == CACHE_ID_USED && m_Ids[Slot] == Id)
+		{
+			return Slot;
+		}
+
+		Slot = (Slot + 1) & (Slots - 1);
+	}
+
+	return -1;
+}
+
+// Returns 'true' if the id is in the set
+bool CCacheIdSet::Contains(long Id) const
+{
+	return (Find(Id) != -1);
+}
+
+// Adds an id. Returns 'false' if it was already there.
+bool CCacheIdSet::Add(long Id)
+{
+	if (Find(Id) != -1)
+	{
+		return false;
+	}
+
+	// Keep the table at most half full, so that the runs of taken slots stay short
+	if ((m_Taken + 1) * 2 > (long) m_Ids.size())
+	{
+		long Slots = m_Ids.size();
+
+		// Removal markers only need to be dropped, ids need more room: leave the new table at most a quarter full
+		while ((m_Count + 1) * 2 > Slots / 2)
+		{
+			Slots *= 2;
+		}
+
+		Rehash(Slots);
+	}
+
+	long	Slots = m_Ids.size();
+	DWORD	Slot = Hash(Id, Slots);
+
+	while (m_States[Slot] == CACHE_ID_USED)
+	{
+		Slot = (Slot + 1) & (Slots - 1);
+	}
+
+	if (m_States[Slot] == CACHE_ID_FREE)
+	{
+		m_Taken++;
+	}
+
+	m_Ids[Slot] = Id;
+	m_States[Slot] = CACHE_ID_USED;
+
+	m_Count++;
+
+	return true;
+}
+
+// Removes an id. Returns 'false' if it wasn't there.
+bool CCacheIdSet::Remove(long Id)
+{
+	long Slot = Find(Id);
+
+	if (Slot == -1)
+	{
+		return false;
+	}
+
+	m_States[Slot] = CACHE_ID_REMOVED;
+
+	m_Count--;
+
+	return true;
+}
+
+// Returns the number of ids in the set
+long CCacheIdSet::Size() const
+{
+	return m_Count;
+}
+
+// Retrieves the ids of the set, in ascending order
+void CCacheIdSet::GetIds(vector<long>& Ids) const
+{
+	Ids.clear();
+	Ids.reserve(m_Count);
+
+	for (long Slot = 0; Slot < (long) m_Ids.size(); Slot++)
+	{
+		if (m_States[Slot] == CACHE_ID_USED)
+		{
+			Ids.push_back(m_Ids[Slot]);
+		}
+	}
+
+	sort(Ids.begin(), Ids.end());
+}
+
+// Moves the ids to a table of Slots slots, dropping the removal markers
+void CCacheIdSet::Rehash(long Slots)
+{
+	vector<long> Ids;
+
+	GetIds(Ids);
+
+	m_Ids.assign(Slots, 0);
+	m_States.assign(Slots, CACHE_ID_FREE);
+
+	m_Count = 0;
+	m_Taken = 0;
+
+	for (vector<long>::iterator it = Ids.begin(); it != Ids.end(); it++)
+	{
+		DWORD Slot = Hash(*it, Slots);
+
+		while (m_States[Slot] != CACHE_ID_FREE)
+		{
+			Slot = (Slot + 1) & (Slots - 1);
+		}
+
+		m_Ids[Slot] = *it;
+		m_States[Slot] = CACHE_ID_USED;
+
+		m_Count++;
+		m_Taken++;
+	}
+}
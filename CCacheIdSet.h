@@ -0,0 +1,64 @@
+#ifndef _INC_CCacheIdSet
+	#define _INC_CCacheIdSet
+
+#include "CommonDefs.h"
+#include <vector>
+
+using namespace std;
+
+// Set of cache ids, hashed with open addressing: an id sits in the slot its hash points to, or in the next free one
+// after it. Looking an id up, adding or removing one takes a few probes whatever the number of ids.
+// A removed id leaves a marker behind, so that the ids past it are still found; the markers are reused by the
+// next additions and dropped when the table grows. The table holds at most half as many ids and markers as slots;
+// when it fills up, it is rebuilt at most a quarter full, so that it doesn't need rebuilding again right away.
+class CCacheIdSet
+{
+	// Slots of an empty table, a power of 2
+	#define CACHE_ID_SET_MIN	64
+
+	// States of a slot
+	#define CACHE_ID_FREE		0
+	#define CACHE_ID_USED		1
+	#define CACHE_ID_REMOVED	2
+
+protected:
+	vector<long>	m_Ids;
+	vector<BYTE>	m_States;
+
+	// Ids in the table, and ids plus removal markers
+	long			m_Count;
+	long			m_Taken;
+
+public:
+	CCacheIdSet();
+
+	// Adds an id. Returns 'false' if it was already there.
+	bool	Add(long Id);
+
+	// Removes an id. Returns 'false' if it wasn't there.
+	bool	Remove(long Id);
+
+	// Returns 'true' if the id is in the set
+	bool	Contains(long Id) const;
+
+	// Returns the number of ids in the set
+	long	Size() const;
+
+	// Empties the set
+	void	Clear();
+
+	// Retrieves the ids of the set, in ascending order
+	void	GetIds(vector<long>& Ids) const;
+
+protected:
+	// Returns the slot holding the id, or -1
+	long	Find(long Id) const;
+
+	// Moves the ids to a table of Slots slots, dropping the removal markers
+	void	Rehash(long Slots);
+
+	// Returns the slot an id hashes to
+	static DWORD	Hash(long Id, long Slots);
+};
+
+#endif
@@ -1,5 +1,6 @@
 #include "StdAfx.h"
 #include "CCacheMgr.h"
+#include "CSchema.h"
 #include "CFieldNoteMgr.h"
 #include "Literals.h"
 #include "CPath.h"
@@ -12,32 +13,16 @@ CWaypoint::CWaypoint()
 	m_Long = 0;
 }
 
-#define CWaypointVersion	100
-
 void CWaypoint::Serialize(CStream& ar)
 {
-	if (ar.IsStoring())
-	{
-		ar << CWaypointVersion;
-		ar << m_Lat;
-		ar << m_Long;
-		ar << m_Name;
-		ar << m_Desc;
-	}
-	else
-	{
-		int Version;
+	CSchema Schema;
 
-		ar >> Version;
+	Schema.Add(m_Lat, 100);
+	Schema.Add(m_Long, 100);
+	Schema.Add(m_Name, 100);
+	Schema.Add(m_Desc, 100);
 
-		if (Version >= 100)
-		{
-			ar >> m_Lat;
-			ar >> m_Long;
-			ar >> m_Name;
-			ar >> m_Desc;
-		}
-	}
+	Schema.Serialize(ar);
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -158,6 +143,7 @@ CGeoCache* CCacheMgr::New(String& Owner)
 	pGc->m_GsCacheState = _T("State");
 	pGc->m_GsCacheDifficulty = 1.0;
 	pGc->m_GsCacheTerrain = 1.0;
+	pGc->SetCoords(0.0, 0.0);
 	pGc->m_GsCacheShortDesc = _T("Provide the short description here.");
 	pGc->m_GsCacheLongDesc = _T("Provide the long description here.");
 
@@ -379,6 +365,8 @@ void CCacheMgr::SaveConfig()
 
 	CStream	ar;
 
+	// The cache manager archive is the largest file saved, a CRC32 is plenty to detect corruption
+	ar.SetChecksum(CStream::ChecksumCrc32);
 	ar.SetStoring(true);
 
 	Serialize(ar);
@@ -9,6 +9,8 @@
 #include "windows.h"
 #include "CPath.h"
 #include "Literals.h"
+#include "CSpatialIndex.h"
+#include "CFilterBearingDistance.h"
 
 //-------------------------------------------------------------------------------------------------------------------------------------
 CHtmlSeg::CHtmlSeg(char* pHtmlSeg, CCachePageWriterHandler* pH)
@@ -1140,6 +1142,100 @@ string CSpoilerPicsWriter::OnWrite(CGpxParser& Parser, CGeoCache& Cache, CHtmlSe
 	return Out;
 }
 
+CNearbyWriter::CNearbyWriter()
+{
+	m_pIndex = 0;
+	m_pUnits = 0;
+	m_pCache = 0;
+}
+
+// Sets the index searched for nearby caches and the coordinates whose units are used to display the distances
+void CNearbyWriter::SetSpatialIndex(CSpatialIndex* pIndex, CCoords* pUnits)
+{
+	m_pIndex = pIndex;
+	m_pUnits = pUnits;
+
+	Reset();
+}
+
+// Forgets the neighbours found for the previous page: the index may have been rebuilt since
+void CNearbyWriter::Reset()
+{
+	m_pCache = 0;
+	m_Nearby.clear();
+	m_Distances.clear();
+	m_Azimuths.clear();
+}
+
+// Looks up the neighbours of the cache unless they are already known
+void CNearbyWriter::Query(CGeoCache& Cache)
+{
+	if (m_pCache == &Cache)
+	{
+		return;
+	}
+
+	m_pCache = &Cache;
+
+	if (!m_pIndex || !m_pUnits || m_pIndex->IsEmpty())
+	{
+		m_Nearby.clear();
+		m_Distances.clear();
+		m_Azimuths.clear();
+		return;
+	}
+
+	m_pIndex->NearbyCaches(&Cache, NEARBY_CACHES_COUNT, m_Nearby, m_Distances, m_Azimuths);
+}
+
+// Replaces every occurrence of a tag in a formatted segment
+void CNearbyWriter::ReplaceTag(string& Out, const char* pTag, const string& Value)
+{
+	long Size = strlen(pTag);
+
+	for (string::size_type I = Out.find(pTag); I != string::npos; I = Out.find(pTag, I + Value.size()))
+	{
+		Out.replace(I, Size, Value);
+	}
+}
+
+// The label segments are only written if the cache has neighbours, the others are written once per neighbour
+string CNearbyWriter::OnWrite(CGpxParser& Parser, CGeoCache& Cache, CHtmlSeg* pHtmlSeg)
+{
+	AW_CONVERSION;
+
+	string Out;
+
+	Query(Cache);
+
+	if (m_Nearby.empty())
+	{
+		return Out;
+	}
+
+	if (pHtmlSeg->m_HtmlSeg.find("###NEARBY_LABEL###") != string::npos)
+	{
+		return pHtmlSeg->Format(Parser, Cache);
+	}
+
+	char	Buffer[64];
+
+	for (long I = 0; I < m_Nearby.size(); I++)
+	{
+		// The cache related tags describe the neighbour
+		string Row = pHtmlSeg->Format(Parser, *m_Nearby[I]);
+
+		sprintf(Buffer, "%.02f %s", m_Distances[I] / m_pUnits->GetDistanceUnits(), m_pUnits->GetDistanceLabel());
+		ReplaceTag(Row, "###NEARBY_DISTANCE###", Buffer);
+
+		ReplaceTag(Row, "###NEARBY_BEARING###", w2a((TCHAR*) CFilterBearingDistance::BearingText(CFilterBearingDistance::BearingFromAzimuth(m_Azimuths[I]))));
+
+		Out += Row;
+	}
+
+	return Out;
+}
+
 string CReportWriter::OnWrite(CGpxParser& Parser, CGeoCache& Cache, CHtmlSeg* pHtmlSeg)
 {
 	string Out;
@@ -1236,6 +1332,11 @@ void CCachePageWriter::LoadTemplate(const TCHAR* pTplPath)
 					// Connect the segment with its processing code.
 					AddSeg(pSeg, &m_LogWriter);
 				}
+				else if (strstr(pSeg, "###NEARBY_LABEL###") || strstr(pSeg, "###NEARBY_DISTANCE###"))
+				{
+					// Connect the segment with its processing code.
+					AddSeg(pSeg, &m_NearbyWriter);
+				}
 				else if (strstr(pSeg, "###REPORT###"))
 				{
 					// Connect the segment with its processing code.
@@ -1277,6 +1378,8 @@ void CCachePageWriter::AddSeg(char* pHtmlSeg, CCachePageWriterHandler* pH)
 // Write the cache page out
 void CCachePageWriter::Write(CGpxParser& Parser, CGeoCache& Cache, TCHAR* pFilePath)
 {
+	m_NearbyWriter.Reset();
+
 	FILE* fd = _tfopen(pFilePath, _T("w"));
 
 	if (fd)
@@ -8,6 +8,8 @@ using namespace std;
 class CGpxParser;
 class CGeoCache;
 class CCachePageWriterHandler;
+class CSpatialIndex;
+class CCoords;
 
 typedef enum {
 	GcRatingDifficulty = 0,
@@ -137,6 +139,41 @@ public:
 	virtual string OnWrite(CGpxParser& Parser, CGeoCache& Cache, CHtmlSeg* pHtmlSeg);
 };
 
+// Writes out the caches nearest to the cache, along with their distance and bearing from it
+class CNearbyWriter : public CCachePageWriterHandler
+{
+	// Number of nearby caches listed on the page
+	#define NEARBY_CACHES_COUNT		5
+
+protected:
+	CSpatialIndex*		m_pIndex;
+	CCoords*			m_pUnits;
+
+	// Neighbours of the cache being written
+	CGeoCache*			m_pCache;
+	vector<CGeoCache*>	m_Nearby;
+	vector<double>		m_Distances;
+	vector<double>		m_Azimuths;
+
+public:
+	CNearbyWriter();
+
+	// Sets the index searched for nearby caches and the coordinates whose units are used to display the distances
+	void			SetSpatialIndex(CSpatialIndex* pIndex, CCoords* pUnits);
+
+	// Forgets the neighbours found for the previous page
+	void			Reset();
+
+	virtual string	OnWrite(CGpxParser& Parser, CGeoCache& Cache, CHtmlSeg* pHtmlSeg);
+
+protected:
+	// Looks up the neighbours of the cache unless they are already known
+	void			Query(CGeoCache& Cache);
+
+	// Replaces every occurrence of a tag in a formatted segment
+	static void		ReplaceTag(string& Out, const char* pTag, const string& Value);
+};
+
 class CReportWriter : public CCachePageWriterHandler
 {
 public:
@@ -166,6 +203,7 @@ private:
 
 public:
 	CSpoilerPicsWriter	m_SpoilerPicsWriter;
+	CNearbyWriter		m_NearbyWriter;
 
 public:
 	CCachePageWriter();
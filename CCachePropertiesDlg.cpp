@@ -261,6 +261,9 @@ void CCachePropertiesDlg::PropertyFunction(int Idx, Function Func, CString& Text
 			{
 				m_pGc->m_GsCacheContainer = (LPCTSTR) Dlg.m_Selection;
 
+				// Same fixup as for the type
+				m_pGc->m_GcContainer = GC_NotInitialized;
+
 				UpdateList();
 			}
 		}
@@ -356,7 +359,11 @@ void CCachePropertiesDlg::PropertyFunction(int Idx, Function Func, CString& Text
 						Dlg.m_LatDeg, Dlg.m_LatMinMmm, Dlg.m_LatChar,
 						Dlg.m_LongDeg, Dlg.m_LongMinMmm, Dlg.m_LongChar);
 
-				Coords.GetDecimal(m_pGc->m_Lat, m_pGc->m_Long);
+				double Lat, Long;
+
+				Coords.GetDecimal(Lat, Long);
+
+				m_pGc->SetCoords(Lat, Long);
 
 				UpdateList();
 			}
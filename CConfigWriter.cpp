@@ -0,0 +1,327 @@
+#include "CConfigWriter.h"
+#include "CBaseException.h"
+
+CConfigWriter::CConfigWriter()
+{
+	m_bExit = false;
+
+	InitializeCriticalSection(&m_Lock);
+
+	// Auto-reset: signaled when streams are posted
+	m_hWorkEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+
+	// Manual-reset: signaled while nothing is pending or being written
+	m_hIdleEvent = CreateEvent(NULL, TRUE, TRUE, NULL);
+
+	DWORD ThreadId = 0;
+
+	m_hThread = CreateThread(NULL, 0, ThreadProc, (LPVOID) this, 0, &ThreadId);
+
+	if (m_hThread == NULL)
+	{
+		CBaseException Up;
+
+		Up.m_szSrc = _T("CConfigWriter::CConfigWriter()");
+		Up.m_szMsg = _T("Failed to create the writer thread! Configuration files will be written synchronously.");
+		Up.Win32Error();
+		Up.Log();
+	}
+	else
+	{
+		// Stay out of the way of the UI
+		SetThreadPriority(m_hThread, THREAD_PRIORITY_BELOW_NORMAL);
+	}
+}
+
+CConfigWriter::~CConfigWriter()
+{
+	// Nothing posted can be lost on exit
+	Flush();
+
+	if (m_hThread)
+	{
+		EnterCriticalSection(&m_Lock);
+		m_bExit = true;
+		LeaveCriticalSection(&m_Lock);
+
+		SetEvent(m_hWorkEvent);
+
+		WaitForSingleObject(m_hThread, INFINITE);
+
+		CloseHandle(m_hThread);
+		m_hThread = NULL;
+	}
+
+	CloseHandle(m_hWorkEvent);
+	CloseHandle(m_hIdleEvent);
+
+	DeleteCriticalSection(&m_Lock);
+}
+
+// Hands a stream over to the writer thread. The writer owns and deletes the stream.
+// If a stream is already waiting to be written to the same file, it is discarded.
+// The file is replaced by deleting it then renaming the temporary file, which isn't atomic:
+// a crash in between leaves only the temporary file, so Recover() must run before the file is loaded.
+void CConfigWriter::Post(const String& szFilename, CStream* pStream)
+{
+	if (m_hThread == NULL)
+	{
+		Write(szFilename, pStream);
+		return;
+	}
+
+	EnterCriticalSection(&m_Lock);
+
+	itStream it = m_Pending.find(szFilename);
+
+	if (it != m_Pending.end())
+	{
+		// Coalesce: only the latest snapshot of a file is worth writing
+		delete (*it).second;
+		(*it).second = pStream;
+	}
+	else
+	{
+		m_Pending[szFilename] = pStream;
+	}
+
+	ResetEvent(m_hIdleEvent);
+
+	LeaveCriticalSection(&m_Lock);
+
+	SetEvent(m_hWorkEvent);
+}
+
+// Blocks until every stream posted so far is on disk
+void CConfigWriter::Flush()
+{
+	if (m_hThread)
+	{
+		WaitForSingleObject(m_hIdleEvent, INFINITE);
+	}
+}
+
+// Completes a replacement interrupted after the old file was deleted but before the new one was renamed.
+// Call before loading a file written by the writer.
+void CConfigWriter::Recover(const String& szFilename)
+{
+	String TmpFname = szFilename + CONFIG_WRITER_TMP_EXT;
+
+	if (GetFileAttributes(szFilename.c_str()) == -1 && GetFileAttributes(TmpFname.c_str()) != -1)
+	{
+		MoveFile(TmpFname.c_str(), szFilename.c_str());
+	}
+}
+
+// Thread entry point
+DWORD WINAPI CConfigWriter::ThreadProc(LPVOID pParam)
+{
+	((CConfigWriter*) pParam)->Run();
+
+	return 0;
+}
+
+// Writes the pending streams until the writer is told to exit
+void CConfigWriter::Run()
+{
+	while (true)
+	{
+		WaitForSingleObject(m_hWorkEvent, INFINITE);
+
+		while (true)
+		{
+			String		Fname;
+			CStream*	pStream = NULL;
+
+			EnterCriticalSection(&m_Lock);
+
+			if (m_Pending.empty())
+			{
+				// Everything posted is on disk
+				SetEvent(m_hIdleEvent);
+
+				bool bExit = m_bExit;
+
+				LeaveCriticalSection(&m_Lock);
+
+				if (bExit)
+				{
+					return;
+				}
+
+				break;
+			}
+
+			// Take ownership of the next stream. Posts made while it's being written queue up behind it.
+			itStream it = m_Pending.begin();
+
+			Fname = (*it).first;
+			pStream = (*it).second;
+
+			m_Pending.erase(it);
+
+			LeaveCriticalSection(&m_Lock);
+
+			Write(Fname, pStream);
+		}
+	}
+}
+
+// Saves a stream to a temporary file then replaces the target with it
+void CConfigWriter::Write(const String& szFilename, CStream* pStream)
+{
+	String TmpFname = szFilename + CONFIG_WRITER_TMP_EXT;
+
+	if (pStream->Save(TmpFname))
+	{
+		// MoveFile() doesn't replace an existing file
+		DeleteFile(szFilename.c_str());
+
+		if (!MoveFile(TmpFname.c_str(), szFilename.c_str()))
+		{
+			CBaseException Up;
+
+			Up.m_szSrc = _T("CConfigWriter::Write()");
+			Up.m_szMsg = _T("Failed to replace: ") + szFilename;
+			Up.Win32Error();
+			Up.Log();
+		}
+	}
+	else
+	{
+		// Leave the previous configuration alone
+		DeleteFile(TmpFname.c_str());
+	}
+
+	delete pStream;
+}
+
+#ifdef _DEBUG
+// Posts a burst of numbered streams while reading the file back between the posts.
+// Every read must find one whole stream, no older than the one found by the previous read.
+// The file can be missing between the delete and the rename of a replacement. A read holding the file
+// makes the replacement fail, which only drops that generation. Once flushed, the file must hold the last one.
+// Finally, a replacement cut short after the delete must be completed by Recover().
+long CConfigWriter::CheckSnapshots(const String& szFilename, long lGenerations)
+{
+	String	TmpFname = szFilename + CONFIG_WRITER_TMP_EXT;
+	long	lFailures = 0;
+	long	lLastSeen = 0;
+	long	lSeen;
+
+	DeleteFile(szFilename.c_str());
+	DeleteFile(TmpFname.c_str());
+
+	{
+		CConfigWriter Writer;
+
+		for (long lGeneration = 1; lGeneration <= lGenerations; lGeneration++)
+		{
+			lSeen = ReadSnapshot(szFilename);
+
+			if (lSeen < 0 || (lSeen && lSeen < lLastSeen))
+			{
+				lFailures++;
+			}
+			else if (lSeen)
+			{
+				lLastSeen = lSeen;
+			}
+
+			Writer.Post(szFilename, NewSnapshot(lGeneration));
+		}
+
+		Writer.Flush();
+
+		if (ReadSnapshot(szFilename) != lGenerations)
+		{
+			lFailures++;
+		}
+	}
+
+	// Leave the state of a crash after the delete
+	CStream* pStream = NewSnapshot(lGenerations + 1);
+
+	pStream->Save(TmpFname);
+	delete pStream;
+
+	DeleteFile(szFilename.c_str());
+
+	Recover(szFilename);
+
+	if (ReadSnapshot(szFilename) != lGenerations + 1)
+	{
+		lFailures++;
+	}
+
+	DeleteFile(szFilename.c_str());
+	DeleteFile(TmpFname.c_str());
+
+	return lFailures;
+}
+
+// Builds the stream of one generation for CheckSnapshots()
+CStream* CConfigWriter::NewSnapshot(long lGeneration)
+{
+	#define SNAPSHOT_CHECK_VALUES	2000
+
+	CStream* pStream = new CStream;
+
+	pStream->SetStoring(true);
+
+	*pStream << lGeneration;
+	*pStream << (long) SNAPSHOT_CHECK_VALUES;
+
+	for (long i = 0; i < SNAPSHOT_CHECK_VALUES; i++)
+	{
+		*pStream << lGeneration;
+	}
+
+	*pStream << lGeneration;
+
+	return pStream;
+}
+
+// Returns the generation found in the file, 0 if there is no file and -1 if it doesn't hold one whole stream
+long CConfigWriter::ReadSnapshot(const String& szFilename)
+{
+	if (GetFileAttributes(szFilename.c_str()) == -1)
+	{
+		return 0;
+	}
+
+	CStream	ar;
+	long	lGeneration = 0;
+	long	lCount = 0;
+	long	lValue = 0;
+
+	ar.Load(szFilename);
+
+	// Replaced while it was being opened
+	if (!ar.GetSize())
+	{
+		return 0;
+	}
+
+	ar >> lGeneration;
+	ar >> lCount;
+
+	if (lGeneration <= 0 || lCount != SNAPSHOT_CHECK_VALUES)
+	{
+		return -1;
+	}
+
+	// The values repeat the generation, followed by the generation once more
+	for (long i = 0; i <= lCount; i++)
+	{
+		ar >> lValue;
+
+		if (lValue != lGeneration)
+		{
+			return -1;
+		}
+	}
+
+	return lGeneration;
+}
+#endif
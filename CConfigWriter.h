@@ -0,0 +1,69 @@
+#ifndef _INC_CConfigWriter
+	#define _INC_CConfigWriter
+
+#include "CommonDefs.h"
+#include "CStream.h"
+
+// Writes configuration streams to disk on a background thread.
+// The caller serializes its state into a CStream, which is a frozen copy of the settings, and posts it.
+// The checksum of the stream and the file I/O are left to the writer thread.
+// Posting a newer stream for a file that hasn't been written yet replaces the older one, so a burst
+// of saves produces a single write. Each stream goes to a temporary file first which then replaces
+// the configuration file, so the file on disk is always one complete snapshot.
+class CConfigWriter
+{
+	#define CONFIG_WRITER_TMP_EXT	_T(".tmp")
+
+	typedef map<String, CStream*>			StreamCont;
+	typedef map<String, CStream*>::iterator	itStream;
+
+protected:
+	CRITICAL_SECTION	m_Lock;
+	StreamCont			m_Pending;
+	HANDLE				m_hThread;
+	HANDLE				m_hWorkEvent;
+	HANDLE				m_hIdleEvent;
+	bool				m_bExit;
+
+public:
+	CConfigWriter();
+	~CConfigWriter();
+
+	// Hands a stream over to the writer thread. The writer owns and deletes the stream.
+	// If a stream is already waiting to be written to the same file, it is discarded.
+	// The file is replaced by deleting it then renaming the temporary file, which isn't atomic:
+	// a crash in between leaves only the temporary file, so Recover() must run before the file is loaded.
+	void			Post(const String& szFilename, CStream* pStream);
+
+	// Blocks until every stream posted so far is on disk
+	void			Flush();
+
+	// Completes a replacement interrupted after the old file was deleted but before the new one was renamed.
+	// Call before loading a file written by the writer.
+	static void		Recover(const String& szFilename);
+
+#ifdef _DEBUG
+	// Posts a burst of numbered streams while reading the file back. Returns the number of reads that fail.
+	static long		CheckSnapshots(const String& szFilename, long lGenerations);
+#endif
+
+protected:
+	// Thread entry point
+	static DWORD WINAPI	ThreadProc(LPVOID pParam);
+
+	// Writes the pending streams until the writer is told to exit
+	void			Run();
+
+	// Saves a stream to a temporary file then replaces the target with it
+	void			Write(const String& szFilename, CStream* pStream);
+
+#ifdef _DEBUG
+	// Builds the stream of one generation for CheckSnapshots()
+	static CStream*	NewSnapshot(long lGeneration);
+
+	// Returns the generation found in the file, 0 if there is no file and -1 if it doesn't hold one whole stream
+	static long		ReadSnapshot(const String& szFilename);
+#endif
+};
+
+#endif
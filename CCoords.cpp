@@ -15,6 +15,21 @@ double CCoords::GetDistanceUnits() const
 	return m_DegDist;
 }
 
+// Returns the name of the distance units
+const char* CCoords::GetDistanceLabel()
+{
+	if (m_DegDist == DIST_UNITS_IN_KM)
+	{
+		return KILOMETERS;
+	}
+	else if (m_DegDist == DIST_UNITS_IN_NAUTICAL_MILES)
+	{
+		return NAUTICAL_MILES;
+	}
+
+	return STATUTE_MILES;
+}
+
 
 void CCoords::GetDegMinMmm(
 					int& LatDeg, float& LatMinMmm, String& LatChar, 
@@ -104,11 +104,13 @@ void CExportLocationDlg::OnExportOptions()
 
 	Dlg.m_ExportsNamesAsGpxName = (BOOL) m_pExpLocMgr->m_ExportsNamesAsGpxName;
 	Dlg.m_ExportMaxLimit = m_pExpLocMgr->m_ExportMaxLimit;
+	Dlg.m_ExportInRouteOrder = (BOOL) m_pExpLocMgr->m_ExportInRouteOrder;
 
 	Dlg.DoModal();
 
 	m_pExpLocMgr->m_ExportsNamesAsGpxName = (bool) Dlg.m_ExportsNamesAsGpxName;
 	m_pExpLocMgr->m_ExportMaxLimit = Dlg.m_ExportMaxLimit;
+	m_pExpLocMgr->m_ExportInRouteOrder = (bool) Dlg.m_ExportInRouteOrder;
 }
 
 void CExportLocationDlg::OnExport() 
@@ -123,8 +125,13 @@ void CExportLocationDlg::OnExport()
 		{
 			try
 			{
+				// Planning a route takes a few seconds
+				BeginWaitCursor();
+
 				m_pExpLocMgr->Export(pEL);
 
+				EndWaitCursor();
+
 				String	File;
 
 				File = m_pExpLocMgr->GetFilename((TCHAR*)pEL->m_Name.c_str());
@@ -144,6 +151,8 @@ void CExportLocationDlg::OnExport()
 			}
 			catch(...)
 			{
+				EndWaitCursor();
+
 				MessageBox(_T("An exception occured while exporting"), _T("Exception!"), MB_OK | MB_ICONWARNING);
 			}
 		}
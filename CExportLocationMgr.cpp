@@ -1,4 +1,5 @@
 #include "CExportLocationMgr.h"
+#include "CSchema.h"
 #include "Literals.h"
 #include "CPath.h"
 
@@ -13,34 +14,20 @@
 #include "CNavigonWriter.h"
 
 #include "CGpxParser.h"
+#include "CRoutePlanner.h"
 #include "CFieldNoteMgr.h"
 #include "CBrowserLauncher.h"
 
 //------------------------------------------------------------------------------------
 void CExportLoc::Serialize(CStream& ar)
 {
-	#define CExportLocVersion 100
+	CSchema Schema;
 
-	if (ar.IsStoring())
-	{
-		ar << CExportLocVersion;
-		ar << m_Name;
-		ar << m_FullPath;
-		ar << m_UnUsed;
-	}
-	else
-	{
-		int Version;
-
-		ar >> Version;
+	Schema.Add(m_Name, 100);
+	Schema.Add(m_FullPath, 100);
+	Schema.Add(m_UnUsed, 100);
 
-		if (Version >= 100)
-		{
-			ar >> m_Name;
-			ar >> m_FullPath;
-			ar >> m_UnUsed;
-		}
-	}
+	Schema.Serialize(ar);
 }
 
 //------------------------------------------------------------------------------------
@@ -49,6 +36,7 @@ CExportLocationMgr::CExportLocationMgr()
 	m_pFieldNoteMgr = 0;
 	m_ExportsNamesAsGpxName = false;
 	m_ExportMaxLimit = 500;
+	m_ExportInRouteOrder = false;
 	m_Count = 0;
 	m_Limited = false;
 	m_pGpxParser = 0;
@@ -139,7 +127,7 @@ String CExportLocationMgr::ProcessFilename(CExportLoc* pEL)
 
 void CExportLocationMgr::Serialize(CStream& ar)
 {
-	#define CExportLocationMgrVersion	102
+	#define CExportLocationMgrVersion	103
 
 	if (ar.IsStoring())
 	{
@@ -154,6 +142,7 @@ void CExportLocationMgr::Serialize(CStream& ar)
 
 		ar << m_ExportsNamesAsGpxName;
 		ar << m_ExportMaxLimit;
+		ar << m_ExportInRouteOrder;
 	}
 	else
 	{
@@ -189,6 +178,11 @@ void CExportLocationMgr::Serialize(CStream& ar)
 			ar >> m_ExportMaxLimit;
 		}
 
+		if (Version >= 103)
+		{
+			ar >> m_ExportInRouteOrder;
+		}
+
 		AddDefaultLocationsByType();
 	}
 }
@@ -238,6 +232,85 @@ void CExportLocationMgr::Reset()
 }
 
 void CExportLocationMgr::Export(CExportLoc* pEL)
+{
+	if (!pEL)
+	{
+		return;
+	}
+
+	// Field notes are not concerned by the order of the caches
+	if (!m_ExportInRouteOrder || pEL->m_Name == GSAK_EXPORT)
+	{
+		ExportByType(pEL);
+		return;
+	}
+
+	GCCont	Route;
+
+	PlanRoute(Route);
+
+	// The export functions walk the route instead of the cache list
+	GCCont* pCaches = m_pGpxParser->SetCacheContainer(&Route);
+
+	try
+	{
+		ExportByType(pEL);
+	}
+	catch(...)
+	{
+		m_pGpxParser->SetCacheContainer(pCaches);
+		throw;
+	}
+
+	m_pGpxParser->SetCacheContainer(pCaches);
+}
+
+// Orders the caches in scope into a short route starting with the one closest to the center
+void CExportLocationMgr::PlanRoute(GCCont& Route)
+{
+	itGC	it;
+	bool	Known = true;
+
+	CGeoCache* pCache = m_pGpxParser->First(it);
+
+	while (!m_pGpxParser->EndOfCacheList(it))
+	{
+		if (pCache->m_InScope)
+		{
+			Route.push_back(pCache);
+
+			// My Caches have no distance from the center
+			if (pCache->m_DistanceState == GD_None)
+			{
+				Known = false;
+			}
+		}
+
+		pCache = m_pGpxParser->Next(it);
+	}
+
+	// When the export is limited, keep the caches closest to the center. Without distances, keep the list order.
+	if (Known)
+	{
+		GCCont* pCaches = m_pGpxParser->SetCacheContainer(&Route);
+
+		m_pGpxParser->SortByDistance();
+
+		m_pGpxParser->SetCacheContainer(pCaches);
+	}
+
+	if (Route.size() > (UINT) m_ExportMaxLimit)
+	{
+		Route.resize(m_ExportMaxLimit);
+	}
+
+	CRoutePlanner	Planner;
+
+	Planner.Plan(Route);
+}
+
+// Calls the export function matching the location
+void CExportLocationMgr::ExportByType(CExportLoc* pEL)
 {
 	if (pEL)
 	{
@@ -22,6 +22,7 @@ typedef vector<CExportLoc*> ExportLocations;
 typedef vector<CExportLoc*>::iterator itExportLoc;
 
 class CGpxParser;
+class CGeoCache;
 class CFieldNoteMgr;
 
 class CExportLocationMgr
@@ -38,6 +39,7 @@ public:
 	ExportLocations		m_ExpLocs;
 	bool				m_ExportsNamesAsGpxName;
 	int					m_ExportMaxLimit;
+	bool				m_ExportInRouteOrder;
 
 public:
 	CExportLocationMgr();
@@ -67,6 +69,13 @@ protected:
 	void		AddLocation(TCHAR* Name, wstring& Path, TCHAR* Filename);
 	void		Reset();
 
+	// Calls the export function matching the location
+	void		ExportByType(CExportLoc* pEL);
+
+	// Orders the caches in scope into a short route starting with the one closest to the center.
+	// Caches without a distance (My Caches) keep the list order, and the route starts with the first one.
+	void		PlanRoute(vector<CGeoCache*>& Route);
+
 	void		ShowExportMsg(bool Limited, long Count, String& File);
 	void		CommonMagellanExports(CExportLoc* pEL);
 
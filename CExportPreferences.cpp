@@ -13,6 +13,7 @@ CExportPreferences::CExportPreferences(CWnd* pParent): CNonFSDialog(CExportPrefe
 	//{{AFX_DATA_INIT(CExportPreferences)
 	m_ExportsNamesAsGpxName = FALSE;
 	m_ExportMaxLimit = 0;
+	m_ExportInRouteOrder = FALSE;
 	//}}AFX_DATA_INIT
 }
 
@@ -23,6 +24,7 @@ void CExportPreferences::DoDataExchange(CDataExchange* pDX)
 	DDX_Check(pDX, IDC_EXPORT_NAME, m_ExportsNamesAsGpxName);
 	DDX_Text(pDX, IDC_ExportMaxLimit, m_ExportMaxLimit);
 	DDV_MinMaxUInt(pDX, m_ExportMaxLimit, 1, 999);
+	DDX_Check(pDX, IDC_ROUTE_ORDER, m_ExportInRouteOrder);
 	//}}AFX_DATA_MAP
 }
 
@@ -18,6 +18,7 @@ public:
 	enum { IDD = IDD_EXPORT_PREFS };
 	BOOL	m_ExportsNamesAsGpxName;
 	UINT	m_ExportMaxLimit;
+	BOOL	m_ExportInRouteOrder;
 	//}}AFX_DATA
 
 
@@ -1,4 +1,5 @@
 #include "CFieldNoteMgr.h"
+#include "CSchema.h"
 #include "Literals.h"
 #include "CPath.h"
 #include "CTimeHelper.h"
@@ -25,41 +26,18 @@ CFieldNote::CFieldNote(const TCHAR* pNotes, GcNoteStatus Status)
 
 void CFieldNote::Serialize(CStream& ar)
 {
-	#define CFieldNoteVersion	101
+	int		Status = m_Status;
+	CSchema	Schema;
 
-	if (ar.IsStoring())
-	{
-		ar << CFieldNoteVersion;
-		ar << m_Notes;
-		ar << m_Status;
-		ar << m_Lat;
-		ar << m_Long;
-		ar << m_Date;
-
-	}
-	else
-	{
-		int Version = 0;
-
-		ar >> Version;
+	Schema.Add(m_Notes, 100);
+	Schema.Add(Status, 100);
+	Schema.Add(m_Lat, 100);
+	Schema.Add(m_Long, 100);
+	Schema.Add(m_Date, 101);
 
-		if (Version >= 100)
-		{
-			int Status;
-
-			ar >> m_Notes;
-			ar >> Status;
-			ar >> m_Lat;
-			ar >> m_Long;
-
-			m_Status = (GcNoteStatus) Status;
-		}
+	Schema.Serialize(ar);
 
-		if (Version >= 101)
-		{
-			ar >> m_Date;
-		}
-	}
+	m_Status = (GcNoteStatus) Status;
 }
 
 const TCHAR* CFieldNote::GetStatusText()
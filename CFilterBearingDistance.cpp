@@ -1,4 +1,5 @@
 #include "CFilterBearingDistance.h"
+#include "CSchema.h"
 #include "CGpxParser.h"
 
 //------------------------------------------------------------------------------------------------------------------------
@@ -16,26 +17,12 @@ CFilterBearing::CFilterBearing(const TCHAR* pBearing, bool Enabled)
 
 void CFilterBearing::Serialize(CStream& ar)
 {
-	#define CFilterBearingVersion	100
+	CSchema Schema;
 
-	if (ar.IsStoring())
-	{
-		ar << CFilterBearingVersion;
-		ar << m_Enabled;
-		ar << m_Bearing;
-	}
-	else
-	{
-		int Version;
-
-		ar >> Version;
+	Schema.Add(m_Enabled, 100);
+	Schema.Add(m_Bearing, 100);
 
-		if (Version >= 100)
-		{
-			ar >> m_Enabled;
-			ar >> m_Bearing;
-		}
-	}
+	Schema.Serialize(ar);
 }
 
 //------------------------------------------------------------------------------------------------------------------------
@@ -51,6 +38,8 @@ CFilterBearingDistance::CFilterBearingDistance(const TCHAR* pText, GcFilter Filt
 	m_Bearings.push_back(new CFilterBearing(BEARING_SOUTHWEST, true));
 	m_Bearings.push_back(new CFilterBearing(BEARING_WEST, true));
 	m_Bearings.push_back(new CFilterBearing(BEARING_NORTHWEST, true));
+
+	UpdateBearingMask();
 }
 
 CFilterBearingDistance::~CFilterBearingDistance()
@@ -58,7 +47,7 @@ CFilterBearingDistance::~CFilterBearingDistance()
 	Reset();
 }
 
-bool CFilterBearingDistance::OnFilterCache(CGeoCache* pCache)
+bool CFilterBearingDistance::OnFilterCache(CGeoCache* pCache) const
 {
 	// Is the cache too far?
 	if (pCache->m_Distance > m_Distance)
@@ -66,19 +55,29 @@ bool CFilterBearingDistance::OnFilterCache(CGeoCache* pCache)
 		return false;
 	}
 
-	for (itFiltBearing it = m_Bearings.begin(); it != m_Bearings.end(); it++)
+	// Is this one of the bearings that we're not interested in? An unknown bearing has no bit in the mask.
+	if (m_DisabledBearings & (1 << pCache->m_Bearing))
 	{
-		// Is this one of the bearings that we're not interested in?
-		if (pCache->m_Bearing == (*it)->m_Bearing && !(*it)->m_Enabled)
-		{
-			return false;
-		}
+		return false;
 	}
 
 	// Distance and bearing are OK
 	return true;
 }
 
+// Folds the distance and the bearings filtered out into the compiled test
+bool CFilterBearingDistance::Compile(CFilterPredicate& Predicate)
+{
+	if (m_Distance < Predicate.m_MaxDistance)
+	{
+		Predicate.m_MaxDistance = m_Distance;
+	}
+
+	Predicate.m_RejectedBearings |= m_DisabledBearings;
+
+	return true;
+}
+
 void CFilterBearingDistance::Serialize(CStream& ar)
 {
 	#define CFilterBearingDistanceVersion	100
@@ -123,6 +122,99 @@ void CFilterBearingDistance::Serialize(CStream& ar)
 				m_Bearings.push_back(pFilt);
 			}
 		}
+
+		UpdateBearingMask();
+	}
+}
+
+// Point of the compass of each 2 degrees sector of azimuth, starting from the north.
+// The sectors are 46 degrees wide, except the north-west one, and the north one is centered on 1 degree.
+static const BYTE BearingSectors[] =
+{
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0,	// 0 - 20
+	0, 0, 1, 1, 1, 1, 1, 1, 1, 1,	// 20 - 40
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1,	// 40 - 60
+	1, 1, 1, 1, 1, 2, 2, 2, 2, 2,	// 60 - 80
+	2, 2, 2, 2, 2, 2, 2, 2, 2, 2,	// 80 - 100
+	2, 2, 2, 2, 2, 2, 2, 2, 3, 3,	// 100 - 120
+	3, 3, 3, 3, 3, 3, 3, 3, 3, 3,	// 120 - 140
+	3, 3, 3, 3, 3, 3, 3, 3, 3, 3,	// 140 - 160
+	3, 4, 4, 4, 4, 4, 4, 4, 4, 4,	// 160 - 180
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4,	// 180 - 200
+	4, 4, 4, 4, 5, 5, 5, 5, 5, 5,	// 200 - 220
+	5, 5, 5, 5, 5, 5, 5, 5, 5, 5,	// 220 - 240
+	5, 5, 5, 5, 5, 5, 5, 6, 6, 6,	// 240 - 260
+	6, 6, 6, 6, 6, 6, 6, 6, 6, 6,	// 260 - 280
+	6, 6, 6, 6, 6, 6, 6, 6, 6, 6,	// 280 - 300
+	7, 7, 7, 7, 7, 7, 7, 7, 7, 7,	// 300 - 320
+	7, 7, 7, 7, 7, 7, 7, 7, 7, 0,	// 320 - 340
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0 	// 340 - 360
+};
+
+// Text of the points of the compass, indexed by GcBearing
+static const TCHAR* BearingTexts[] =
+{
+	BEARING_NORTH,
+	BEARING_NORTHEAST,
+	BEARING_EAST,
+	BEARING_SOUTHEAST,
+	BEARING_SOUTH,
+	BEARING_SOUTHWEST,
+	BEARING_WEST,
+	BEARING_NORTHWEST,
+	_T("?")
+};
+
+// Returns the point of the compass matching an azimuth in degrees
+GcBearing CFilterBearingDistance::BearingFromAzimuth(double Azimuth)
+{
+	// Also rejects NaN
+	if (!(Azimuth >= 0.0 && Azimuth <= 360.0))
+	{
+		return GB_Unknown;
+	}
+
+	return (GcBearing) BearingSectors[((long) (Azimuth / 2.0)) % (sizeof(BearingSectors) / sizeof(BearingSectors[0]))];
+}
+
+// Returns the text of a point of the compass ('?' if unknown)
+const TCHAR* CFilterBearingDistance::BearingText(GcBearing Bearing)
+{
+	if (Bearing < GB_North || Bearing > GB_Unknown)
+	{
+		Bearing = GB_Unknown;
+	}
+
+	return BearingTexts[Bearing];
+}
+
+// Returns the point of the compass matching a text, GB_Unknown if none does
+GcBearing CFilterBearingDistance::BearingFromText(const String& Text)
+{
+	for (int Bearing = GB_North; Bearing < GB_Unknown; Bearing++)
+	{
+		if (Text == BearingTexts[Bearing])
+		{
+			return (GcBearing) Bearing;
+		}
+	}
+
+	return GB_Unknown;
+}
+
+// Must be called after changing the 'm_Enabled' state of the bearings
+void CFilterBearingDistance::UpdateBearingMask()
+{
+	m_DisabledBearings = 0;
+
+	for (itFiltBearing it = m_Bearings.begin(); it != m_Bearings.end(); it++)
+	{
+		GcBearing Bearing = BearingFromText((*it)->m_Bearing);
+
+		if (Bearing != GB_Unknown && !(*it)->m_Enabled)
+		{
+			m_DisabledBearings |= (1 << Bearing);
+		}
 	}
 }
 
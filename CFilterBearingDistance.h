@@ -3,6 +3,7 @@
 
 #include "CommonDefs.h"
 #include "CFilterMgr.h"
+#include "CGpxParser.h"
 #include <vector>
 
 #define BEARING_NORTH		_T("N")
@@ -47,14 +48,31 @@ public:
 	double			m_Distance;
 	FiltBearingCont	m_Bearings;
 
+protected:
+	// One bit per GcBearing, set when the bearing is filtered out
+	BYTE			m_DisabledBearings;
+
 public:
 	CFilterBearingDistance(const TCHAR* pText, GcFilter FilterType);
 	virtual ~CFilterBearingDistance();
 
-	virtual bool OnFilterCache(CGeoCache* pCache);
+	virtual bool OnFilterCache(CGeoCache* pCache) const;
+	virtual bool Compile(CFilterPredicate& Predicate);
 
 	virtual void Serialize(CStream& ar);
 
+	// Must be called after changing the 'm_Enabled' state of the bearings
+	void	UpdateBearingMask();
+
+	// Returns the point of the compass matching an azimuth in degrees
+	static GcBearing	BearingFromAzimuth(double Azimuth);
+
+	// Returns the text of a point of the compass ('?' if unknown)
+	static const TCHAR*	BearingText(GcBearing Bearing);
+
+	// Returns the point of the compass matching a text, GB_Unknown if none does
+	static GcBearing	BearingFromText(const String& Text);
+
 protected:
 	void	Reset();
 };
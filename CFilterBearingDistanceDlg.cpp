@@ -103,5 +103,7 @@ void CFilterBearingDistanceDlg::OnCancel()
 
 	}
 
+	m_pBearDist->UpdateBearingMask();
+
 	CNonFSDialog::OnCancel();
 }
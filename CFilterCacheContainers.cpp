@@ -1,4 +1,5 @@
 #include "CFilterCacheContainers.h"
+#include "CSchema.h"
 
 //------------------------------------------------------------------------------------------------------------------------
 
@@ -16,29 +17,15 @@ CFiltContainerTypes::CFiltContainerTypes(GcContainer Cont, bool Enabled)
 
 void CFiltContainerTypes::Serialize(CStream& ar)
 {
-	#define CFiltContainerTypesVersion	100
+	int		Container = m_Container;
+	CSchema	Schema;
 
-	if (ar.IsStoring())
-	{
-		ar << CFiltContainerTypesVersion;
-		ar << m_Container;
-		ar << m_Enabled;
-	}
-	else
-	{
-		int Version;
+	Schema.Add(Container, 100);
+	Schema.Add(m_Enabled, 100);
 
-		ar >> Version;
-
-		if (Version >= 100)
-		{
-			int Cont;
-			ar >> Cont;
-			m_Container = (GcContainer) Cont;
+	Schema.Serialize(ar);
 
-			ar >> m_Enabled;
-		}
-	}
+	m_Container = (GcContainer) Container;
 }
 
 //------------------------------------------------------------------------------------------------------------------------
@@ -59,11 +46,11 @@ CFilterCacheContainers::~CFilterCacheContainers()
 	Reset();
 }
 
-bool CFilterCacheContainers::OnFilterCache(CGeoCache* pCache)
+bool CFilterCacheContainers::OnFilterCache(CGeoCache* pCache) const
 {
 	GcContainer	CacheContainer = pCache->ContainerLookup();
 
-	for (itFiltCacheContainer it = m_Conts.begin(); it != m_Conts.end(); it++)
+	for (citFiltCacheContainer it = m_Conts.begin(); it != m_Conts.end(); it++)
 	{
 		// Is this a container that we don't want to see?
 		if ((CacheContainer == (*it)->m_Container) && !(*it)->m_Enabled)
@@ -77,6 +64,20 @@ bool CFilterCacheContainers::OnFilterCache(CGeoCache* pCache)
 	return true;
 }
 
+// Folds the containers filtered out into the compiled test
+bool CFilterCacheContainers::Compile(CFilterPredicate& Predicate)
+{
+	for (itFiltCacheContainer it = m_Conts.begin(); it != m_Conts.end(); it++)
+	{
+		if (!(*it)->m_Enabled && (*it)->m_Container != GC_NotInitialized)
+		{
+			Predicate.m_RejectedContainers |= 1 << (*it)->m_Container;
+		}
+	}
+
+	return true;
+}
+
 void CFilterCacheContainers::Serialize(CStream& ar)
 {
 	#define	CFilterCacheContainersVersion 101
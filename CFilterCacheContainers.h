@@ -23,6 +23,7 @@ public:
 
 typedef vector<CFiltContainerTypes*>			FiltCacheContainerCont;
 typedef vector<CFiltContainerTypes*>::iterator	itFiltCacheContainer;
+typedef vector<CFiltContainerTypes*>::const_iterator	citFiltCacheContainer;
 
 class CFilterCacheContainers : public CFilterBase
 {
@@ -33,7 +34,8 @@ public:
 	CFilterCacheContainers(const TCHAR* pText, GcFilter FilterType);
 	virtual ~CFilterCacheContainers();
 
-	virtual bool OnFilterCache(CGeoCache* pCache);
+	virtual bool OnFilterCache(CGeoCache* pCache) const;
+	virtual bool Compile(CFilterPredicate& Predicate);
 	virtual void Serialize(CStream& ar);
 
 protected:
@@ -16,7 +16,7 @@ CFilterCacheLists::CFilterCacheLists(const TCHAR* pText, GcFilter FilterType) :
 
 CFilterCacheLists::~CFilterCacheLists()
 {
-	m_CacheIds.clear();
+	m_CacheIds.Clear();
 }
 
 void CFilterCacheLists::Ignore(CGeoCache* pCache)
@@ -25,10 +25,7 @@ void CFilterCacheLists::Ignore(CGeoCache* pCache)
 	pCache->m_Ignored = true;
 
 	// Add its cache Id to the list of ignored caches
-	if (!Find(pCache->m_GsCacheId))
-	{
-		m_CacheIds.push_back(pCache->m_GsCacheId);
-	}
+	m_CacheIds.Add(pCache->m_GsCacheId);
 
 	// run the cache through the filter to determine if it's in scope according to the user settings
 	pCache->m_InScope = OnFilterCache(pCache);
@@ -38,32 +35,41 @@ void CFilterCacheLists::UnIgnore(CGeoCache* pCache)
 {
 	pCache->m_Ignored = false;
 
-	for (itCacheId it = m_CacheIds.begin(); it != m_CacheIds.end(); it++)
-	{
-		if ((*it) == pCache->m_GsCacheId)
-		{
-			m_CacheIds.erase(it);
-			break;
-		}
-	}
+	m_CacheIds.Remove(pCache->m_GsCacheId);
 
 	pCache->m_InScope = OnFilterCache(pCache);
 }
 
 bool CFilterCacheLists::Find(long Id)
 {
-	for (itCacheId it = m_CacheIds.begin(); it != m_CacheIds.end(); it++)
+	return m_CacheIds.Contains(Id);
+}
+
+// Flags the loaded caches whose ids are ignored
+void CFilterCacheLists::Reconnect(CGpxParser& Parser)
+{
+	// Nothing ignored: no cache to look up
+	if (!m_CacheIds.Size())
+	{
+		return;
+	}
+
+	itGC C;
+
+	CGeoCache* pCache = Parser.First(C);
+
+	while (!Parser.EndOfCacheList(C))
 	{
-		if ((*it) == Id)
+		if (m_CacheIds.Contains(pCache->m_GsCacheId))
 		{
-			return true;
+			pCache->m_Ignored = true;
 		}
-	}
 
-	return false;
+		pCache = Parser.Next(C);
+	}
 }
 
-bool CFilterCacheLists::OnFilterCache(CGeoCache* pCache)
+bool CFilterCacheLists::OnFilterCache(CGeoCache* pCache) const
 {
 	if (m_UseShowOnly)
 	{
@@ -126,6 +132,34 @@ bool CFilterCacheLists::OnFilterCache(CGeoCache* pCache)
 	return true;
 }
 
+// Folds the list options into the compiled test as masks over the flags of the caches
+bool CFilterCacheLists::Compile(CFilterPredicate& Predicate)
+{
+	if (m_UseShowOnly)
+	{
+		Predicate.m_RequiredFlags |= (m_ExclusiveOptions == ShowFoundCachesOnly) ? CA_FOUND : CA_FIELDNOTE;
+	}
+	else
+	{
+		if (!m_ShowIgnoredCaches)
+		{
+			Predicate.m_RejectedFlags |= CA_IGNORED;
+		}
+
+		if (m_HideFoundCaches)
+		{
+			Predicate.m_RejectedFlags |= CA_FOUND;
+		}
+
+		if (m_HideDisabledCaches)
+		{
+			Predicate.m_RejectedFlags |= CA_UNAVAILABLE;
+		}
+	}
+
+	return true;
+}
+
 void CFilterCacheLists::Serialize(CStream& ar)
 {
 	#define	CFilterCacheListsVersion 101
@@ -141,9 +175,13 @@ void CFilterCacheLists::Serialize(CStream& ar)
 		ar << m_UseShowOnly;
 		ar << m_ExclusiveOptions;
 
-		ar << m_CacheIds.size();
+		CacheIdCont Ids;
+
+		m_CacheIds.GetIds(Ids);
+
+		ar << (long) Ids.size();
 
-		for (itCacheId it = m_CacheIds.begin(); it != m_CacheIds.end(); it++)
+		for (itCacheId it = Ids.begin(); it != Ids.end(); it++)
 		{
 			ar << (*it);
 		}
@@ -152,7 +190,7 @@ void CFilterCacheLists::Serialize(CStream& ar)
 	}
 	else
 	{
-		m_CacheIds.clear();
+		m_CacheIds.Clear();
 
 		int Version;
 
@@ -175,7 +213,7 @@ void CFilterCacheLists::Serialize(CStream& ar)
 
 				ar >> Id;
 
-				m_CacheIds.push_back(Id);
+				m_CacheIds.Add(Id);
 			}
 		}
 
@@ -3,6 +3,7 @@
 
 #include "CommonDefs.h"
 #include "CFilterMgr.h"
+#include "CCacheIdSet.h"
 
 using namespace std;
 
@@ -14,6 +15,11 @@ typedef enum {
 	ShowCachesWithNotesOnly
 } GcExclusiveShowOpts;
 
+class CGpxParser;
+
+// Options of the lists of caches, and the ids of the ignored caches. The caches of the loaded file carry their
+// own 'ignored' flag (see CGeoCache::m_Ignored), which the filter tests: the ids are only looked up when a
+// file is loaded, to set the flags, and kept in a hashed set so that this takes one pass over the caches.
 class CFilterCacheLists : public CFilterBase
 {
 public:
@@ -24,7 +30,7 @@ public:
 	int			m_ExclusiveOptions;
 
 	// List of cache IDs to be ignored
-	CacheIdCont	m_CacheIds;
+	CCacheIdSet	m_CacheIds;
 
 public:
 	CFilterCacheLists(const TCHAR* pText, GcFilter FilterType);
@@ -35,7 +41,11 @@ public:
 
 	bool			Find(long Id);
 
-	virtual bool	OnFilterCache(CGeoCache* pCache);
+	// Flags the loaded caches whose ids are ignored
+	void			Reconnect(CGpxParser& Parser);
+
+	virtual bool	OnFilterCache(CGeoCache* pCache) const;
+	virtual bool	Compile(CFilterPredicate& Predicate);
 
 	virtual void	Serialize(CStream& ar);
 };
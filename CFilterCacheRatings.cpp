@@ -1,5 +1,6 @@
 #include "CFilterCacheRatings.h"
 #include "CGpxParser.h"
+#include <float.h>
 
 CFilterCacheRatings::CFilterCacheRatings(const TCHAR* pText, GcFilter FilterType) : CFilterBase(pText, FilterType)
 {
@@ -15,7 +16,7 @@ CFilterCacheRatings::~CFilterCacheRatings()
 {
 }
 
-bool CFilterCacheRatings::OnFilterCache(CGeoCache* pCache)
+bool CFilterCacheRatings::OnFilterCache(CGeoCache* pCache) const
 {
 	bool DiffRc = false;
 
@@ -98,6 +99,42 @@ bool CFilterCacheRatings::OnFilterCache(CGeoCache* pCache)
 	return true;
 }
 
+// Folds the ratings into the compiled test as ranges
+bool CFilterCacheRatings::Compile(CFilterPredicate& Predicate)
+{
+	if (m_DiffEnabled)
+	{
+		Predicate.m_TestDifficulty = true;
+
+		OperRange(m_DiffOper, m_DiffLvl, Predicate.m_MinDifficulty, Predicate.m_MaxDifficulty);
+	}
+
+	if (m_TerrEnabled)
+	{
+		Predicate.m_TestTerrain = true;
+
+		OperRange(m_TerrOper, m_TerrLvl, Predicate.m_MinTerrain, Predicate.m_MaxTerrain);
+	}
+
+	return true;
+}
+
+// Returns the range of the ratings passing a comparison with a level
+void CFilterCacheRatings::OperRange(OperType Oper, double Level, float& Min, float& Max)
+{
+	Min = (float) Level;
+	Max = (float) Level;
+
+	if (Oper == OperGreaterEqual)
+	{
+		Max = FLT_MAX;
+	}
+	else if (Oper == OperLessEqual)
+	{
+		Min = -FLT_MAX;
+	}
+}
+
 void CFilterCacheRatings::Serialize(CStream& ar)
 {
 	#define CFilterCacheRatingsVersion	100
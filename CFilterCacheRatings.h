@@ -24,8 +24,12 @@ public:
 	CFilterCacheRatings(const TCHAR* pText, GcFilter FilterType);
 	virtual ~CFilterCacheRatings();
 
-	virtual bool OnFilterCache(CGeoCache* pCache);
+	virtual bool OnFilterCache(CGeoCache* pCache) const;
+	virtual bool Compile(CFilterPredicate& Predicate);
 	virtual void Serialize(CStream& ar);
+
+	// Returns the range of the ratings passing a comparison with a level
+	static void	OperRange(OperType Oper, double Level, float& Min, float& Max);
 };
 
 #endif
\ No newline at end of file
@@ -9,7 +9,7 @@ CFilterCacheTB::~CFilterCacheTB()
 {
 }
 
-bool CFilterCacheTB::OnFilterCache(CGeoCache* pCache)
+bool CFilterCacheTB::OnFilterCache(CGeoCache* pCache) const
 {
 	if (pCache->GetTBCount())
 	{
@@ -19,6 +19,14 @@ bool CFilterCacheTB::OnFilterCache(CGeoCache* pCache)
 	return false;
 }
 
+// Folds the filter into the compiled test: the caches must hold travel bugs
+bool CFilterCacheTB::Compile(CFilterPredicate& Predicate)
+{
+	Predicate.m_RequiredFlags |= CA_TRAVELBUGS;
+
+	return true;
+}
+
 void CFilterCacheTB::Serialize(CStream& ar)
 {
 	#define CFilterCacheTBVersion	100
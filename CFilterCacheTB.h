@@ -10,7 +10,8 @@ public:
 	CFilterCacheTB(const TCHAR* pText, GcFilter FilterType);
 	virtual ~CFilterCacheTB();
 
-	virtual bool OnFilterCache(CGeoCache* pCache);
+	virtual bool OnFilterCache(CGeoCache* pCache) const;
+	virtual bool Compile(CFilterPredicate& Predicate);
 	virtual void Serialize(CStream& ar);
 };
 
@@ -1,4 +1,5 @@
 #include "CFilterCacheTypes.h"
+#include "CSchema.h"
 
 //------------------------------------------------------------------------------------------------------------------------
 
@@ -16,29 +17,15 @@ CFiltCacheTypes::CFiltCacheTypes(GcType Type, bool Enabled)
 
 void CFiltCacheTypes::Serialize(CStream& ar)
 {
-	#define CFiltCacheTypesVersion	100
+	int		Type = m_Type;
+	CSchema	Schema;
 
-	if (ar.IsStoring())
-	{
-		ar << CFiltCacheTypesVersion;
-		ar << m_Type;
-		ar << m_Enabled;
-	}
-	else
-	{
-		int Version;
+	Schema.Add(Type, 100);
+	Schema.Add(m_Enabled, 100);
 
-		ar >> Version;
-
-		if (Version >= 100)
-		{
-			int Type;
-			ar >> Type;
-			m_Type = (GcType) Type;
+	Schema.Serialize(ar);
 
-			ar >> m_Enabled;
-		}
-	}
+	m_Type = (GcType) Type;
 }
 
 //------------------------------------------------------------------------------------------------------------------------
@@ -68,9 +55,9 @@ CFilterCacheTypes::~CFilterCacheTypes()
 	Reset();
 }
 
-bool CFilterCacheTypes::OnFilterCache(CGeoCache* pCache)
+bool CFilterCacheTypes::OnFilterCache(CGeoCache* pCache) const
 {
-	for (itFiltCacheTypes it = m_Types.begin(); it != m_Types.end(); it++)
+	for (citFiltCacheTypes it = m_Types.begin(); it != m_Types.end(); it++)
 	{
 		GcType CacheType = pCache->TypeLookup();
 
@@ -86,6 +73,20 @@ bool CFilterCacheTypes::OnFilterCache(CGeoCache* pCache)
 	return true;
 }
 
+// Folds the cache types filtered out into the compiled test
+bool CFilterCacheTypes::Compile(CFilterPredicate& Predicate)
+{
+	for (itFiltCacheTypes it = m_Types.begin(); it != m_Types.end(); it++)
+	{
+		if (!(*it)->m_Enabled && (*it)->m_Type != GT_NotInitialized)
+		{
+			Predicate.m_RejectedTypes |= 1 << (*it)->m_Type;
+		}
+	}
+
+	return true;
+}
+
 void CFilterCacheTypes::Serialize(CStream& ar)
 {
 	#define	CFilterCacheTypesVersion 102
@@ -23,6 +23,7 @@ public:
 
 typedef vector<CFiltCacheTypes*>			FiltCacheTypesCont;
 typedef vector<CFiltCacheTypes*>::iterator	itFiltCacheTypes;
+typedef vector<CFiltCacheTypes*>::const_iterator	citFiltCacheTypes;
 
 class CFilterCacheTypes : public CFilterBase
 {
@@ -33,7 +34,8 @@ public:
 	CFilterCacheTypes(const TCHAR* pText, GcFilter FilterType);
 	virtual ~CFilterCacheTypes();
 
-	virtual bool OnFilterCache(CGeoCache* pCache);
+	virtual bool OnFilterCache(CGeoCache* pCache) const;
+	virtual bool Compile(CFilterPredicate& Predicate);
 	virtual void Serialize(CStream& ar);
 
 protected:
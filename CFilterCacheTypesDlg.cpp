@@ -2,6 +2,7 @@
 #include "GpxSonar.h"
 #include "CFilterCacheTypesDlg.h"
 #include "CFilterCacheTypes.h"
+#include "CFilterFacets.h"
 
 #ifdef _DEBUG
 #define new DEBUG_NEW
@@ -17,6 +18,7 @@ CFilterCacheTypesDlg::CFilterCacheTypesDlg(CWnd* pParent /*=NULL*/)
 	//}}AFX_DATA_INIT
 
 	m_pTypes = 0;
+	m_pFacets = 0;
 }
 
 CFilterCacheTypesDlg::~CFilterCacheTypesDlg()
@@ -54,7 +56,14 @@ BOOL CFilterCacheTypesDlg::OnInitDialog()
 		{
 			CFiltCacheTypes* pFCT = *it;
 
-			HTREEITEM Item = InsertItem(m_Tree, TVI_ROOT, Lookup(pFCT->m_Type), (void*) pFCT, (int) pFCT->m_Type);
+			String Text = Lookup(pFCT->m_Type);
+
+			if (m_pFacets)
+			{
+				Text = CFilterFacets::Label(Text.c_str(), m_pFacets->GetCount(FacetType, pFCT->m_Type));
+			}
+
+			HTREEITEM Item = InsertItem(m_Tree, TVI_ROOT, Text.c_str(), (void*) pFCT, (int) pFCT->m_Type);
 
 			m_Tree.SetCheck(Item, pFCT->m_Enabled);
 		}
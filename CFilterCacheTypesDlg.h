@@ -9,6 +9,7 @@
 #include "CGpxParser.h"
 
 class CFilterCacheTypes;
+class CFilterFacets;
 
 class CFilterCacheTypesDlg : public CNonFSDialog
 {
@@ -25,6 +26,9 @@ public:
 
 	CFilterCacheTypes*	m_pTypes;
 
+	// Counts of the options given the other filters, or null to list the options alone
+	CFilterFacets*	m_pFacets;
+
 // Overrides
 	// ClassWizard generated virtual function overrides
 	//{{AFX_VIRTUAL(CFilterCacheTypesDlg)
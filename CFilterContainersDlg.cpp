@@ -2,6 +2,7 @@
 #include "GpxSonar.h"
 #include "CFilterContainersDlg.h"
 #include "CFilterCacheContainers.h"
+#include "CFilterFacets.h"
 #include "IDB_CACHES.h"
 
 #ifdef _DEBUG
@@ -17,6 +18,7 @@ CFilterContainersDlg::CFilterContainersDlg(CWnd* pParent) : CNonFSDialog(CFilter
 	//}}AFX_DATA_INIT
 
 	m_pConts = 0;
+	m_pFacets = 0;
 }
 
 CFilterContainersDlg::~CFilterContainersDlg()
@@ -56,7 +58,14 @@ BOOL CFilterContainersDlg::OnInitDialog()
 		// Do not list the unknown container type
 		if (GC_Unknown != pFCT->m_Container)
 		{
-			HTREEITEM Item = InsertItem(m_Opts, TVI_ROOT, Lookup(pFCT->m_Container), (void*) pFCT, GENERIC_CONTAINER);
+			String Text = Lookup(pFCT->m_Container);
+
+			if (m_pFacets)
+			{
+				Text = CFilterFacets::Label(Text.c_str(), m_pFacets->GetCount(FacetContainer, pFCT->m_Container));
+			}
+
+			HTREEITEM Item = InsertItem(m_Opts, TVI_ROOT, Text.c_str(), (void*) pFCT, GENERIC_CONTAINER);
 
 			m_Opts.SetCheck(Item, pFCT->m_Enabled);
 		}
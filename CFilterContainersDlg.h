@@ -9,6 +9,7 @@
 #include "CGpxParser.h"
 
 class CFilterCacheContainers;
+class CFilterFacets;
 
 class CFilterContainersDlg : public CNonFSDialog
 {
@@ -25,6 +26,9 @@ public:
 
 	CFilterCacheContainers*	m_pConts;
 
+	// Counts of the options given the other filters, or null to list the options alone
+	CFilterFacets*	m_pFacets;
+
 // Overrides
 	// ClassWizard generated virtual function overrides
 	//{{AFX_VIRTUAL(CFilterContainersDlg)
@@ -0,0 +1,341 @@
+#include "CFilterCorridor.h"
+#include "CSpatialIndex.h"
+#include "CCoords.h"
+#include "CBaseException.h"
+#include ".\Expat\expat.h"
+#include <algorithm>
+
+CFilterCorridor::CFilterCorridor(const TCHAR* pText, GcFilter FilterType) : CFilterBase(pText, FilterType)
+{
+	m_Distance = 0.5;
+	m_pIndex = 0;
+	m_pUnits = 0;
+	m_Meters = 0.0;
+	m_RouteRevision = 0;
+	m_SignedRevision = -1;
+	m_SignedMeters = 0.0;
+}
+
+CFilterCorridor::~CFilterCorridor()
+{
+}
+
+// Sets the index of the loaded caches and the distance units of the list
+void CFilterCorridor::SetSpatialIndex(CSpatialIndex* pIndex, CCoords* pUnits)
+{
+	m_pIndex = pIndex;
+	m_pUnits = pUnits;
+}
+
+// Returns the number of points of the route
+long CFilterCorridor::GetRouteSize()
+{
+	return m_Route.size();
+}
+
+// Replaces the route with the track points of a GPX file, or with its route points if it has no track
+bool CFilterCorridor::LoadRoute(const String& GpxFile)
+{
+	FILE* fd = _tfopen(GpxFile.c_str(), _T("rb"));
+
+	if (fd == NULL)
+	{
+		return false;
+	}
+
+	XML_Parser XP = XML_ParserCreate(NULL);
+
+	if (!XP)
+	{
+		fclose(fd);
+
+		return false;
+	}
+
+	CorridorReader	Reader;
+
+	XML_SetUserData(XP, &Reader);
+	XML_SetElementHandler(XP, StartElement, NULL);
+
+	#define CORRIDOR_READ_BUFFER	1024 * 8
+
+	char	buf[CORRIDOR_READ_BUFFER];
+	int		len;
+	int		done = 0;
+	bool	Ok = true;
+
+	while (!done)
+	{
+		len = fread(buf, 1, sizeof(buf), fd);
+		done = feof(fd) || !len;
+
+		if (!XML_Parse(XP, buf, len, done))
+		{
+			Ok = false;
+			break;
+		}
+	}
+
+	XML_ParserFree(XP);
+	fclose(fd);
+
+	// A file cut short still holds the points read so far, but they may not be the whole route
+	if (!Ok)
+	{
+		return false;
+	}
+
+	vector<CPreparedPoint>& Points = Reader.Track.empty() ? Reader.Route : Reader.Track;
+
+	if (Points.empty())
+	{
+		return false;
+	}
+
+	m_Route.swap(Points);
+	m_RouteRevision++;
+
+	int Slash = GpxFile.rfind(_T('\\'));
+
+	m_RouteName = (Slash == -1) ? GpxFile : GpxFile.substr(Slash + 1);
+
+	return true;
+}
+
+// Collects the track and route points of a GPX file
+void CFilterCorridor::StartElement(void* pData, const char* pElem, const char** pAttr)
+{
+	CorridorReader* pReader = (CorridorReader*) pData;
+
+	bool IsTrack = !strcmp(pElem, "trkpt");
+
+	if (!IsTrack && strcmp(pElem, "rtept"))
+	{
+		return;
+	}
+
+	double	Lat = 0.0;
+	double	Long = 0.0;
+	int		Found = 0;
+
+	for (const char** ppAttr = pAttr; *ppAttr; ppAttr += 2)
+	{
+		if (!strcmp(ppAttr[0], "lat") && sscanf(ppAttr[1], "%lf", &Lat) == 1)
+		{
+			Found++;
+		}
+		else if (!strcmp(ppAttr[0], "lon") && sscanf(ppAttr[1], "%lf", &Long) == 1)
+		{
+			Found++;
+		}
+	}
+
+	if (Found != 2)
+	{
+		return;
+	}
+
+	if (IsTrack)
+	{
+		pReader->Track.push_back(CPreparedPoint(Lat, Long));
+	}
+	else
+	{
+		pReader->Route.push_back(CPreparedPoint(Lat, Long));
+	}
+}
+
+// On the same route, a shorter distance can only reject more caches and a longer one fewer. The distance is
+// compared in meters, since the distance units of the list may have changed.
+FilterChange CFilterCorridor::GetChange()
+{
+	double			Meters = m_pUnits ? m_Distance * m_pUnits->GetDistanceUnits() : 0.0;
+	FilterChange	Change = FilterChanged;
+
+	if (m_RouteRevision == m_SignedRevision && !m_Route.empty())
+	{
+		if (Meters < m_SignedMeters)
+		{
+			Change = FilterNarrower;
+		}
+		else if (Meters > m_SignedMeters)
+		{
+			Change = FilterWider;
+		}
+		else
+		{
+			Change = FilterSame;
+		}
+	}
+
+	m_SignedRevision = m_RouteRevision;
+	m_SignedMeters = Meters;
+
+	return Change;
+}
+
+void CFilterCorridor::OnBeginFilter(CGpxParser& Parser)
+{
+	m_Matches.clear();
+
+	if (m_Route.empty() || !m_pIndex || m_pIndex->IsEmpty() || !m_pUnits)
+	{
+		return;
+	}
+
+	m_Meters = m_Distance * m_pUnits->GetDistanceUnits();
+
+	CorridorWorker	Workers[CORRIDOR_THREADS];
+	HANDLE			Threads[CORRIDOR_THREADS];
+	long			Index;
+
+	for (Index = 0; Index < CORRIDOR_THREADS; Index++)
+	{
+		Workers[Index].pFilter = this;
+		Workers[Index].First = Index;
+
+		Threads[Index] = NULL;
+
+		// A short route doesn't keep every thread busy
+		if (Index >= GetArcCount())
+		{
+			continue;
+		}
+
+		DWORD ThreadId = 0;
+
+		Threads[Index] = CreateThread(NULL, 0, ThreadProc, (LPVOID) &Workers[Index], 0, &ThreadId);
+
+		if (Threads[Index] == NULL)
+		{
+			CBaseException Up;
+
+			Up.m_szSrc = _T("CFilterCorridor::OnBeginFilter()");
+			Up.m_szMsg = _T("Failed to create a thread! The arcs will be measured by the calling thread.");
+			Up.Win32Error();
+			Up.Log();
+
+			MeasureArcs(Workers[Index].First, Workers[Index].Matches);
+		}
+	}
+
+	for (Index = 0; Index < CORRIDOR_THREADS; Index++)
+	{
+		if (Threads[Index])
+		{
+			WaitForSingleObject(Threads[Index], INFINITE);
+			CloseHandle(Threads[Index]);
+		}
+
+		m_Matches.insert(m_Matches.end(), Workers[Index].Matches.begin(), Workers[Index].Matches.end());
+	}
+
+	// A cache close to several arcs was found several times
+	sort(m_Matches.begin(), m_Matches.end());
+	m_Matches.erase(unique(m_Matches.begin(), m_Matches.end()), m_Matches.end());
+}
+
+// Returns the number of arcs of the route. A route of a single point has one arc, from the point to itself,
+// and its corridor is a circle.
+long CFilterCorridor::GetArcCount()
+{
+	return (m_Route.size() > 1) ? m_Route.size() - 1 : 1;
+}
+
+// Thread entry point
+DWORD WINAPI CFilterCorridor::ThreadProc(LPVOID pParam)
+{
+	CorridorWorker* pWorker = (CorridorWorker*) pParam;
+
+	pWorker->pFilter->MeasureArcs(pWorker->First, pWorker->Matches);
+
+	return 0;
+}
+
+// Adds to Matches the caches within the corridor of the arcs First, First + CORRIDOR_THREADS, ...
+void CFilterCorridor::MeasureArcs(long First, GCCont& Matches)
+{
+	long	Arcs = GetArcCount();
+	long	Last = m_Route.size() - 1;
+	GCCont	Candidates;
+
+	for (long Arc = First; Arc < Arcs; Arc += CORRIDOR_THREADS)
+	{
+		CPreparedPoint& From = m_Route[Arc];
+		CPreparedPoint& To = m_Route[(Arc < Last) ? Arc + 1 : Last];
+
+		Candidates.clear();
+
+		m_pIndex->Corridor(From, To, m_Meters, Candidates);
+
+		for (itGC it = Candidates.begin(); it != Candidates.end(); it++)
+		{
+			if ((*it)->m_Point.SegmentDistance(From, To) <= m_Meters)
+			{
+				Matches.push_back(*it);
+			}
+		}
+	}
+}
+
+bool CFilterCorridor::OnFilterCache(CGeoCache* pCache) const
+{
+	// Without a route, there is no corridor to keep the caches out of
+	if (m_Route.empty())
+	{
+		return true;
+	}
+
+	return binary_search(m_Matches.begin(), m_Matches.end(), pCache);
+}
+
+void CFilterCorridor::Serialize(CStream& ar)
+{
+	#define CFilterCorridorVersion	100
+
+	CFilterBase::Serialize(ar);
+
+	if (ar.IsStoring())
+	{
+		ar << CFilterCorridorVersion;
+
+		ar << m_Distance;
+		ar << m_RouteName;
+
+		ar << (long) m_Route.size();
+
+		for (vector<CPreparedPoint>::iterator it = m_Route.begin(); it != m_Route.end(); it++)
+		{
+			ar << it->m_Latitude;
+			ar << it->m_Longitude;
+		}
+	}
+	else
+	{
+		int Version;
+
+		ar >> Version;
+
+		m_Route.clear();
+		m_RouteRevision++;
+
+		if (Version >= 100)
+		{
+			ar >> m_Distance;
+			ar >> m_RouteName;
+
+			long	Count;
+			double	Lat, Long;
+
+			ar >> Count;
+
+			while (Count-- > 0)
+			{
+				ar >> Lat;
+				ar >> Long;
+
+				m_Route.push_back(CPreparedPoint(Lat, Long));
+			}
+		}
+	}
+}
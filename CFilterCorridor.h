@@ -0,0 +1,99 @@
+#ifndef _INC_CFilterCorridor
+	#define _INC_CFilterCorridor
+
+#include "CommonDefs.h"
+#include "CFilterMgr.h"
+#include "CGpxParser.h"
+#include <vector>
+
+using namespace std;
+
+class CSpatialIndex;
+class CCoords;
+
+// Keeps the caches located within a distance of a route, such as a track recorded by a GPS or a route planned
+// in a mapping program and saved to a GPX file. The route is a polyline: a cache is within the corridor when it
+// is close enough to one of the great circle arcs joining the consecutive points of the route.
+// The spatial index retrieves the caches around each arc, so that only these are measured, and the arcs are
+// shared among a few threads. The corridor is worked out once per filtering pass, in OnBeginFilter().
+class CFilterCorridor : public CFilterBase
+{
+	// Number of threads measuring the arcs
+	#define CORRIDOR_THREADS	2
+
+	// Parameters and results of a thread
+	typedef struct {
+		CFilterCorridor*	pFilter;
+		long				First;
+		GCCont				Matches;
+	} CorridorWorker;
+
+	// Points found while reading a GPX file
+	typedef struct {
+		vector<CPreparedPoint>	Track;
+		vector<CPreparedPoint>	Route;
+	} CorridorReader;
+
+public:
+	// Largest distance of a cache from the route, in the distance units of the list
+	double					m_Distance;
+
+	// Name of the file the route was read from
+	String					m_RouteName;
+
+protected:
+	vector<CPreparedPoint>	m_Route;
+
+	CSpatialIndex*			m_pIndex;
+	CCoords*				m_pUnits;
+
+	// Largest distance in meters during a filtering pass
+	double					m_Meters;
+
+	// Caches within the corridor, sorted by address
+	GCCont					m_Matches;
+
+	// Incremented each time the route is replaced
+	long					m_RouteRevision;
+
+	// Route and distance in meters as of the previous filtering pass
+	long					m_SignedRevision;
+	double					m_SignedMeters;
+
+public:
+	CFilterCorridor(const TCHAR* pText, GcFilter FilterType);
+	virtual ~CFilterCorridor();
+
+	// Sets the index of the loaded caches and the distance units of the list
+	void	SetSpatialIndex(CSpatialIndex* pIndex, CCoords* pUnits);
+
+	// Replaces the route with the track points of a GPX file, or with its route points if it has no track.
+	// Returns 'false' and leaves the route as it was if the file can't be read or has no such point.
+	bool	LoadRoute(const String& GpxFile);
+
+	// Returns the number of points of the route
+	long	GetRouteSize();
+
+	virtual void OnBeginFilter(CGpxParser& Parser);
+
+	virtual FilterChange GetChange();
+
+	virtual bool OnFilterCache(CGeoCache* pCache) const;
+
+	virtual void Serialize(CStream& ar);
+
+protected:
+	// Thread entry point
+	static DWORD WINAPI	ThreadProc(LPVOID pParam);
+
+	// Adds to Matches the caches within the corridor of the arcs First, First + CORRIDOR_THREADS, ...
+	void	MeasureArcs(long First, GCCont& Matches);
+
+	// Returns the number of arcs of the route
+	long	GetArcCount();
+
+	// Collects the track and route points of a GPX file
+	static void	StartElement(void* pData, const char* pElem, const char** pAttr);
+};
+
+#endif
@@ -0,0 +1,98 @@
+#include "stdafx.h"
+#include "GpxSonar.h"
+#include "CFilterCorridorDlg.h"
+#include "CFilterCorridor.h"
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#undef THIS_FILE
+static char THIS_FILE[] = __FILE__;
+#endif
+
+CFilterCorridorDlg::CFilterCorridorDlg(CWnd* pParent /*=NULL*/)
+	: CNonFSDialog(CFilterCorridorDlg::IDD, pParent)
+{
+	//{{AFX_DATA_INIT(CFilterCorridorDlg)
+	m_Route = _T("");
+	m_Dist = 0.5;
+	//}}AFX_DATA_INIT
+
+	m_pCorridor = 0;
+}
+
+void CFilterCorridorDlg::DoDataExchange(CDataExchange* pDX)
+{
+	CNonFSDialog::DoDataExchange(pDX);
+	//{{AFX_DATA_MAP(CFilterCorridorDlg)
+	DDX_Text(pDX, IDC_NAME, m_Route);
+	DDX_Text(pDX, IDC_DIST, m_Dist);
+	DDV_MinMaxDouble(pDX, m_Dist, 0., 99999.99);
+	//}}AFX_DATA_MAP
+}
+
+BEGIN_MESSAGE_MAP(CFilterCorridorDlg, CNonFSDialog)
+	//{{AFX_MSG_MAP(CFilterCorridorDlg)
+	ON_BN_CLICKED(IDC_IMPORT, OnImport)
+	//}}AFX_MSG_MAP
+END_MESSAGE_MAP()
+
+BOOL CFilterCorridorDlg::OnInitDialog() 
+{
+	CNonFSDialog::OnInitDialog();
+
+	m_Dist = m_pCorridor->m_Distance;
+
+	UpdateRouteText();
+
+	UpdateData(false);
+	
+	return TRUE;  // return TRUE unless you set the focus to a control
+	              // EXCEPTION: OCX Property Pages should return FALSE
+}
+
+void CFilterCorridorDlg::OnCancel() 
+{
+	UpdateData(true);
+
+	m_pCorridor->m_Distance = m_Dist;
+
+	CNonFSDialog::OnCancel();
+}
+
+void CFilterCorridorDlg::OnImport() 
+{
+	CFileDialog	Dlg( 
+				true,								// File Open...
+				_T(".gpx"),							// Default file extension
+				NULL,
+				OFN_FILEMUSTEXIST | OFN_PATHMUSTEXIST | OFN_NOCHANGEDIR | OFN_NONETWORKBUTTON,
+				_T("GPX Files (*.gpx)|*.gpx||"),
+				0);									// No parent window
+
+	if (Dlg.DoModal() == IDOK)
+	{
+		UpdateData(true);
+
+		if (!m_pCorridor->LoadRoute((LPCTSTR) Dlg.GetPathName()))
+		{
+			MessageBox(_T("This file holds no track or route."), _T("Invalid Route"), MB_OK | MB_ICONWARNING);
+		}
+
+		UpdateRouteText();
+
+		UpdateData(false);
+	}
+}
+
+// Describes the route of the filter
+void CFilterCorridorDlg::UpdateRouteText()
+{
+	if (m_pCorridor->GetRouteSize())
+	{
+		m_Route.Format(_T("%s (%ld points)"), m_pCorridor->m_RouteName.c_str(), m_pCorridor->GetRouteSize());
+	}
+	else
+	{
+		m_Route = _T("No route loaded");
+	}
+}
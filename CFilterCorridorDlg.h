@@ -0,0 +1,52 @@
+#if !defined(AFX_CFILTERCORRIDORDLG_H__3F1C8A52_9B0E_4C57_A6D4_2E81B7C90F14__INCLUDED_)
+#define AFX_CFILTERCORRIDORDLG_H__3F1C8A52_9B0E_4C57_A6D4_2E81B7C90F14__INCLUDED_
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+#include "NonFSDialog.h"
+
+class CFilterCorridor;
+
+class CFilterCorridorDlg : public CNonFSDialog
+{
+// Construction
+public:
+	CFilterCorridorDlg(CWnd* pParent = NULL);   // standard constructor
+
+// Dialog Data
+	//{{AFX_DATA(CFilterCorridorDlg)
+	enum { IDD = IDD_FILTER_CORRIDOR };
+	CString	m_Route;
+	double	m_Dist;
+	//}}AFX_DATA
+
+	CFilterCorridor*	m_pCorridor;
+
+// Overrides
+	// ClassWizard generated virtual function overrides
+	//{{AFX_VIRTUAL(CFilterCorridorDlg)
+	protected:
+	virtual void DoDataExchange(CDataExchange* pDX);    // DDX/DDV support
+	//}}AFX_VIRTUAL
+
+// Implementation
+protected:
+
+	// Generated message map functions
+	//{{AFX_MSG(CFilterCorridorDlg)
+	virtual BOOL OnInitDialog();
+	virtual void OnCancel();
+	afx_msg void OnImport();
+	//}}AFX_MSG
+	DECLARE_MESSAGE_MAP()
+
+	// Describes the route of the filter
+	void	UpdateRouteText();
+};
+
+//{{AFX_INSERT_LOCATION}}
+// Microsoft Visual C++ will insert additional declarations immediately before the previous line.
+
+#endif // !defined(AFX_CFILTERCORRIDORDLG_H__3F1C8A52_9B0E_4C57_A6D4_2E81B7C90F14__INCLUDED_)
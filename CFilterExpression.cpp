@@ -0,0 +1,787 @@
+#include "CFilterExpression.h"
+#include "CGpxParser.h"
+#include <stdlib.h>
+
+// Kinds of the tokens of an expression
+typedef enum {
+	TokenEnd = 0,
+	TokenWord,		// Keywords, names and numbers
+	TokenString,	// "Quoted" names
+	TokenCompare,
+	TokenOpen,
+	TokenClose,
+	TokenOpenSet,
+	TokenCloseSet,
+	TokenComma
+} ExpressionTokenType;
+
+typedef struct {
+	ExpressionTokenType	Type;
+	String				Text;
+	BYTE				Compare;
+} ExpressionToken;
+
+// A name of the expression language and its value
+typedef struct {
+	const TCHAR*	pName;
+	long			Value;
+} ExpressionName;
+
+static const ExpressionName ExpressionFields[] = {
+	{ _T("type"),			PredicateType },
+	{ _T("container"),		PredicateContainer },
+	{ _T("size"),			PredicateContainer },
+	{ _T("bearing"),		PredicateBearing },
+	{ _T("state"),			PredicateState },
+	{ _T("country"),		PredicateCountry },
+	{ _T("dist"),			PredicateDistance },
+	{ _T("distance"),		PredicateDistance },
+	{ _T("d"),				PredicateDifficulty },
+	{ _T("difficulty"),		PredicateDifficulty },
+	{ _T("t"),				PredicateTerrain },
+	{ _T("terrain"),		PredicateTerrain },
+	{ NULL,					0 }
+};
+
+static const ExpressionName ExpressionFlags[] = {
+	{ _T("found"),			CA_FOUND },
+	{ _T("fieldnote"),		CA_FIELDNOTE },
+	{ _T("ignored"),		CA_IGNORED },
+	{ _T("unavailable"),	CA_UNAVAILABLE },
+	{ _T("disabled"),		CA_DISABLED },
+	{ _T("archived"),		CA_ARCHIVED },
+	{ _T("tb"),				CA_TRAVELBUGS },
+	{ _T("travelbugs"),		CA_TRAVELBUGS },
+	{ NULL,					0 }
+};
+
+static const ExpressionName ExpressionTypes[] = {
+	{ _T("traditional"),	GT_Traditional },
+	{ _T("multi"),			GT_Multi },
+	{ _T("virtual"),		GT_Virtual },
+	{ _T("webcam"),			GT_Webcam },
+	{ _T("unknown"),		GT_Unknown },
+	{ _T("mystery"),		GT_Unknown },
+	{ _T("puzzle"),			GT_Unknown },
+	{ _T("letterbox"),		GT_LetterboxHybrid },
+	{ _T("event"),			GT_Event },
+	{ _T("ape"),			GT_ProjectAPE },
+	{ _T("locationless"),	GT_Locationless },
+	{ _T("cito"),			GT_CITO },
+	{ _T("earthcache"),		GT_Earthcache },
+	{ NULL,					0 }
+};
+
+static const ExpressionName ExpressionContainers[] = {
+	{ _T("unknown"),		GC_Unknown },
+	{ _T("micro"),			GC_Micro },
+	{ _T("small"),			GC_Small },
+	{ _T("regular"),		GC_Regular },
+	{ _T("large"),			GC_Large },
+	{ _T("virtual"),		GC_Virtual },
+	{ _T("notlisted"),		GC_NotListed },
+	{ _T("other"),			GC_NotListed },
+	{ NULL,					0 }
+};
+
+static const ExpressionName ExpressionBearings[] = {
+	{ _T("n"),				GB_North },
+	{ _T("ne"),				GB_NorthEast },
+	{ _T("e"),				GB_East },
+	{ _T("se"),				GB_SouthEast },
+	{ _T("s"),				GB_South },
+	{ _T("sw"),				GB_SouthWest },
+	{ _T("w"),				GB_West },
+	{ _T("nw"),				GB_NorthWest },
+	{ NULL,					0 }
+};
+
+// Recursive descent parser of the expressions:
+//
+//		Or		:= And { 'or' And }
+//		And		:= Not { 'and' Not }
+//		Not		:= 'not' Not | '(' Or ')' | Test
+//		Test	:= Flag | Field Compare Value | Field ['not'] 'in' '{' Value { ',' Value } '}'
+//
+// The steps come out in postfix order, as the predicate runs them.
+class CExpressionParser
+{
+protected:
+	vector<ExpressionToken>	m_Tokens;
+	long					m_Pos;
+	ExpressionProgram&		m_Program;
+
+public:
+	String					m_Error;
+
+public:
+	CExpressionParser(ExpressionProgram& Program) : m_Program(Program)
+	{
+		m_Pos = 0;
+	}
+
+	// Parses an expression. Returns 'false' and sets m_Error if it isn't valid.
+	bool	Parse(const String& Expression);
+
+protected:
+	// Splits an expression into tokens
+	bool	Tokenize(const String& Expression);
+
+	bool	ParseOr();
+	bool	ParseAnd();
+	bool	ParseNot();
+	bool	ParseTest();
+
+	// Parses the values of a test on a field into a step
+	bool	ParseValues(long Field, BYTE Compare, bool InSet, bool Negate);
+
+	// Returns 'true' if the current token is the keyword
+	bool	IsKeyword(const TCHAR* pKeyword);
+
+	// Appends a step
+	void	Add(long Op, DWORD Bits = 0, BYTE Compare = 0, double Value = 0.0);
+
+	// Looks a name up in a table. Returns 'false' if it isn't there.
+	static bool	Lookup(const ExpressionName* pNames, const String& Name, long& Value);
+};
+
+// Parses an expression. Returns 'false' and sets m_Error if it isn't valid.
+bool CExpressionParser::Parse(const String& Expression)
+{
+	m_Program.clear();
+
+	if (!Tokenize(Expression))
+	{
+		return false;
+	}
+
+	// Nothing to test: every cache passes
+	if (m_Tokens[0].Type == TokenEnd)
+	{
+		return true;
+	}
+
+	if (!ParseOr())
+	{
+		return false;
+	}
+
+	if (m_Tokens[m_Pos].Type != TokenEnd)
+	{
+		m_Error = _T("Expected 'and' or 'or' before: ") + m_Tokens[m_Pos].Text;
+		return false;
+	}
+
+	return true;
+}
+
+// Splits an expression into tokens. The last token is always a TokenEnd.
+bool CExpressionParser::Tokenize(const String& Expression)
+{
+	const TCHAR*	pChar = Expression.c_str();
+	ExpressionToken	Token;
+
+	m_Tokens.clear();
+	m_Pos = 0;
+
+	while (*pChar)
+	{
+		if (*pChar == ' ' || *pChar == '\t' || *pChar == '\r' || *pChar == '\n')
+		{
+			pChar++;
+			continue;
+		}
+
+		const TCHAR* pStart = pChar;
+
+		Token.Type = TokenWord;
+		Token.Compare = 0;
+
+		switch (*pChar)
+		{
+		case '(':
+			Token.Type = TokenOpen;
+			pChar++;
+			break;
+
+		case ')':
+			Token.Type = TokenClose;
+			pChar++;
+			break;
+
+		case '{':
+			Token.Type = TokenOpenSet;
+			pChar++;
+			break;
+
+		case '}':
+			Token.Type = TokenCloseSet;
+			pChar++;
+			break;
+
+		case ',':
+			Token.Type = TokenComma;
+			pChar++;
+			break;
+
+		case '<':
+			Token.Type = TokenCompare;
+			Token.Compare = CompareLess;
+			pChar++;
+
+			if (*pChar == '=')
+			{
+				Token.Compare = CompareLessEqual;
+				pChar++;
+			}
+			else if (*pChar == '>')
+			{
+				Token.Compare = CompareNotEqual;
+				pChar++;
+			}
+			break;
+
+		case '>':
+			Token.Type = TokenCompare;
+			Token.Compare = CompareGreater;
+			pChar++;
+
+			if (*pChar == '=')
+			{
+				Token.Compare = CompareGreaterEqual;
+				pChar++;
+			}
+			break;
+
+		case '=':
+			Token.Type = TokenCompare;
+			Token.Compare = CompareEqual;
+			pChar++;
+
+			if (*pChar == '=')
+			{
+				pChar++;
+			}
+			break;
+
+		case '!':
+			pChar++;
+
+			if (*pChar == '=')
+			{
+				Token.Type = TokenCompare;
+				Token.Compare = CompareNotEqual;
+				pChar++;
+			}
+			else
+			{
+				// Same as 'not'
+				Token.Text = _T("not");
+			}
+			break;
+
+		case '&':
+		case '|':
+			// Same as 'and' and 'or', single or doubled
+			Token.Text = (*pChar == '&') ? _T("and") : _T("or");
+
+			if (pChar[1] == *pChar)
+			{
+				pChar++;
+			}
+
+			pChar++;
+			break;
+
+		case '"':
+			Token.Type = TokenString;
+
+			for (pStart = ++pChar; *pChar && *pChar != '"'; pChar++);
+
+			if (!*pChar)
+			{
+				m_Error = _T("Missing closing quote after: ") + String(pStart);
+				return false;
+			}
+
+			Token.Text = String(pStart, pChar - pStart);
+			pChar++;
+			break;
+
+		default:
+			for (; *pChar && !_tcschr(_T(" \t\r\n(){},<>=!&|\""), *pChar); pChar++);
+
+			Token.Text = String(pStart, pChar - pStart);
+			break;
+		}
+
+		// The words and strings have their text already
+		if (Token.Type != TokenWord && Token.Type != TokenString)
+		{
+			Token.Text = String(pStart, pChar - pStart);
+		}
+
+		m_Tokens.push_back(Token);
+	}
+
+	Token.Type = TokenEnd;
+	Token.Text = _T("(end)");
+	Token.Compare = 0;
+
+	m_Tokens.push_back(Token);
+
+	return true;
+}
+
+bool CExpressionParser::ParseOr()
+{
+	if (!ParseAnd())
+	{
+		return false;
+	}
+
+	while (IsKeyword(_T("or")))
+	{
+		m_Pos++;
+
+		if (!ParseAnd())
+		{
+			return false;
+		}
+
+		Add(PredicateOr);
+	}
+
+	return true;
+}
+
+bool CExpressionParser::ParseAnd()
+{
+	if (!ParseNot())
+	{
+		return false;
+	}
+
+	while (IsKeyword(_T("and")))
+	{
+		m_Pos++;
+
+		if (!ParseNot())
+		{
+			return false;
+		}
+
+		Add(PredicateAnd);
+	}
+
+	return true;
+}
+
+bool CExpressionParser::ParseNot()
+{
+	if (IsKeyword(_T("not")))
+	{
+		m_Pos++;
+
+		if (!ParseNot())
+		{
+			return false;
+		}
+
+		Add(PredicateNot);
+
+		return true;
+	}
+
+	if (m_Tokens[m_Pos].Type == TokenOpen)
+	{
+		m_Pos++;
+
+		if (!ParseOr())
+		{
+			return false;
+		}
+
+		if (m_Tokens[m_Pos].Type != TokenClose)
+		{
+			m_Error = _T("Expected ')' before: ") + m_Tokens[m_Pos].Text;
+			return false;
+		}
+
+		m_Pos++;
+
+		return true;
+	}
+
+	return ParseTest();
+}
+
+bool CExpressionParser::ParseTest()
+{
+	const ExpressionToken&	Token = m_Tokens[m_Pos];
+	long					Value;
+
+	if (Token.Type != TokenWord)
+	{
+		m_Error = _T("Expected a test before: ") + Token.Text;
+		return false;
+	}
+
+	if (Lookup(ExpressionFlags, Token.Text, Value))
+	{
+		m_Pos++;
+
+		Add(PredicateFlags, (DWORD) Value);
+
+		return true;
+	}
+
+	if (!Lookup(ExpressionFields, Token.Text, Value))
+	{
+		m_Error = _T("Unknown word: ") + Token.Text;
+		return false;
+	}
+
+	m_Pos++;
+
+	bool Negate = false;
+
+	if (IsKeyword(_T("not")))
+	{
+		Negate = true;
+		m_Pos++;
+
+		if (!IsKeyword(_T("in")))
+		{
+			m_Error = _T("Expected 'in' after 'not' before: ") + m_Tokens[m_Pos].Text;
+			return false;
+		}
+	}
+
+	if (IsKeyword(_T("in")))
+	{
+		m_Pos++;
+
+		if (m_Tokens[m_Pos].Type != TokenOpenSet)
+		{
+			m_Error = _T("Expected '{' before: ") + m_Tokens[m_Pos].Text;
+			return false;
+		}
+
+		m_Pos++;
+
+		return ParseValues(Value, CompareEqual, true, Negate);
+	}
+
+	if (m_Tokens[m_Pos].Type != TokenCompare)
+	{
+		m_Error = _T("Expected a comparison or 'in' before: ") + m_Tokens[m_Pos].Text;
+		return false;
+	}
+
+	BYTE Compare = m_Tokens[m_Pos].Compare;
+
+	m_Pos++;
+
+	return ParseValues(Value, Compare, false, false);
+}
+
+// Parses the values of a test on a field into a step. InSet is 'true' for the values of 'in', up to the closing brace.
+bool CExpressionParser::ParseValues(long Field, BYTE Compare, bool InSet, bool Negate)
+{
+	ExpressionStep	Step;
+	DWORD			Bits = 0;
+	long			Value;
+	bool			Numeric = (Field == PredicateDistance || Field == PredicateDifficulty || Field == PredicateTerrain);
+
+	if (Numeric && InSet)
+	{
+		m_Error = _T("Use a comparison with numbers, not 'in'");
+		return false;
+	}
+
+	if (!Numeric && Compare != CompareEqual && Compare != CompareNotEqual)
+	{
+		m_Error = _T("Only '=' and '!=' compare names");
+		return false;
+	}
+
+	ZeroMemory(&Step.Step, sizeof(Step.Step));
+
+	Step.Step.Op = (BYTE) Field;
+
+	for (;;)
+	{
+		const ExpressionToken& Token = m_Tokens[m_Pos];
+
+		if (Token.Type != TokenWord && Token.Type != TokenString)
+		{
+			m_Error = _T("Expected a value before: ") + Token.Text;
+			return false;
+		}
+
+		m_Pos++;
+
+		switch (Field)
+		{
+		case PredicateDistance:
+		case PredicateDifficulty:
+		case PredicateTerrain:
+		{
+			TCHAR* pEnd = NULL;
+
+			Step.Step.Value = _tcstod(Token.Text.c_str(), &pEnd);
+			Step.Step.Compare = Compare;
+
+			if (pEnd == Token.Text.c_str() || *pEnd)
+			{
+				m_Error = _T("Not a number: ") + Token.Text;
+				return false;
+			}
+		}
+		break;
+
+		case PredicateType:
+		case PredicateContainer:
+		case PredicateBearing:
+		{
+			const ExpressionName* pNames = (Field == PredicateType) ? ExpressionTypes :
+				((Field == PredicateContainer) ? ExpressionContainers : ExpressionBearings);
+
+			if (!Lookup(pNames, Token.Text, Value))
+			{
+				m_Error = _T("Unknown value: ") + Token.Text;
+				return false;
+			}
+
+			Bits |= 1 << Value;
+		}
+		break;
+
+		default:
+			Step.Names.push_back(Token.Text);
+			break;
+		}
+
+		if (!InSet)
+		{
+			break;
+		}
+
+		if (m_Tokens[m_Pos].Type == TokenCloseSet)
+		{
+			m_Pos++;
+			break;
+		}
+
+		if (m_Tokens[m_Pos].Type != TokenComma)
+		{
+			m_Error = _T("Expected ',' or '}' before: ") + m_Tokens[m_Pos].Text;
+			return false;
+		}
+
+		m_Pos++;
+	}
+
+	Step.Step.Bits = Bits;
+
+	m_Program.push_back(Step);
+
+	// The names are looked for with an equality: '!=' is its negation
+	if (Negate || (!Numeric && Compare == CompareNotEqual))
+	{
+		Add(PredicateNot);
+	}
+
+	return true;
+}
+
+// Returns 'true' if the current token is the keyword
+bool CExpressionParser::IsKeyword(const TCHAR* pKeyword)
+{
+	const ExpressionToken& Token = m_Tokens[m_Pos];
+
+	return (Token.Type == TokenWord && !_tcsicmp(Token.Text.c_str(), pKeyword));
+}
+
+// Appends a step
+void CExpressionParser::Add(long Op, DWORD Bits, BYTE Compare, double Value)
+{
+	ExpressionStep Step;
+
+	ZeroMemory(&Step.Step, sizeof(Step.Step));
+
+	Step.Step.Op = (BYTE) Op;
+	Step.Step.Bits = Bits;
+	Step.Step.Compare = Compare;
+	Step.Step.Value = Value;
+
+	m_Program.push_back(Step);
+}
+
+// Looks a name up in a table. Returns 'false' if it isn't there.
+bool CExpressionParser::Lookup(const ExpressionName* pNames, const String& Name, long& Value)
+{
+	for (; pNames->pName; pNames++)
+	{
+		if (!_tcsicmp(pNames->pName, Name.c_str()))
+		{
+			Value = pNames->Value;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+//------------------------------------------------------------------------------------------------------------------------
+CFilterExpression::CFilterExpression(const TCHAR* pText, GcFilter FilterType) : CFilterBase(pText, FilterType)
+{
+	m_Valid = true;
+}
+
+CFilterExpression::~CFilterExpression()
+{
+}
+
+// Parses an expression into its steps. Returns 'false' and describes the problem in Error if it isn't valid.
+bool CFilterExpression::Parse(const String& Expression, ExpressionProgram& Program, String& Error)
+{
+	CExpressionParser Parser(Program);
+
+	if (!Parser.Parse(Expression))
+	{
+		Program.clear();
+
+		Error = Parser.m_Error;
+
+		return false;
+	}
+
+	return true;
+}
+
+// Uses the expression of a profile. Returns 'false' if there is no such profile.
+bool CFilterExpression::UseProfile(const String& Name)
+{
+	itExpressionProfiles it = m_Profiles.find(Name);
+
+	if (it == m_Profiles.end())
+	{
+		return false;
+	}
+
+	m_Expression = (*it).second;
+	m_Profile = Name;
+
+	return true;
+}
+
+// Saves the expression in use under a name, replacing the profile of that name if any
+void CFilterExpression::SaveProfile(const String& Name)
+{
+	m_Profiles[Name] = m_Expression;
+	m_Profile = Name;
+}
+
+// Deletes a profile
+void CFilterExpression::DeleteProfile(const String& Name)
+{
+	m_Profiles.erase(Name);
+
+	if (m_Profile == Name)
+	{
+		m_Profile = _T("");
+	}
+}
+
+// Adds the steps of the expression to the compiled test. The expression is only parsed again when it changed.
+// An expression that isn't valid keeps every cache.
+bool CFilterExpression::Compile(CFilterPredicate& Predicate)
+{
+	if (m_Expression != m_Parsed)
+	{
+		String Error;
+
+		m_Valid = Parse(m_Expression, m_Program, Error);
+		m_Parsed = m_Expression;
+	}
+
+	if (!m_Valid)
+	{
+		return true;
+	}
+
+	for (itExpressionStep it = m_Program.begin(); it != m_Program.end(); it++)
+	{
+		PredicateStep Step = it->Step;
+
+		if (Step.Op == PredicateState)
+		{
+			Step.Table = Predicate.StateTable(it->Names);
+		}
+		else if (Step.Op == PredicateCountry)
+		{
+			Step.Table = Predicate.CountryTable(it->Names);
+		}
+
+		Predicate.AddStep(Step);
+	}
+
+	return true;
+}
+
+// The expression is always compiled: this is never called during a filtering pass
+bool CFilterExpression::OnFilterCache(CGeoCache* pCache) const
+{
+	return true;
+}
+
+void CFilterExpression::Serialize(CStream& ar)
+{
+	#define	CFilterExpressionVersion 100
+
+	CFilterBase::Serialize(ar);
+
+	if (ar.IsStoring())
+	{
+		ar << CFilterExpressionVersion;
+		ar << m_Expression;
+		ar << m_Profile;
+		ar << (long) m_Profiles.size();
+
+		for (itExpressionProfiles it = m_Profiles.begin(); it != m_Profiles.end(); it++)
+		{
+			ar << (*it).first;
+			ar << (*it).second;
+		}
+	}
+	else
+	{
+		int Version;
+
+		ar >> Version;
+
+		if (Version >= 100)
+		{
+			long Count;
+
+			ar >> m_Expression;
+			ar >> m_Profile;
+			ar >> Count;
+
+			m_Profiles.clear();
+
+			while (Count-- > 0)
+			{
+				String Name;
+				String Expression;
+
+				ar >> Name;
+				ar >> Expression;
+
+				m_Profiles[Name] = Expression;
+			}
+		}
+	}
+}
@@ -0,0 +1,76 @@
+#ifndef _INC_CFilterExpression
+	#define _INC_CFilterExpression
+
+#include "CommonDefs.h"
+#include "CFilterMgr.h"
+#include "CFilterPredicate.h"
+
+using namespace std;
+
+// A step of a parsed expression, with the names of the states or countries it looks for. The names are numbered
+// when the expression is compiled, since each filtering pass numbers the states and countries it meets.
+typedef struct {
+	PredicateStep	Step;
+	vector<String>	Names;
+} ExpressionStep;
+
+typedef vector<ExpressionStep>				ExpressionProgram;
+typedef vector<ExpressionStep>::iterator	itExpressionStep;
+
+// Named expressions, by name
+typedef map<String, String>				ExpressionProfiles;
+typedef map<String, String>::iterator	itExpressionProfiles;
+
+// Keeps the caches passing a boolean expression such as:
+//
+//		type in {Traditional, Multi} and d <= 2 and dist < 5 and not found
+//
+// The tests are 'field op value', where op is one of < <= = != >= >, 'field in {value, ...}' and the flags of
+// the caches. The fields are type, container (or size), bearing, state, country, dist (or distance),
+// d (or difficulty) and t (or terrain); the flags are found, fieldnote, ignored, disabled, archived, unavailable
+// (disabled or archived) and tb (or travelbugs). The tests are joined with and, or, not and parentheses. Names and keywords
+// are case insensitive, and "quotes" hold names with blanks.
+// The expression is parsed into postfix steps, which are added to the compiled test of each filtering pass (see
+// CFilterPredicate): an expression costs one pass over the packed attributes of the caches, whatever its length.
+// Expressions can be saved as named profiles, which are kept with the settings of the filter. Switching to
+// another profile only changes the steps added to the next pass.
+class CFilterExpression : public CFilterBase
+{
+public:
+	// Expression in use, and the profile it was taken from if any
+	String				m_Expression;
+	String				m_Profile;
+
+	ExpressionProfiles	m_Profiles;
+
+protected:
+	// Expression last parsed, its steps, and 'false' if it isn't valid
+	String				m_Parsed;
+	ExpressionProgram	m_Program;
+	bool				m_Valid;
+
+public:
+	CFilterExpression(const TCHAR* pText, GcFilter FilterType);
+	virtual ~CFilterExpression();
+
+	// Uses the expression of a profile. Returns 'false' if there is no such profile.
+	bool	UseProfile(const String& Name);
+
+	// Saves the expression in use under a name, replacing the profile of that name if any
+	void	SaveProfile(const String& Name);
+
+	// Deletes a profile
+	void	DeleteProfile(const String& Name);
+
+	virtual bool	Compile(CFilterPredicate& Predicate);
+
+	virtual bool	OnFilterCache(CGeoCache* pCache) const;
+
+	virtual void	Serialize(CStream& ar);
+
+	// Parses an expression into its steps. Returns 'false' and describes the problem in Error if it isn't valid.
+	// An empty expression has no step.
+	static bool	Parse(const String& Expression, ExpressionProgram& Program, String& Error);
+};
+
+#endif
@@ -0,0 +1,183 @@
+#include "stdafx.h"
+#include "GpxSonar.h"
+#include "CFilterExpressionDlg.h"
+#include "CFilterExpression.h"
+
+#ifdef _DEBUG
+#define new DEBUG_NEW
+#undef THIS_FILE
+static char THIS_FILE[] = __FILE__;
+#endif
+
+CFilterExpressionDlg::CFilterExpressionDlg(CWnd* pParent /*=NULL*/)
+	: CNonFSDialog(CFilterExpressionDlg::IDD, pParent)
+{
+	//{{AFX_DATA_INIT(CFilterExpressionDlg)
+	m_Profile = _T("");
+	m_Expression = _T("");
+	m_Status = _T("");
+	//}}AFX_DATA_INIT
+
+	m_pExpression = 0;
+}
+
+void CFilterExpressionDlg::DoDataExchange(CDataExchange* pDX)
+{
+	CNonFSDialog::DoDataExchange(pDX);
+	//{{AFX_DATA_MAP(CFilterExpressionDlg)
+	DDX_Control(pDX, IDC_NAME, m_ProfileCtl);
+	DDX_CBString(pDX, IDC_NAME, m_Profile);
+	DDX_Text(pDX, IDC_TEXT, m_Expression);
+	DDX_Text(pDX, IDC_STATUS, m_Status);
+	//}}AFX_DATA_MAP
+}
+
+BEGIN_MESSAGE_MAP(CFilterExpressionDlg, CNonFSDialog)
+	//{{AFX_MSG_MAP(CFilterExpressionDlg)
+	ON_CBN_SELCHANGE(IDC_NAME, OnSelchangeProfile)
+	ON_BN_CLICKED(IDC_SAVE, OnSave)
+	ON_BN_CLICKED(IDC_DELETE, OnDelete)
+	//}}AFX_MSG_MAP
+END_MESSAGE_MAP()
+
+BOOL CFilterExpressionDlg::OnInitDialog() 
+{
+	CNonFSDialog::OnInitDialog();
+
+	for (itExpressionProfiles it = m_pExpression->m_Profiles.begin(); it != m_pExpression->m_Profiles.end(); it++)
+	{
+		m_ProfileCtl.AddString((*it).first.c_str());
+	}
+
+	m_Profile = m_pExpression->m_Profile.c_str();
+	m_Expression = m_pExpression->m_Expression.c_str();
+
+	UpdateData(false);
+
+	CheckExpression();
+
+	::SHSipPreference(m_hWnd, SIP_UP);
+
+	return TRUE;  // return TRUE unless you set the focus to a control
+	              // EXCEPTION: OCX Property Pages should return FALSE
+}
+
+void CFilterExpressionDlg::OnCancel() 
+{
+	UpdateData(true);
+
+	// An expression that isn't valid would keep every cache without telling
+	if (!CheckExpression())
+	{
+		MessageBox((LPCTSTR) m_Status, _T("Invalid Expression"), MB_OK | MB_ICONWARNING);
+		return;
+	}
+
+	m_pExpression->m_Expression = (LPCTSTR) m_Expression;
+	m_pExpression->m_Profile = _T("");
+
+	// The profile stays selected as long as its expression wasn't edited
+	itExpressionProfiles it = m_pExpression->m_Profiles.find((LPCTSTR) m_Profile);
+
+	if (it != m_pExpression->m_Profiles.end() && (*it).second == m_pExpression->m_Expression)
+	{
+		m_pExpression->m_Profile = (*it).first;
+	}
+
+	::SHSipPreference(m_hWnd, SIP_DOWN);
+
+	CNonFSDialog::OnCancel();
+}
+
+// Shows the expression of the profile picked
+void CFilterExpressionDlg::OnSelchangeProfile() 
+{
+	int Item = m_ProfileCtl.GetCurSel();
+
+	if (Item == CB_ERR)
+	{
+		return;
+	}
+
+	UpdateData(true);
+
+	m_ProfileCtl.GetLBText(Item, m_Profile);
+
+	itExpressionProfiles it = m_pExpression->m_Profiles.find((LPCTSTR) m_Profile);
+
+	if (it != m_pExpression->m_Profiles.end())
+	{
+		m_Expression = (*it).second.c_str();
+	}
+
+	UpdateData(false);
+
+	CheckExpression();
+}
+
+// Saves the expression typed under the name typed
+void CFilterExpressionDlg::OnSave() 
+{
+	UpdateData(true);
+
+	m_Profile.TrimLeft();
+	m_Profile.TrimRight();
+
+	if (m_Profile.IsEmpty())
+	{
+		MessageBox(_T("Type a name for the profile."), _T("Save Profile"), MB_OK | MB_ICONINFORMATION);
+		return;
+	}
+
+	if (!CheckExpression())
+	{
+		MessageBox((LPCTSTR) m_Status, _T("Invalid Expression"), MB_OK | MB_ICONWARNING);
+		return;
+	}
+
+	m_pExpression->m_Expression = (LPCTSTR) m_Expression;
+	m_pExpression->SaveProfile((LPCTSTR) m_Profile);
+
+	if (m_ProfileCtl.FindStringExact(-1, m_Profile) == CB_ERR)
+	{
+		m_ProfileCtl.AddString(m_Profile);
+	}
+
+	UpdateData(false);
+}
+
+// Deletes the profile named
+void CFilterExpressionDlg::OnDelete() 
+{
+	UpdateData(true);
+
+	int Item = m_ProfileCtl.FindStringExact(-1, m_Profile);
+
+	if (Item == CB_ERR)
+	{
+		return;
+	}
+
+	m_pExpression->DeleteProfile((LPCTSTR) m_Profile);
+
+	m_ProfileCtl.DeleteString(Item);
+
+	m_Profile = _T("");
+
+	UpdateData(false);
+}
+
+// Returns 'true' if the expression typed is valid, otherwise tells what is wrong with it
+bool CFilterExpressionDlg::CheckExpression()
+{
+	ExpressionProgram	Program;
+	String				Error;
+
+	bool Valid = CFilterExpression::Parse((LPCTSTR) m_Expression, Program, Error);
+
+	m_Status = Valid ? _T("") : Error.c_str();
+
+	SetDlgItemText(IDC_STATUS, m_Status);
+
+	return Valid;
+}
@@ -0,0 +1,56 @@
+#if !defined(AFX_CFILTEREXPRESSIONDLG_H__6A2D94E1_5C37_4B8E_A1F0_93D7C2E4B615__INCLUDED_)
+#define AFX_CFILTEREXPRESSIONDLG_H__6A2D94E1_5C37_4B8E_A1F0_93D7C2E4B615__INCLUDED_
+
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+#include "NonFSDialog.h"
+
+class CFilterExpression;
+
+class CFilterExpressionDlg : public CNonFSDialog
+{
+// Construction
+public:
+	CFilterExpressionDlg(CWnd* pParent = NULL);   // standard constructor
+
+// Dialog Data
+	//{{AFX_DATA(CFilterExpressionDlg)
+	enum { IDD = IDD_FILTER_EXPRESSION };
+	CComboBox	m_ProfileCtl;
+	CString	m_Profile;
+	CString	m_Expression;
+	CString	m_Status;
+	//}}AFX_DATA
+
+	CFilterExpression*	m_pExpression;
+
+// Overrides
+	// ClassWizard generated virtual function overrides
+	//{{AFX_VIRTUAL(CFilterExpressionDlg)
+	protected:
+	virtual void DoDataExchange(CDataExchange* pDX);    // DDX/DDV support
+	//}}AFX_VIRTUAL
+
+// Implementation
+protected:
+
+	// Generated message map functions
+	//{{AFX_MSG(CFilterExpressionDlg)
+	virtual BOOL OnInitDialog();
+	virtual void OnCancel();
+	afx_msg void OnSelchangeProfile();
+	afx_msg void OnSave();
+	afx_msg void OnDelete();
+	//}}AFX_MSG
+	DECLARE_MESSAGE_MAP()
+
+	// Returns 'true' if the expression typed is valid, otherwise tells what is wrong with it
+	bool	CheckExpression();
+};
+
+//{{AFX_INSERT_LOCATION}}
+// Microsoft Visual C++ will insert additional declarations immediately before the previous line.
+
+#endif // !defined(AFX_CFILTEREXPRESSIONDLG_H__6A2D94E1_5C37_4B8E_A1F0_93D7C2E4B615__INCLUDED_)
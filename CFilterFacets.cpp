@@ -0,0 +1,231 @@
+#include "CFilterFacets.h"
+
+CFilterFacets::CFilterFacets()
+{
+	m_Caches = 0;
+	m_Passed = 0;
+	m_TravelBugs = 0;
+
+	ZeroMemory(m_Flags, sizeof(m_Flags));
+}
+
+// Clears the counts, sized for the states and countries gathered by a predicate
+void CFilterFacets::Reset(CFilterPredicate& Predicate)
+{
+	m_Caches = 0;
+	m_Passed = 0;
+	m_TravelBugs = 0;
+
+	ZeroMemory(m_Flags, sizeof(m_Flags));
+
+	m_StateIds = Predicate.GetStateIds();
+	m_CountryIds = Predicate.GetCountryIds();
+
+	for (long Facet = 0; Facet < EndOfFacet; Facet++)
+	{
+		long Size = FACET_BITS;
+
+		if (Facet == FacetState)
+		{
+			Size = m_StateIds.size() + 1;
+		}
+		else if (Facet == FacetCountry)
+		{
+			Size = m_CountryIds.size() + 1;
+		}
+		else if (Facet == FacetDifficulty || Facet == FacetTerrain)
+		{
+			Size = FACET_RATINGS;
+		}
+
+		m_Counts[Facet].assign(Size, 0);
+		m_Totals[Facet].assign(Size, 0);
+	}
+}
+
+// Returns the value of a cache in a facet, or -1 if it is out of the range counted
+long CFilterFacets::Value(const CacheAttributes& Attr, long Facet) const
+{
+	long Value = -1;
+
+	switch (Facet)
+	{
+	case FacetType:
+		Value = Attr.Type;
+		break;
+	case FacetContainer:
+		Value = Attr.Container;
+		break;
+	case FacetBearing:
+		Value = Attr.Bearing;
+		break;
+	case FacetState:
+		Value = Attr.State;
+		break;
+	case FacetCountry:
+		Value = Attr.Country;
+		break;
+	case FacetDifficulty:
+		Value = (long) (Attr.Difficulty * 2.0f + 0.5f);
+		break;
+	case FacetTerrain:
+		Value = (long) (Attr.Terrain * 2.0f + 0.5f);
+		break;
+	}
+
+	if (Value < 0 || Value >= (long) m_Counts[Facet].size())
+	{
+		return -1;
+	}
+
+	return Value;
+}
+
+// Counts a cache in every facet for FACET_PASSED, in the facet given, or in none for FACET_REJECTED
+void CFilterFacets::Add(const CacheAttributes& Attr, BYTE Facet)
+{
+	long Index;
+
+	m_Caches++;
+	m_TravelBugs += Attr.TravelBugs;
+
+	for (Index = 0; Index < FACET_FLAGS; Index++)
+	{
+		m_Flags[Index] += (Attr.Flags >> Index) & 1;
+	}
+
+	for (Index = 0; Index < EndOfFacet; Index++)
+	{
+		long Val = Value(Attr, Index);
+
+		if (Val < 0)
+		{
+			continue;
+		}
+
+		m_Totals[Index][Val]++;
+
+		if (Facet == FACET_PASSED || Facet == Index)
+		{
+			m_Counts[Index][Val]++;
+		}
+	}
+
+	if (Facet == FACET_PASSED)
+	{
+		m_Passed++;
+	}
+}
+
+// Adds the counts of another object, reset for the same predicate
+void CFilterFacets::Merge(const CFilterFacets& Facets)
+{
+	long Index;
+
+	m_Caches += Facets.m_Caches;
+	m_Passed += Facets.m_Passed;
+	m_TravelBugs += Facets.m_TravelBugs;
+
+	for (Index = 0; Index < FACET_FLAGS; Index++)
+	{
+		m_Flags[Index] += Facets.m_Flags[Index];
+	}
+
+	for (long Facet = 0; Facet < EndOfFacet; Facet++)
+	{
+		long Size = m_Counts[Facet].size();
+
+		if (Size != (long) Facets.m_Counts[Facet].size())
+		{
+			continue;
+		}
+
+		for (Index = 0; Index < Size; Index++)
+		{
+			m_Counts[Facet][Index] += Facets.m_Counts[Facet][Index];
+			m_Totals[Facet][Index] += Facets.m_Totals[Facet][Index];
+		}
+	}
+}
+
+// Returns a count of a table, or 0 if the value is out of its range
+long CFilterFacets::Lookup(const vector<long>& Table, long Value)
+{
+	if (Value < 0 || Value >= (long) Table.size())
+	{
+		return 0;
+	}
+
+	return Table[Value];
+}
+
+// Returns the count of a value
+long CFilterFacets::GetCount(FilterFacet Facet, long Value) const
+{
+	return Lookup(m_Counts[Facet], Value);
+}
+
+// Returns the number of caches loaded with a value
+long CFilterFacets::GetTotal(FilterFacet Facet, long Value) const
+{
+	return Lookup(m_Totals[Facet], Value);
+}
+
+// Returns the count of a state or a country. A string that no cache has counts none.
+long CFilterFacets::GetStringCount(FilterFacet Facet, const String& Str) const
+{
+	const CFilterPredicate::StringIds& Ids = (Facet == FacetState) ? m_StateIds : m_CountryIds;
+
+	CFilterPredicate::citStringIds it = Ids.find(Str);
+
+	if (it == Ids.end())
+	{
+		return 0;
+	}
+
+	return GetCount(Facet, (*it).second);
+}
+
+// Returns the sum of the counts of the ratings from Min to Max
+long CFilterFacets::GetRatingCount(FilterFacet Facet, float Min, float Max) const
+{
+	long Count = 0;
+
+	for (long Index = 0; Index < (long) m_Counts[Facet].size(); Index++)
+	{
+		float Rating = Index / 2.0f;
+
+		if (Rating >= Min && Rating <= Max)
+		{
+			Count += m_Counts[Facet][Index];
+		}
+	}
+
+	return Count;
+}
+
+// Returns the number of caches loaded with a flag
+long CFilterFacets::GetFlagCount(WORD Flag) const
+{
+	for (long Index = 0; Index < FACET_FLAGS; Index++)
+	{
+		if (Flag == (1 << Index))
+		{
+			return m_Flags[Index];
+		}
+	}
+
+	return 0;
+}
+
+// Returns the name of an option followed by its count
+String CFilterFacets::Label(const TCHAR* pName, long Count)
+{
+	#define MAX_FACET_COUNT		16
+
+	TCHAR Buffer[MAX_FACET_COUNT];
+
+	_sntprintf(Buffer, MAX_FACET_COUNT, _T(" (%li)"), Count);
+
+	return String(pName) + Buffer;
+}
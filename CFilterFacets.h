@@ -0,0 +1,82 @@
+#ifndef _INC_CFilterFacets
+	#define _INC_CFilterFacets
+
+#include "CommonDefs.h"
+#include "CFilterPredicate.h"
+#include <vector>
+
+using namespace std;
+
+// Numbers of caches for each option of the filters, counted in one pass over the caches (see CFilterMgr::CountFacets()).
+// The count of an option is the number of caches with that value that pass every other filter: the test of the facet
+// the option belongs to is left out (drill sideways). A cache that passes every filter is counted in each facet, one
+// that fails the test of a single facet only in that facet, and the others in no facet.
+// For instance, the count of the Multi-cache option is the number of Multi-caches the list would show if Multi-caches
+// were enabled, whatever the other types enabled.
+// The totals of the caches loaded, whether filtered out or not, are taken along.
+class CFilterFacets
+{
+	// Values of the facets held in a DWORD of bits: types, containers and bearings
+	#define FACET_BITS			32
+	// Ratings from 0 to 5 by halves
+	#define FACET_RATINGS		11
+	// Flags of the caches (CA_xxx) in a WORD
+	#define FACET_FLAGS			16
+
+public:
+	long	m_Caches;				// Caches loaded
+	long	m_Passed;				// Caches passing every filter
+	long	m_TravelBugs;			// Travel bugs held by the caches loaded
+
+protected:
+	// Caches passing the other filters and caches loaded, by value of each facet
+	vector<long>	m_Counts[EndOfFacet];
+	vector<long>	m_Totals[EndOfFacet];
+
+	// Caches loaded with each flag, by bit
+	long			m_Flags[FACET_FLAGS];
+
+	// Numbers of the states and countries, as gathered by the filtering pass
+	CFilterPredicate::StringIds	m_StateIds;
+	CFilterPredicate::StringIds	m_CountryIds;
+
+public:
+	CFilterFacets();
+
+	// Clears the counts, sized for the states and countries gathered by a predicate
+	void	Reset(CFilterPredicate& Predicate);
+
+	// Counts a cache: in every facet for FACET_PASSED, in the facet given, or in none for FACET_REJECTED.
+	// The totals count every cache.
+	void	Add(const CacheAttributes& Attr, BYTE Facet);
+
+	// Adds the counts of another object, reset for the same predicate
+	void	Merge(const CFilterFacets& Facets);
+
+	// Returns the count of a value (GcType, GcContainer, GcBearing, number of a state or a country, or twice the rating)
+	long	GetCount(FilterFacet Facet, long Value) const;
+
+	// Returns the number of caches loaded with a value
+	long	GetTotal(FilterFacet Facet, long Value) const;
+
+	// Returns the count of a state (FacetState) or a country (FacetCountry)
+	long	GetStringCount(FilterFacet Facet, const String& Str) const;
+
+	// Returns the sum of the counts of the ratings from Min to Max (FacetDifficulty or FacetTerrain)
+	long	GetRatingCount(FilterFacet Facet, float Min, float Max) const;
+
+	// Returns the number of caches loaded with a flag (CA_xxx)
+	long	GetFlagCount(WORD Flag) const;
+
+	// Returns the name of an option followed by its count, as in "Multi-cache (312)"
+	static String	Label(const TCHAR* pName, long Count);
+
+protected:
+	// Returns the value of a cache in a facet, or -1 if it is out of the range counted
+	long	Value(const CacheAttributes& Attr, long Facet) const;
+
+	// Returns a count of a table, or 0 if the value is out of its range
+	static long	Lookup(const vector<long>& Table, long Value);
+};
+
+#endif
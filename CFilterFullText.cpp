@@ -0,0 +1,79 @@
+#include "CFilterFullText.h"
+#include "CFullTextIndex.h"
+#include <algorithm>
+
+CFilterFullText::CFilterFullText(const TCHAR* pText, GcFilter FilterType) : CFilterBase(pText, FilterType)
+{
+	m_pIndex = 0;
+	m_Searched = false;
+	m_SignedRevision = -1;
+}
+
+CFilterFullText::~CFilterFullText()
+{
+}
+
+// Sets the full text index of the loaded caches
+void CFilterFullText::SetFullTextIndex(CFullTextIndex* pIndex)
+{
+	m_pIndex = pIndex;
+}
+
+// The matches also change when the index becomes ready or is emptied
+FilterChange CFilterFullText::GetChange()
+{
+	FilterChange	Change = CFilterBase::GetChange();
+	long			Revision = m_pIndex ? m_pIndex->GetRevision() : -1;
+
+	if (Revision != m_SignedRevision)
+	{
+		Change = FilterChanged;
+	}
+
+	m_SignedRevision = Revision;
+
+	return Change;
+}
+
+void CFilterFullText::OnBeginFilter(CGpxParser& Parser)
+{
+	m_Matches.clear();
+
+	m_Searched = (m_pIndex && m_pIndex->Search(m_Query, m_Matches));
+
+	sort(m_Matches.begin(), m_Matches.end());
+}
+
+bool CFilterFullText::OnFilterCache(CGeoCache* pCache) const
+{
+	if (!m_Searched)
+	{
+		return true;
+	}
+
+	return binary_search(m_Matches.begin(), m_Matches.end(), pCache);
+}
+
+void CFilterFullText::Serialize(CStream& ar)
+{
+	#define	CFilterFullTextVersion 100
+
+	CFilterBase::Serialize(ar);
+
+	if (ar.IsStoring())
+	{
+		ar << CFilterFullTextVersion;
+		ar << m_Query;
+	}
+	else
+	{
+		int Version;
+
+		ar >> Version;
+
+		if (Version >= 100)
+		{
+			ar >> m_Query;
+		}
+	}
+}
@@ -0,0 +1,44 @@
+#ifndef _INC_CFilterFullText
+	#define _INC_CFilterFullText
+
+#include "CommonDefs.h"
+#include "CFilterMgr.h"
+#include "CGpxParser.h"
+
+class CFullTextIndex;
+
+// Keeps the caches whose descriptions, hints or logs match a query (see CFullTextIndex::Parse()).
+// The query is looked up in the full text index once per filtering pass, in OnBeginFilter(). Until the index is
+// ready, and with a query holding no word, the filter keeps every cache.
+class CFilterFullText : public CFilterBase
+{
+public:
+	String			m_Query;
+
+protected:
+	CFullTextIndex*	m_pIndex;
+
+	// Caches matching the query during a filtering pass, sorted by address, when the index was searched
+	bool			m_Searched;
+	GCCont			m_Matches;
+
+	// Revision of the index as of the previous filtering pass
+	long			m_SignedRevision;
+
+public:
+	CFilterFullText(const TCHAR* pText, GcFilter FilterType);
+	virtual ~CFilterFullText();
+
+	// Sets the full text index of the loaded caches
+	void	SetFullTextIndex(CFullTextIndex* pIndex);
+
+	virtual void	OnBeginFilter(CGpxParser& Parser);
+
+	virtual FilterChange	GetChange();
+
+	virtual bool	OnFilterCache(CGeoCache* pCache) const;
+
+	virtual void	Serialize(CStream& ar);
+};
+
+#endif
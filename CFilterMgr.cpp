@@ -1,5 +1,86 @@
 #include "CFilterMgr.h"
+#include "CFilterFacets.h"
 #include "CGpxParser.h"
+#include "CMd5.h"
+#include "CBaseException.h"
+#include <algorithm>
+#include <math.h>
+
+//------------------------------------------------------------------------------------------------------------------------
+// Running statistics of a filter
+CFilterStats::CFilterStats()
+{
+	Begin();
+
+	m_Passes = 0;
+	m_RejectRate = 0.0;
+	m_Cost = 0.0;
+}
+
+// Clears the counts before a filtering pass
+void CFilterStats::Begin()
+{
+	m_Evaluated = 0;
+	m_Rejected = 0;
+	m_Timed = 0;
+	m_Ticks = 0;
+}
+
+// Adds the counts taken by a thread
+void CFilterStats::Add(const CFilterStats& Counts)
+{
+	m_Evaluated += Counts.m_Evaluated;
+	m_Rejected += Counts.m_Rejected;
+	m_Timed += Counts.m_Timed;
+	m_Ticks += Counts.m_Ticks;
+}
+
+// Folds the counts of a filtering pass into the averages
+void CFilterStats::End(LONGLONG Frequency)
+{
+	// A pass that didn't ask about any cache tells nothing
+	if (!m_Evaluated)
+	{
+		return;
+	}
+
+	double RejectRate = (double) m_Rejected / m_Evaluated;
+	double Cost = m_Cost;
+
+	if (m_Timed && Frequency)
+	{
+		Cost = (double) m_Ticks * 1000000.0 / (double) Frequency / m_Timed;
+	}
+
+	// The first pass sets the averages, the following ones move them towards their own figures
+	if (m_Passes)
+	{
+		RejectRate = m_RejectRate + (RejectRate - m_RejectRate) * FILTER_STATS_WEIGHT;
+		Cost = m_Cost + (Cost - m_Cost) * FILTER_STATS_WEIGHT;
+	}
+
+	m_RejectRate = RejectRate;
+	m_Cost = Cost;
+	m_Passes++;
+}
+
+// Returns the cost per cache rejected, in microseconds
+double CFilterStats::GetRank()
+{
+	// Not measured yet: give it a chance to show what it does
+	if (!m_Passes)
+	{
+		return 0.0;
+	}
+
+	// Never rejects anything: it may as well come last
+	if (m_RejectRate <= 0.0)
+	{
+		return HUGE_VAL;
+	}
+
+	return m_Cost / m_RejectRate;
+}
 
 //------------------------------------------------------------------------------------------------------------------------
 // Base class for filters. Derived classes must implement the OnFilterCache() function.
@@ -28,19 +109,19 @@ void CFilterBase::Enable(bool Switch)
 }
 
 // Returns 'true' if the filter is enabled.
-bool CFilterBase::IsEnabled()
+bool CFilterBase::IsEnabled() const
 {
 	return m_Enabled;
 }
 
 // Returns the name of the filter
-String CFilterBase::GetName()
+String CFilterBase::GetName() const
 {
 	return m_Name;
 }
 
 // Returns the type of the filter
-GcFilter CFilterBase::GetType()
+GcFilter CFilterBase::GetType() const
 {
 	return m_Type;
 }
@@ -57,6 +138,75 @@ void* CFilterBase::GetData()
 	return m_pData;
 }
 
+// Called once before the caches are run through the filter, when it is enabled.
+void CFilterBase::OnBeginFilter(CGpxParser& Parser)
+{
+}
+
+// Folds the settings of the filter into the compiled test of a filtering pass
+bool CFilterBase::Compile(CFilterPredicate& Predicate)
+{
+	return false;
+}
+
+// Tells how the settings of the filter changed since the previous call
+FilterChange CFilterBase::GetChange()
+{
+	String Signature = Sign();
+
+	FilterChange Change = (Signature == m_Signature) ? FilterSame : FilterChanged;
+
+	m_Signature = Signature;
+
+	return Change;
+}
+
+// Forgets the kept results that a change of the settings may have turned
+void CFilterBase::ForgetResults(FilterChange Change)
+{
+	if (Change == FilterSame)
+	{
+		return;
+	}
+
+	// A narrower setting still rejects what it rejected, a wider one still passes what it passed
+	BYTE Kept = FILTER_RESULT_UNKNOWN;
+
+	if (Change == FilterNarrower)
+	{
+		Kept = FILTER_RESULT_REJECTED;
+	}
+	else if (Change == FilterWider)
+	{
+		Kept = FILTER_RESULT_PASSED;
+	}
+
+	for (vector<BYTE>::iterator it = m_Results.begin(); it != m_Results.end(); it++)
+	{
+		if (*it != Kept)
+		{
+			*it = FILTER_RESULT_UNKNOWN;
+		}
+	}
+}
+
+// Returns the MD5 hash of the serialized settings of the filter
+String CFilterBase::Sign()
+{
+	CStream	ar;
+	CMd5	Md5;
+	DWORD	Size = 0;
+	TCHAR*	pBuffer = 0;
+
+	ar.SetStoring(true);
+
+	Serialize(ar);
+
+	ar.Pack(Size, &pBuffer);
+
+	return Md5.Hash((BYTE*) pBuffer, Size);
+}
+
 void CFilterBase::Serialize(CStream& ar)
 {
 	#define	CFilterBaseVersion 100
@@ -99,6 +249,14 @@ void CFilterBase::Serialize(CStream& ar)
 CFilterMgr::CFilterMgr()
 {
 	m_pFilterResults = 0;
+	m_NextChunk = 0;
+
+	SYSTEM_INFO	Info;
+
+	// One thread per processor
+	GetSystemInfo(&Info);
+
+	SetThreadCount(Info.dwNumberOfProcessors);
 }
 
 CFilterMgr::~CFilterMgr()
@@ -182,50 +340,448 @@ CFilterBase* CFilterMgr::Find(GcFilter Filter)
 }
 
 // Method used to run the caches through the filters.
+// The enabled filters are compiled again on every call, since this is when their settings may have changed.
+// The compiled test comes first, as it is the cheapest. The other filters follow in the order of their rank,
+// and a cache rejected by one of them isn't shown to the next ones.
+// The filters that aren't compiled keep their results between the passes: a filter is only asked about
+// the caches it wasn't asked about yet, or whose result a change of its settings may have turned.
 void CFilterMgr::Filter(CGpxParser& Parser)
 {
-	itGC C;
+	itFilter		F;
+	LARGE_INTEGER	Frequency;
 
+	if (!QueryPerformanceFrequency(&Frequency))
+	{
+		Frequency.QuadPart = 0;
+	}
 
-	CGeoCache* pCache = Parser.First(C);
+	m_Predicate.Gather(Parser);
+	m_Predicate.Reset();
 
-	while (!Parser.EndOfCacheList(C))
+	// The kept results are about other caches
+	if (m_Predicate.GetCaches() != m_KeptCaches)
 	{
-		int Results = 0;
+		Invalidate();
+	}
 
-		// Run the cache through the filters...
-		for (itFilter I = m_Filters.begin(); I != m_Filters.end(); I++)
+	m_Others.clear();
+
+	for (F = m_Filters.begin(); F != m_Filters.end(); F++)
+	{
+		if (!(*F)->IsEnabled())
+		{
+			continue;
+		}
+
+		// Filters that can't be compiled are asked about the caches that pass the compiled ones
+		if ((*F)->Compile(m_Predicate))
+		{
+			(*F)->OnBeginFilter(Parser);
+		}
+		else
+		{
+			m_Others.push_back(*F);
+		}
+	}
+
+	long	Count = m_Predicate.GetCacheCount();
+	long	Index;
+
+	for (F = m_Others.begin(); F != m_Others.end(); F++)
+	{
+		FilterChange Change = (*F)->GetChange();
+
+		if ((*F)->m_Results.size() != Count)
+		{
+			(*F)->m_Results.assign(Count, FILTER_RESULT_UNKNOWN);
+
+			Change = FilterChanged;
+		}
+
+		(*F)->ForgetResults(Change);
+
+		if (Change != FilterSame)
+		{
+			(*F)->OnBeginFilter(Parser);
+		}
+
+		(*F)->m_Stats.Begin();
+	}
+
+	OrderFilters(m_Others);
+
+	m_CompiledStats.Begin();
+
+	m_Passed.resize(Count);
+	m_NextChunk = 0;
+
+	FilterWorker	Workers[FILTER_MAX_THREADS];
+	long			Chunks = (Count + FILTER_CHUNK_SIZE - 1) / FILTER_CHUNK_SIZE;
+	long			Running = (m_Threads < Chunks) ? m_Threads : Chunks;
+
+	for (Index = 0; Index < Running; Index++)
+	{
+		Workers[Index].pMgr = this;
+		Workers[Index].Stats.resize(m_Others.size());
+		Workers[Index].pFacets = NULL;
+	}
+
+	RunWorkers(Workers, Running);
+
+	for (Index = 0; Index < Running; Index++)
+	{
+		m_CompiledStats.Add(Workers[Index].Compiled);
+
+		for (long Other = 0; Other < m_Others.size(); Other++)
+		{
+			m_Others[Other]->m_Stats.Add(Workers[Index].Stats[Other]);
+		}
+	}
+
+	// Declare the caches as 'in scope (visible)' in the list, or exclude them
+	for (Index = 0; Index < Count; Index++)
+	{
+		m_Predicate.GetCache(Index)->m_InScope = (m_Passed[Index] != 0);
+	}
+
+	m_CompiledStats.End(Frequency.QuadPart);
+
+	for (F = m_Others.begin(); F != m_Others.end(); F++)
+	{
+		(*F)->m_Stats.End(Frequency.QuadPart);
+	}
+
+	m_KeptCaches = m_Predicate.GetCaches();
+}
+
+// Counts the caches of each option of the filters given the other filters, as of the last filtering pass.
+// The compiled test tells for each cache whether it passes, or which facet alone filters it out: the filters that
+// aren't compiled are then only asked about these caches, and their answers are kept for the next passes.
+// The filters that aren't compiled, such as the search, have no facet of their own.
+void CFilterMgr::CountFacets(CGpxParser& Parser, CFilterFacets& Facets)
+{
+	// Other caches were loaded since the last pass: none of them was filtered yet
+	if (m_Predicate.GetCacheCount() != Parser.CacheCount())
+	{
+		m_Predicate.Gather(Parser);
+		m_Predicate.Reset();
+
+		m_Others.clear();
+	}
+
+	long			Count = m_Predicate.GetCacheCount();
+	FilterWorker	Workers[FILTER_MAX_THREADS];
+	CFilterFacets	Counts[FILTER_MAX_THREADS];
+	long			Chunks = (Count + FILTER_CHUNK_SIZE - 1) / FILTER_CHUNK_SIZE;
+	long			Running = (m_Threads < Chunks) ? m_Threads : Chunks;
+	long			Index;
+
+	Facets.Reset(m_Predicate);
+
+	m_Passed.resize(Count);
+	m_NextChunk = 0;
+
+	for (Index = 0; Index < Running; Index++)
+	{
+		Counts[Index].Reset(m_Predicate);
+
+		Workers[Index].pMgr = this;
+		Workers[Index].pFacets = &Counts[Index];
+	}
+
+	RunWorkers(Workers, Running);
+
+	for (Index = 0; Index < Running; Index++)
+	{
+		Facets.Merge(Counts[Index]);
+	}
+}
+
+// Runs the workers, in threads of their own unless there is a single one, and waits for them to finish
+void CFilterMgr::RunWorkers(FilterWorker* pWorkers, long Running)
+{
+	HANDLE	Threads[FILTER_MAX_THREADS];
+	long	Index;
+
+	for (Index = 0; Index < Running; Index++)
+	{
+		Threads[Index] = NULL;
+
+		// A single thread might as well be the calling one
+		if (Running == 1)
+		{
+			Work(pWorkers[Index]);
+			continue;
+		}
+
+		DWORD ThreadId = 0;
+
+		Threads[Index] = CreateThread(NULL, 0, ThreadProc, (LPVOID) &pWorkers[Index], 0, &ThreadId);
+
+		if (Threads[Index] == NULL)
+		{
+			CBaseException Up;
+
+			Up.m_szSrc = _T("CFilterMgr::RunWorkers()");
+			Up.m_szMsg = _T("Failed to create a thread! The caches will be looked at by the calling thread.");
+			Up.Win32Error();
+			Up.Log();
+
+			Work(pWorkers[Index]);
+		}
+	}
+
+	for (Index = 0; Index < Running; Index++)
+	{
+		if (Threads[Index])
+		{
+			WaitForSingleObject(Threads[Index], INFINITE);
+			CloseHandle(Threads[Index]);
+		}
+	}
+}
+
+// Thread entry point
+DWORD WINAPI CFilterMgr::ThreadProc(LPVOID pParam)
+{
+	FilterWorker* pWorker = (FilterWorker*) pParam;
+
+	pWorker->pMgr->Work(*pWorker);
+
+	return 0;
+}
+
+// Evaluates the chunks of caches left, until there are none
+void CFilterMgr::Work(FilterWorker& Worker)
+{
+	long Count = m_Passed.size();
+
+	for (;;)
+	{
+		long First = (InterlockedIncrement(&m_NextChunk) - 1) * FILTER_CHUNK_SIZE;
+
+		if (First >= Count)
+		{
+			break;
+		}
+
+		long Last = (First + FILTER_CHUNK_SIZE < Count) ? First + FILTER_CHUNK_SIZE : Count;
+
+		if (Worker.pFacets)
 		{
-			// If the filter isn't active, just add one to result as if the filter evaluated to 'true'
-			if (!(*I)->IsEnabled())
+			CountChunk(First, Last, Worker);
+		}
+		else
+		{
+			EvaluateChunk(First, Last, Worker);
+		}
+	}
+}
+
+// Evaluates the filters over the caches First to Last - 1
+void CFilterMgr::EvaluateChunk(long First, long Last, FilterWorker& Worker)
+{
+	LARGE_INTEGER	Start, End;
+	long			Others = m_Others.size();
+	long			Other;
+
+	QueryPerformanceCounter(&Start);
+
+	m_Predicate.Evaluate(m_Passed, First, Last);
+
+	QueryPerformanceCounter(&End);
+
+	Worker.Compiled.m_Evaluated += Last - First;
+	Worker.Compiled.m_Timed += Last - First;
+	Worker.Compiled.m_Ticks += End.QuadPart - Start.QuadPart;
+
+	for (long Index = First; Index < Last; Index++)
+	{
+		CGeoCache*	pCache = m_Predicate.GetCache(Index);
+		bool		InScope = (m_Passed[Index] != 0);
+		bool		Timed = (Index % FILTER_TIMING_SAMPLE == 0);
+
+		if (!InScope)
+		{
+			Worker.Compiled.m_Rejected++;
+		}
+
+		// A kept rejection saves asking the other filters
+		for (Other = 0; InScope && Other < Others; Other++)
+		{
+			InScope = (m_Others[Other]->m_Results[Index] != FILTER_RESULT_REJECTED);
+		}
+
+		for (Other = 0; InScope && Other < Others; Other++)
+		{
+			const CFilterBase*	pFilter = m_Others[Other];
+			BYTE&				Result = m_Others[Other]->m_Results[Index];
+			CFilterStats&		Stats = Worker.Stats[Other];
+
+			if (Result != FILTER_RESULT_UNKNOWN)
 			{
-				Results++;
+				continue;
 			}
-			else
+
+			if (Timed)
 			{
-				// If the filter evaluated to 'true' increment the count for the result
-				if ((*I)->OnFilterCache(pCache))
-				{
-					Results++;
-				}
+				QueryPerformanceCounter(&Start);
 			}
-		}
 
-		// If the count in the results matches the number of filters, all the filters evaluated to 'true' and the cache should be part of the result set.
-		// Otherwise, the cache needs to be excluded.
-		if (Results != m_Filters.size())
-		{
-			pCache->m_InScope = false;
+			InScope = pFilter->OnFilterCache(pCache);
+
+			Result = InScope ? FILTER_RESULT_PASSED : FILTER_RESULT_REJECTED;
+
+			if (Timed)
+			{
+				QueryPerformanceCounter(&End);
+
+				Stats.m_Ticks += End.QuadPart - Start.QuadPart;
+				Stats.m_Timed++;
+			}
+
+			Stats.m_Evaluated++;
+
+			if (!InScope)
+			{
+				Stats.m_Rejected++;
+			}
 		}
-		else
+
+		m_Passed[Index] = InScope;
+	}
+}
+
+// Counts the facets of the caches First to Last - 1. Only the caches that pass the compiled test, or that a single
+// facet filters out, are shown to the other filters.
+void CFilterMgr::CountChunk(long First, long Last, FilterWorker& Worker)
+{
+	BYTE	Facets[PREDICATE_BLOCK];
+	long	Count = m_Passed.size();
+	long	Others = m_Others.size();
+	long	Other;
+
+	for (long Block = First; Block < Last; Block += PREDICATE_BLOCK)
+	{
+		long End = (Block + PREDICATE_BLOCK < Last) ? Block + PREDICATE_BLOCK : Last;
+
+		m_Predicate.Sideways(Facets, Block, End);
+
+		for (long Index = Block; Index < End; Index++)
 		{
-			// Declare the cache as 'in scope (visible)' in the list
-			pCache->m_InScope = true;
+			BYTE& Facet = Facets[Index - Block];
+
+			// A kept rejection saves asking the other filters
+			for (Other = 0; Facet != FACET_REJECTED && Other < Others; Other++)
+			{
+				const vector<BYTE>& Results = m_Others[Other]->m_Results;
+
+				if (Results.size() == Count && Results[Index] == FILTER_RESULT_REJECTED)
+				{
+					Facet = FACET_REJECTED;
+				}
+			}
+
+			for (Other = 0; Facet != FACET_REJECTED && Other < Others; Other++)
+			{
+				if (!Passes(m_Others[Other], Index))
+				{
+					Facet = FACET_REJECTED;
+				}
+			}
+
+			Worker.pFacets->Add(m_Predicate.GetAttributes(Index), Facet);
 		}
+	}
+}
+
+// Returns 'true' if a filter that isn't compiled passes a cache. The answer is kept, unless the filter forgot its
+// results since the last filtering pass.
+bool CFilterMgr::Passes(CFilterBase* pFilter, long Index)
+{
+	CGeoCache* pCache = m_Predicate.GetCache(Index);
+
+	if (pFilter->m_Results.size() != m_Passed.size())
+	{
+		return pFilter->OnFilterCache(pCache);
+	}
+
+	BYTE& Result = pFilter->m_Results[Index];
+
+	if (Result == FILTER_RESULT_UNKNOWN)
+	{
+		Result = pFilter->OnFilterCache(pCache) ? FILTER_RESULT_PASSED : FILTER_RESULT_REJECTED;
+	}
 
-		pCache = Parser.Next(C);
+	return (Result == FILTER_RESULT_PASSED);
+}
+
+// Sets the number of threads evaluating the filters, from 1 to FILTER_MAX_THREADS
+void CFilterMgr::SetThreadCount(long Threads)
+{
+	if (Threads < 1)
+	{
+		Threads = 1;
 	}
 
+	if (Threads > FILTER_MAX_THREADS)
+	{
+		Threads = FILTER_MAX_THREADS;
+	}
+
+	m_Threads = Threads;
+}
+
+// Returns the number of threads evaluating the filters
+long CFilterMgr::GetThreadCount()
+{
+	return m_Threads;
+}
+
+#ifdef _DEBUG
+// Returns the time in milliseconds of a filtering pass that keeps no result from the previous ones
+DWORD CFilterMgr::Benchmark(CGpxParser& Parser, long Threads)
+{
+	long Saved = m_Threads;
+
+	SetThreadCount(Threads);
+
+	Invalidate();
+
+	DWORD Start = GetTickCount();
+
+	Filter(Parser);
+
+	DWORD Elapsed = GetTickCount() - Start;
+
+	SetThreadCount(Saved);
+
+	return Elapsed;
+}
+#endif
+
+// Forgets the results kept by the filters
+void CFilterMgr::Invalidate()
+{
+	for (itFilter F = m_Filters.begin(); F != m_Filters.end(); F++)
+	{
+		(*F)->m_Results.clear();
+	}
+
+	m_KeptCaches.clear();
+}
+
+// Orders the filters by rank, the ones most likely to reject a cache for the least time first.
+// This is the best order for filters that reject the caches independently of each other.
+void CFilterMgr::OrderFilters(Filters& Order)
+{
+	stable_sort(Order.begin(), Order.end(), RanksBefore);
+}
+
+// Compares the rank of two filters
+bool CFilterMgr::RanksBefore(CFilterBase* pLeft, CFilterBase* pRight)
+{
+	return pLeft->m_Stats.GetRank() < pRight->m_Stats.GetRank();
 }
 
 // Returns the # of filters present in this filter manager
@@ -294,6 +850,12 @@ void CFilterMgr::Serialize(CStream& ar)
 	}
 }
 
+// Returns the statistics of the compiled filters, taken as a whole
+CFilterStats& CFilterMgr::GetCompiledStats()
+{
+	return m_CompiledStats;
+}
+
 // Returns the # of filters that are currently active
 int	CFilterMgr::GetEnabledFilterCount()
 {
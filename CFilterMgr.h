@@ -3,6 +3,7 @@
 
 #include "CommonDefs.h"
 #include "CStream.h"
+#include "CFilterPredicate.h"
 
 // Main filters
 typedef enum {
@@ -15,12 +16,65 @@ typedef enum {
 	FilterSearch,
 	FilterRatings,
 	FilterTravelBugs,
+	FilterCorridor,
+	FilterFullText,
+	FilterExpression,
 	//FilterSuccessRatio,
 	EndOfGcFilter
 	} GcFilter;
 
 class CGeoCache;
 class CFilterMgr;
+class CGpxParser;
+class CFilterFacets;
+
+// One cache out of FILTER_TIMING_SAMPLE has its filters timed
+#define FILTER_TIMING_SAMPLE	16
+// Weight of the last pass in the averages of the statistics
+#define FILTER_STATS_WEIGHT		0.5
+
+// Results of a filter for a cache, kept between the filtering passes
+#define FILTER_RESULT_UNKNOWN	0
+#define FILTER_RESULT_PASSED	1
+#define FILTER_RESULT_REJECTED	2
+
+// How the settings of a filter changed since the previous filtering pass
+typedef enum {
+	FilterSame = 0,		// The kept results still hold
+	FilterNarrower,		// Only caches that passed may now be rejected
+	FilterWider,		// Only caches that were rejected may now pass
+	FilterChanged		// Any result may change
+	} FilterChange;
+
+// Running statistics of a filter: how many caches it rejects and how long it takes to ask it about a cache.
+// The counts are taken during a filtering pass, then folded into averages that follow the changes of the
+// settings of the filter and of the caches loaded.
+class CFilterStats
+{
+public:
+	long		m_Evaluated;	// Caches asked about during the last pass
+	long		m_Rejected;		// Caches rejected during the last pass
+	long		m_Timed;		// Calls timed during the last pass
+	LONGLONG	m_Ticks;		// Time spent in the timed calls, in performance counter ticks
+	long		m_Passes;		// Passes averaged so far
+	double		m_RejectRate;	// Share of the caches rejected, averaged over the passes
+	double		m_Cost;			// Microseconds per cache, averaged over the passes
+
+public:
+	CFilterStats();
+
+	// Clears the counts before a filtering pass
+	void	Begin();
+
+	// Adds the counts taken by a thread
+	void	Add(const CFilterStats& Counts);
+
+	// Folds the counts of a filtering pass into the averages
+	void	End(LONGLONG Frequency);
+
+	// Returns the cost per cache rejected, in microseconds
+	double	GetRank();
+};
 
 // Base class for filters. Derived classes must implement the OnFilterCache() function.
 class CFilterBase
@@ -28,12 +82,21 @@ class CFilterBase
 public:
 	CFilterMgr*		m_pFilterMgr;
 
+	// Statistics of the filter, kept when it isn't compiled (see Compile())
+	CFilterStats	m_Stats;
+
+	// Results of the filter for each cache (FILTER_RESULT_xxx), kept when it isn't compiled
+	vector<BYTE>	m_Results;
+
 protected:
 	String			m_Name;
 	bool			m_Enabled;
 	GcFilter		m_Type;
 	void*			m_pData;
 
+	// MD5 hash of the settings as of the previous filtering pass
+	String			m_Signature;
+
 public:
 	CFilterBase(const TCHAR* pText, GcFilter FilterType);
 	virtual ~CFilterBase();
@@ -42,13 +105,13 @@ public:
 	void		Enable(bool Switch);
 
 	// Returns 'true' if the filter is enabled.
-	bool		IsEnabled();
+	bool		IsEnabled() const;
 
 	// Returns the name of the filter
-	String		GetName();
+	String		GetName() const;
 
 	// Returns the type of the filter
-	GcFilter	GetType();
+	GcFilter	GetType() const;
 
 	// Set the data pointer
 	void		SetData(void* pData);
@@ -56,11 +119,32 @@ public:
 	// Get the data pointer
 	void*		GetData();
 
+	// Called once before the caches are run through the filter, when it is enabled.
+	// Filters that look at the caches as a whole can work out their result here.
+	// A filter that isn't compiled is only called when its kept results don't all hold (see GetChange()).
+	virtual void OnBeginFilter(CGpxParser& Parser);
+
+	// Tells how the settings of the filter changed since the previous call. The default compares the
+	// MD5 hash of the serialized settings: filters that can tell a narrower or wider setting apart override it.
+	virtual FilterChange GetChange();
+
+	// Forgets the kept results that a change of the settings may have turned
+	void		ForgetResults(FilterChange Change);
+
+	// Folds the settings of the filter into the compiled test of a filtering pass and returns 'true'.
+	// Filters that can't be expressed over the packed attributes of a cache return 'false' (the default):
+	// OnFilterCache() is then called for each cache that passes the compiled test.
+	virtual bool Compile(CFilterPredicate& Predicate);
+
 	// Determines if the cache is being 'disabled' by the filter.
 	// Return 'false' to filter a cache out of the list.
-	virtual bool OnFilterCache(CGeoCache* pCache) = 0;
+	virtual bool OnFilterCache(CGeoCache* pCache) const = 0;
 
 	virtual void Serialize(CStream& ar);
+
+protected:
+	// Returns the MD5 hash of the serialized settings of the filter
+	String		Sign();
 };
 
 typedef vector<CFilterBase*> Filters;
@@ -71,12 +155,45 @@ class CGpxParser;
 // Manages the cache filters. When filters are applied to caches, the Filter() function
 // examines each cache and 'enables' or 'disables' it according to the filtering rules
 // implemented in classes derived from CFilterBase
+// The caches are evaluated by a few threads, which take chunks of FILTER_CHUNK_SIZE caches in turn until none
+// is left: a thread slowed down by expensive caches takes fewer chunks. The threads only write the results of
+// the caches of their chunks, and the filters are called through their 'const' interface.
+// CountFacets() hands the chunks to the threads the same way, each thread counting the caches of its chunks apart.
 class CFilterMgr
 {
+	// Largest number of threads evaluating the filters
+	#define FILTER_MAX_THREADS		8
+	// Caches handed to a thread at a time
+	#define FILTER_CHUNK_SIZE		256
+
+	// Parameters and counts of a thread
+	typedef struct {
+		CFilterMgr*				pMgr;
+		CFilterStats			Compiled;
+		vector<CFilterStats>	Stats;
+		CFilterFacets*			pFacets;	// Not null when the thread counts the facets rather than filtering
+	} FilterWorker;
+
 protected:
 	Filters			m_Filters;
 	bool*			m_pFilterResults;
 
+	// The enabled filters compiled into a single test
+	CFilterPredicate	m_Predicate;
+	CFilterStats		m_CompiledStats;
+
+	// The caches the kept results of the filters are about
+	vector<CGeoCache*>	m_KeptCaches;
+
+	// Number of threads evaluating the filters
+	long				m_Threads;
+
+	// State of a filtering pass, shared by the threads: the filters that aren't compiled in the order they are
+	// asked, the result of each cache and the next chunk to evaluate
+	Filters				m_Others;
+	vector<BYTE>		m_Passed;
+	LONG				m_NextChunk;
+
 public:
 	CFilterMgr();
 	~CFilterMgr();
@@ -95,6 +212,14 @@ public:
 	// Method used to run the caches through the filters.
 	void			Filter(CGpxParser& Parser);
 
+	// Counts the caches of each option of the filters given the other filters, as of the last filtering pass
+	// (see CFilterFacets). Caches loaded since are counted as if no filter was enabled.
+	void			CountFacets(CGpxParser& Parser, CFilterFacets& Facets);
+
+	// Forgets the results kept by the filters. Must be called when the caches change in ways
+	// the filters that aren't compiled look at (other caches loaded, names or coordinates edited).
+	void			Invalidate();
+
 	// Returns the # of filters present in this filter manager
 	long			Size();
 
@@ -103,9 +228,48 @@ public:
 	// Returns the # of filters that are currently active
 	int				GetEnabledFilterCount();
 
+	// Returns the statistics of the compiled filters, taken as a whole
+	CFilterStats&	GetCompiledStats();
+
+	// Sets the number of threads evaluating the filters, from 1 to FILTER_MAX_THREADS
+	void			SetThreadCount(long Threads);
+
+	// Returns the number of threads evaluating the filters
+	long			GetThreadCount();
+
+#ifdef _DEBUG
+	// Returns the time in milliseconds of a filtering pass that keeps no result from the previous ones.
+	// The pass sets the caches in scope again: the list must be refreshed afterwards.
+	DWORD			Benchmark(CGpxParser& Parser, long Threads);
+#endif
+
 protected:
 	// Cleanup of filters
 	void			Reset();
+
+	// Orders the filters by rank, the ones most likely to reject a cache for the least time first
+	static void		OrderFilters(Filters& Order);
+
+	// Compares the rank of two filters
+	static bool		RanksBefore(CFilterBase* pLeft, CFilterBase* pRight);
+
+	// Thread entry point
+	static DWORD WINAPI	ThreadProc(LPVOID pParam);
+
+	// Evaluates the chunks of caches left, until there are none
+	void			Work(FilterWorker& Worker);
+
+	// Evaluates the filters over the caches First to Last - 1
+	void			EvaluateChunk(long First, long Last, FilterWorker& Worker);
+
+	// Counts the facets of the caches First to Last - 1
+	void			CountChunk(long First, long Last, FilterWorker& Worker);
+
+	// Returns 'true' if a filter that isn't compiled passes a cache, asking it if its result isn't kept
+	bool			Passes(CFilterBase* pFilter, long Index);
+
+	// Runs the workers, in threads of their own unless there is a single one, and waits for them to finish
+	void			RunWorkers(FilterWorker* pWorkers, long Running);
 };
 
 #endif
\ No newline at end of file
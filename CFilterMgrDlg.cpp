@@ -7,6 +7,10 @@
 #include "CFilterCacheListsDlg.h"
 #include "CFilterStringsDlg.h"
 #include "CFilterRatingsDlg.h"
+#include "CFilterCorridorDlg.h"
+#include "CFilterExpressionDlg.h"
+#include "CFilterFullText.h"
+#include "CLineEditDlg.h"
 #include "CFilterOnStrings.h"
 #include "CSearchDlg.h"
 #include "CGpxParser.h"
@@ -22,6 +26,8 @@ CFilterMgrDlg::CFilterMgrDlg(CWnd* pParent) : CNonFSDialog(CFilterMgrDlg::IDD, p
 	//{{AFX_DATA_INIT(CFilterMgrDlg)
 		// NOTE: the ClassWizard will add member initialization here
 	//}}AFX_DATA_INIT
+
+	m_Counted = false;
 }
 
 CFilterMgrDlg::~CFilterMgrDlg()
@@ -134,6 +140,15 @@ void CFilterMgrDlg::OnDblclkTree(NMHDR* pNMHDR, LRESULT* pResult)
 	case FilterRatings:
 		OnRatings();
 		break;
+	case FilterCorridor:
+		OnCorridor();
+		break;
+	case FilterFullText:
+		OnFullText();
+		break;
+	case FilterExpression:
+		OnExpression();
+		break;
 	case FilterTravelBugs:
 		MessageBox(_T("This filter has no configurable parameters."), _T("Toggle Filter"), MB_OK | MB_ICONINFORMATION);
 		break;
@@ -149,6 +164,7 @@ void CFilterMgrDlg::OnCacheTypes()
 	CFilterCacheTypesDlg Dlg;
 
 	Dlg.m_pTypes = (CFilterCacheTypes*) pFilterMgr->Find(FilterCacheTypes);
+	Dlg.m_pFacets = GetFacets();
 
 	Dlg.DoModal();
 }
@@ -160,6 +176,7 @@ void CFilterMgrDlg::OnContainerTypes()
 	CFilterContainersDlg Dlg;
 
 	Dlg.m_pConts = (CFilterCacheContainers*) pFilterMgr->Find(FilterContainerTypes);
+	Dlg.m_pFacets = GetFacets();
 
 	Dlg.DoModal();
 }
@@ -194,6 +211,8 @@ void CFilterMgrDlg::OnStateList()
 	CFilterStringsDlg Dlg;
 
 	Dlg.m_pFiltStrs = (CFilterOnStrings*) pFilterMgr->Find(FilterStateList);
+	Dlg.m_pFacets = GetFacets();
+	Dlg.m_Facet = FacetState;
 
 	Dlg.m_pFiltStrs->Update(pGP->m_StateList);
 
@@ -208,6 +227,8 @@ void CFilterMgrDlg::OnCountryList()
 	CFilterStringsDlg Dlg;
 
 	Dlg.m_pFiltStrs = (CFilterOnStrings*) pFilterMgr->Find(FilterCountryList);
+	Dlg.m_pFacets = GetFacets();
+	Dlg.m_Facet = FacetCountry;
 
 	Dlg.m_pFiltStrs->Update(pGP->m_CountryList);
 
@@ -232,10 +253,71 @@ void CFilterMgrDlg::OnRatings()
 	CFilterRatingsDlg Dlg;
 
 	Dlg.m_pRatings = (CFilterCacheRatings*) pFilterMgr->Find(FilterRatings);
+	Dlg.m_pFacets = GetFacets();
+
+	Dlg.DoModal();
+}
+
+void CFilterMgrDlg::OnCorridor()
+{
+	CFilterMgr* pFilterMgr = ((CGpxSonarApp*) AfxGetApp())->m_pFilterMgr;
+
+	CFilterCorridorDlg Dlg;
+
+	Dlg.m_pCorridor = (CFilterCorridor*) pFilterMgr->Find(FilterCorridor);
+
+	Dlg.DoModal();
+}
+
+void CFilterMgrDlg::OnFullText()
+{
+	CFilterMgr* pFilterMgr = ((CGpxSonarApp*) AfxGetApp())->m_pFilterMgr;
+
+	CFilterFullText* pFullText = (CFilterFullText*) pFilterMgr->Find(FilterFullText);
+
+	CLineEditDlg Dlg;
+
+	// Words must all be found, unless OR joins them, and "quoted words" must follow each other
+	Dlg.m_Title = _T("Words, \"Phrase\", OR");
+	Dlg.m_Text = pFullText->m_Query.c_str();
+
+	if (Dlg.DoModal() == IDOK)
+	{
+		pFullText->m_Query = (LPCTSTR) Dlg.m_Text;
+	}
+}
+
+void CFilterMgrDlg::OnExpression()
+{
+	CFilterMgr* pFilterMgr = ((CGpxSonarApp*) AfxGetApp())->m_pFilterMgr;
+
+	CFilterExpressionDlg Dlg;
+
+	Dlg.m_pExpression = (CFilterExpression*) pFilterMgr->Find(FilterExpression);
 
 	Dlg.DoModal();
 }
 
+// Returns the counts of the options of the filters, counting them the first time
+CFilterFacets* CFilterMgrDlg::GetFacets()
+{
+	if (!m_Counted)
+	{
+		CFilterMgr* pFilterMgr = ((CGpxSonarApp*) AfxGetApp())->m_pFilterMgr;
+		CGpxParser* pGP = ((CGpxSonarApp*) AfxGetApp())->m_pGpxParser;
+
+		BeginWaitCursor();
+
+		pFilterMgr->CountFacets(*pGP, m_Facets);
+
+		EndWaitCursor();
+
+		m_Counted = true;
+	}
+
+	return &m_Facets;
+}
+
 void CFilterMgrDlg::OnOK() 
 {
 	CFilterMgr* pFilterMgr = ((CGpxSonarApp*) AfxGetApp())->m_pFilterMgr;
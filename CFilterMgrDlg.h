@@ -7,6 +7,7 @@
 
 #include "NonFSDialog.h"
 #include "CFilterMgr.h"
+#include "CFilterFacets.h"
 
 class CFilterMgrDlg : public CNonFSDialog
 {
@@ -33,6 +34,11 @@ public:
 protected:
 	CImageList	m_ImageList;
 
+	// Counts of the options of the filters, taken when a filter dialog first shows them. The filters are only
+	// applied when this dialog closes: the counts hold until then.
+	CFilterFacets	m_Facets;
+	bool			m_Counted;
+
 	// Generated message map functions
 	//{{AFX_MSG(CFilterMgrDlg)
 	virtual BOOL OnInitDialog();
@@ -54,6 +60,12 @@ protected:
 	void OnCountryList();
 	void OnSearch();
 	void OnRatings();
+	void OnCorridor();
+	void OnFullText();
+	void OnExpression();
+
+	// Returns the counts of the options of the filters, counting them the first time
+	CFilterFacets* GetFacets();
 };
 
 //{{AFX_INSERT_LOCATION}}
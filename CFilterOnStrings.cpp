@@ -1,4 +1,5 @@
 #include "CFilterOnStrings.h"
+#include "CSchema.h"
 #include "CGpxParser.h"
 
 //------------------------------------------------------------------------------------------------------------------------
@@ -9,26 +10,12 @@ CFilteredString::CFilteredString()
 
 void CFilteredString::Serialize(CStream& ar)
 {
-	#define CFilteredStringVersion 100
+	CSchema Schema;
 
-	if (ar.IsStoring())
-	{
-		ar << CFilteredStringVersion;
-		ar << m_Str;
-		ar << m_Enabled;
-	}
-	else
-	{
-		int Version;
-
-		ar >> Version;
+	Schema.Add(m_Str, 100);
+	Schema.Add(m_Enabled, 100);
 
-		if (Version >= 100)
-		{
-			ar >> m_Str;
-			ar >> m_Enabled;
-		}
-	}
+	Schema.Serialize(ar);
 }
 
 //------------------------------------------------------------------------------------------------------------------------
@@ -87,9 +74,9 @@ void CFilterOnStrings::Delete(CFilteredString* pFS)
 	}
 }
 
-bool CFilterOnStrings::OnFilterCache(CGeoCache* pCache)
+bool CFilterOnStrings::OnFilterCache(CGeoCache* pCache) const
 {
-	for (itFiltStr S = m_Strs.begin(); S != m_Strs.end(); S++)
+	for (citFiltStr S = m_Strs.begin(); S != m_Strs.end(); S++)
 	{
 		CFilteredString* pFS = *S;
 
@@ -112,6 +99,31 @@ bool CFilterOnStrings::OnFilterCache(CGeoCache* pCache)
 	return true;
 }
 
+// Folds the states or countries filtered out into the compiled test
+bool CFilterOnStrings::Compile(CFilterPredicate& Predicate)
+{
+	for (itFiltStr S = m_Strs.begin(); S != m_Strs.end(); S++)
+	{
+		CFilteredString* pFS = *S;
+
+		if (pFS->m_Enabled)
+		{
+			continue;
+		}
+
+		if (GetType() == FilterStateList)
+		{
+			Predicate.RejectState(pFS->m_Str);
+		}
+		else
+		{
+			Predicate.RejectCountry(pFS->m_Str);
+		}
+	}
+
+	return true;
+}
+
 void CFilterOnStrings::Serialize(CStream& ar)
 {
 	#define CFilterOnStringsVersion	100
@@ -20,6 +20,7 @@ public:
 
 typedef vector<CFilteredString*> FiltStrCont;
 typedef vector<CFilteredString*>::iterator itFiltStr;
+typedef vector<CFilteredString*>::const_iterator citFiltStr;
 
 class CFilterOnStrings : public CFilterBase
 {
@@ -36,7 +37,8 @@ public:
 	// Delete a string object according to its pointer
 	void	Delete(CFilteredString* pFS);
 
-	virtual bool OnFilterCache(CGeoCache* pCache);
+	virtual bool OnFilterCache(CGeoCache* pCache) const;
+	virtual bool Compile(CFilterPredicate& Predicate);
 
 	virtual void Serialize(CStream& ar);
 
@@ -0,0 +1,571 @@
+#include "CFilterPredicate.h"
+#include "CGpxParser.h"
+#include "CFieldNoteMgr.h"
+#include <math.h>
+
+CFilterPredicate::CFilterPredicate()
+{
+	Reset();
+}
+
+CFilterPredicate::~CFilterPredicate()
+{
+}
+
+// Packs the attributes of the caches of a parser
+void CFilterPredicate::Gather(CGpxParser& Parser)
+{
+	m_Attributes.clear();
+	m_Caches.clear();
+	m_StateIds.clear();
+	m_CountryIds.clear();
+
+	itStringIds		LastState = m_StateIds.end();
+	itStringIds		LastCountry = m_CountryIds.end();
+	CacheAttributes	Attr;
+	itGC			C;
+
+	CGeoCache* pCache = Parser.First(C);
+
+	while (!Parser.EndOfCacheList(C))
+	{
+		Attr.Flags = 0;
+
+		if (!pCache->m_Sym.empty() || (pCache->m_pFieldNote && pCache->m_pFieldNote->m_Status == NoteStatusFoundIt))
+		{
+			Attr.Flags |= CA_FOUND;
+		}
+
+		if (pCache->m_pFieldNote)
+		{
+			Attr.Flags |= CA_FIELDNOTE;
+		}
+
+		if (pCache->m_Ignored)
+		{
+			Attr.Flags |= CA_IGNORED;
+		}
+
+		if (pCache->m_GsCacheArchived || !pCache->m_GsCacheAvailable)
+		{
+			Attr.Flags |= CA_UNAVAILABLE;
+		}
+
+		if (pCache->m_GsCacheArchived)
+		{
+			Attr.Flags |= CA_ARCHIVED;
+		}
+
+		if (!pCache->m_GsCacheAvailable)
+		{
+			Attr.Flags |= CA_DISABLED;
+		}
+
+		long TravelBugs = pCache->GetTBCount();
+
+		if (TravelBugs)
+		{
+			Attr.Flags |= CA_TRAVELBUGS;
+		}
+
+		Attr.TravelBugs = (BYTE) ((TravelBugs < 255) ? TravelBugs : 255);
+
+		Attr.Type = (BYTE) pCache->TypeLookup();
+		Attr.Container = (BYTE) pCache->ContainerLookup();
+		Attr.Bearing = (BYTE) pCache->m_Bearing;
+		Attr.Distance = pCache->m_Distance;
+
+		// The ratings are multiples of one half, which a float holds exactly
+		Attr.Difficulty = (float) pCache->m_GsCacheDifficulty;
+		Attr.Terrain = (float) pCache->m_GsCacheTerrain;
+
+		Attr.State = Number(m_StateIds, pCache->m_GsCacheState, LastState);
+		Attr.Country = Number(m_CountryIds, pCache->m_GsCacheCountry, LastCountry);
+
+		m_Attributes.push_back(Attr);
+		m_Caches.push_back(pCache);
+
+		pCache = Parser.Next(C);
+	}
+}
+
+// Returns the number of a string, numbering it if it wasn't met before
+WORD CFilterPredicate::Number(StringIds& Ids, const String& Str, itStringIds& Last)
+{
+	if (Last != Ids.end() && (*Last).first == Str)
+	{
+		return (*Last).second;
+	}
+
+	Last = Ids.find(Str);
+
+	if (Last == Ids.end())
+	{
+		WORD Id = (WORD) Ids.size();
+
+		Last = Ids.insert(StringIds::value_type(Str, Id)).first;
+	}
+
+	return (*Last).second;
+}
+
+// Clears the test: every cache passes. Must be called after Gather(), which sizes the tables of the states and countries.
+void CFilterPredicate::Reset()
+{
+	m_RejectedTypes = 0;
+	m_RejectedContainers = 0;
+	m_RejectedBearings = 0;
+
+	m_RejectedFlags = 0;
+	m_RequiredFlags = 0;
+
+	m_MaxDistance = HUGE_VAL;
+
+	m_TestDifficulty = false;
+	m_MinDifficulty = 0.0f;
+	m_MaxDifficulty = 0.0f;
+	m_TestTerrain = false;
+	m_MinTerrain = 0.0f;
+	m_MaxTerrain = 0.0f;
+
+	// One more entry than there are strings, so that the tables are never empty
+	m_RejectedStates.assign(m_StateIds.size() + 1, 0);
+	m_RejectedCountries.assign(m_CountryIds.size() + 1, 0);
+
+	m_Steps.clear();
+	m_Tables.clear();
+	m_Depth = 0;
+	m_MaxDepth = 0;
+}
+
+// Filters out the caches of a state. A state that no cache is in has no number and nothing to filter out.
+void CFilterPredicate::RejectState(const String& State)
+{
+	itStringIds it = m_StateIds.find(State);
+
+	if (it != m_StateIds.end())
+	{
+		m_RejectedStates[(*it).second] = 1;
+	}
+}
+
+// Filters out the caches of a country
+void CFilterPredicate::RejectCountry(const String& Country)
+{
+	itStringIds it = m_CountryIds.find(Country);
+
+	if (it != m_CountryIds.end())
+	{
+		m_RejectedCountries[(*it).second] = 1;
+	}
+}
+
+// Returns the number of a table holding !0 for the states listed
+long CFilterPredicate::StateTable(const vector<String>& States)
+{
+	return Table(m_StateIds, States);
+}
+
+// Returns the number of a table holding !0 for the countries listed
+long CFilterPredicate::CountryTable(const vector<String>& Countries)
+{
+	return Table(m_CountryIds, Countries);
+}
+
+// Returns the number of a table holding !0 for the strings listed, regardless of case. Strings that no cache uses
+// have no number and are left out.
+long CFilterPredicate::Table(StringIds& Ids, const vector<String>& Strs)
+{
+	m_Tables.push_back(vector<BYTE>(Ids.size() + 1, 0));
+
+	vector<BYTE>& Table = m_Tables.back();
+
+	for (itStringIds it = Ids.begin(); it != Ids.end(); it++)
+	{
+		for (vector<String>::const_iterator itStr = Strs.begin(); itStr != Strs.end(); itStr++)
+		{
+			if (!_tcsicmp((*it).first.c_str(), itStr->c_str()))
+			{
+				Table[(*it).second] = 1;
+				break;
+			}
+		}
+	}
+
+	return m_Tables.size() - 1;
+}
+
+// Appends a step to the filter expression
+void CFilterPredicate::AddStep(const PredicateStep& Step)
+{
+	m_Steps.push_back(Step);
+
+	// The tests push a result, the binary operators replace two results by one
+	if (Step.Op == PredicateAnd || Step.Op == PredicateOr)
+	{
+		m_Depth--;
+	}
+	else if (Step.Op != PredicateNot)
+	{
+		m_Depth++;
+	}
+
+	if (m_Depth > m_MaxDepth)
+	{
+		m_MaxDepth = m_Depth;
+	}
+}
+
+// Sets Passed[n] to !0 when the cache n, from First to Last - 1, passes the test
+void CFilterPredicate::Evaluate(vector<BYTE>& Passed, long First, long Last)
+{
+	if (First >= Last)
+	{
+		return;
+	}
+
+	// Writing the results through a pointer could change the members as far as the compiler knows:
+	// local copies let it keep the test in registers instead of reloading it for every cache.
+	const CacheAttributes*	pAttr = &m_Attributes[0];
+	BYTE*					pPassed = &Passed[0];
+	const BYTE*				pStates = &m_RejectedStates[0];
+	const BYTE*				pCountries = &m_RejectedCountries[0];
+	DWORD					RejectedTypes = m_RejectedTypes;
+	DWORD					RejectedContainers = m_RejectedContainers;
+	DWORD					RejectedBearings = m_RejectedBearings;
+	WORD					RejectedFlags = m_RejectedFlags;
+	WORD					RequiredFlags = m_RequiredFlags;
+	double					MaxDistance = m_MaxDistance;
+	bool					AnyDifficulty = !m_TestDifficulty;
+	float					MinDifficulty = m_MinDifficulty;
+	float					MaxDifficulty = m_MaxDifficulty;
+	bool					AnyTerrain = !m_TestTerrain;
+	float					MinTerrain = m_MinTerrain;
+	float					MaxTerrain = m_MaxTerrain;
+
+	for (long Index = First; Index < Last; Index++)
+	{
+		const CacheAttributes& A = pAttr[Index];
+
+		// Every test is evaluated and the results are combined with '&' rather than '&&', which keeps the loop
+		// free of branches. A distance that isn't a number passes, as it did when each filter was asked in turn.
+		pPassed[Index] = (BYTE) (
+			((A.Flags & RejectedFlags) == 0) &
+			((A.Flags & RequiredFlags) == RequiredFlags) &
+			(((RejectedTypes >> A.Type) & 1) == 0) &
+			(((RejectedContainers >> A.Container) & 1) == 0) &
+			(((RejectedBearings >> A.Bearing) & 1) == 0) &
+			(pStates[A.State] == 0) &
+			(pCountries[A.Country] == 0) &
+			!(A.Distance > MaxDistance) &
+			(AnyDifficulty | ((A.Difficulty >= MinDifficulty) & (A.Difficulty <= MaxDifficulty))) &
+			(AnyTerrain | ((A.Terrain >= MinTerrain) & (A.Terrain <= MaxTerrain))));
+	}
+
+	// An expression whose steps don't leave a single result is left out
+	if (m_Steps.empty() || m_Depth != 1)
+	{
+		return;
+	}
+
+	for (long Block = First; Block < Last; Block += PREDICATE_BLOCK)
+	{
+		RunSteps(pPassed + Block, Block, (Block + PREDICATE_BLOCK < Last) ? Block + PREDICATE_BLOCK : Last);
+	}
+}
+
+// Sets pFacets[n - First] for the caches n from First to Last - 1: FACET_PASSED, the facet whose test alone filters
+// the cache out, or FACET_REJECTED. The tests of the facets are the ones of Evaluate(), each kept in a bit of its own;
+// the tests that aren't about a facet (flags, distance and filter expression) are combined in Others.
+void CFilterPredicate::Sideways(BYTE* pFacets, long First, long Last)
+{
+	const CacheAttributes*	pAttr = &m_Attributes[First];
+	long					Count = Last - First;
+	BYTE					Others[PREDICATE_BLOCK];
+	const BYTE*				pStates = &m_RejectedStates[0];
+	const BYTE*				pCountries = &m_RejectedCountries[0];
+	DWORD					RejectedTypes = m_RejectedTypes;
+	DWORD					RejectedContainers = m_RejectedContainers;
+	DWORD					RejectedBearings = m_RejectedBearings;
+	WORD					RejectedFlags = m_RejectedFlags;
+	WORD					RequiredFlags = m_RequiredFlags;
+	double					MaxDistance = m_MaxDistance;
+	bool					AnyDifficulty = !m_TestDifficulty;
+	float					MinDifficulty = m_MinDifficulty;
+	float					MaxDifficulty = m_MaxDifficulty;
+	bool					AnyTerrain = !m_TestTerrain;
+	float					MinTerrain = m_MinTerrain;
+	float					MaxTerrain = m_MaxTerrain;
+	long					Index;
+
+	if (Count <= 0)
+	{
+		return;
+	}
+
+	for (Index = 0; Index < Count; Index++)
+	{
+		const CacheAttributes& A = pAttr[Index];
+
+		Others[Index] = (BYTE) (
+			((A.Flags & RejectedFlags) == 0) &
+			((A.Flags & RequiredFlags) == RequiredFlags) &
+			!(A.Distance > MaxDistance));
+
+		// One bit for each facet whose test the cache fails
+		pFacets[Index] = (BYTE) (
+			(((RejectedTypes >> A.Type) & 1) << FacetType) |
+			(((RejectedContainers >> A.Container) & 1) << FacetContainer) |
+			(((RejectedBearings >> A.Bearing) & 1) << FacetBearing) |
+			((DWORD) (pStates[A.State] != 0) << FacetState) |
+			((DWORD) (pCountries[A.Country] != 0) << FacetCountry) |
+			((DWORD) !(AnyDifficulty | ((A.Difficulty >= MinDifficulty) & (A.Difficulty <= MaxDifficulty))) << FacetDifficulty) |
+			((DWORD) !(AnyTerrain | ((A.Terrain >= MinTerrain) & (A.Terrain <= MaxTerrain))) << FacetTerrain));
+	}
+
+	if (!m_Steps.empty() && m_Depth == 1)
+	{
+		RunSteps(Others, First, Last);
+	}
+
+	for (Index = 0; Index < Count; Index++)
+	{
+		BYTE Failed = pFacets[Index];
+
+		if (!Others[Index] || (Failed & (Failed - 1)))
+		{
+			pFacets[Index] = FACET_REJECTED;
+		}
+		else if (!Failed)
+		{
+			pFacets[Index] = FACET_PASSED;
+		}
+		else
+		{
+			BYTE Facet = 0;
+
+			while (!((Failed >> Facet) & 1))
+			{
+				Facet++;
+			}
+
+			pFacets[Index] = Facet;
+		}
+	}
+}
+
+// Runs the steps of the filter expression over the caches First to Last - 1, at most PREDICATE_BLOCK of them.
+// The results of the tests are 0 or 1 for each cache, so that the operators are bitwise.
+void CFilterPredicate::RunSteps(BYTE* pResult, long First, long Last)
+{
+	const CacheAttributes*	pAttr = &m_Attributes[First];
+	long					Count = Last - First;
+	vector<BYTE>			Stack(m_MaxDepth * PREDICATE_BLOCK);
+	double					Values[PREDICATE_BLOCK];
+	long					Index;
+
+	// Results of the step on top of the stack
+	BYTE* pTop = &Stack[0] - PREDICATE_BLOCK;
+
+	for (vector<PredicateStep>::iterator it = m_Steps.begin(); it != m_Steps.end(); it++)
+	{
+		const PredicateStep&	Step = *it;
+		DWORD					Bits = Step.Bits;
+		const BYTE*				pTable = (Step.Op == PredicateState || Step.Op == PredicateCountry) ? &m_Tables[Step.Table][0] : NULL;
+
+		if (Step.Op == PredicateAnd || Step.Op == PredicateOr)
+		{
+			pTop -= PREDICATE_BLOCK;
+		}
+		else if (Step.Op != PredicateNot)
+		{
+			pTop += PREDICATE_BLOCK;
+		}
+
+		switch (Step.Op)
+		{
+		case PredicateFlags:
+			for (Index = 0; Index < Count; Index++)
+			{
+				pTop[Index] = (BYTE) ((pAttr[Index].Flags & Bits) != 0);
+			}
+			break;
+
+		case PredicateType:
+			for (Index = 0; Index < Count; Index++)
+			{
+				pTop[Index] = (BYTE) ((Bits >> pAttr[Index].Type) & 1);
+			}
+			break;
+
+		case PredicateContainer:
+			for (Index = 0; Index < Count; Index++)
+			{
+				pTop[Index] = (BYTE) ((Bits >> pAttr[Index].Container) & 1);
+			}
+			break;
+
+		case PredicateBearing:
+			for (Index = 0; Index < Count; Index++)
+			{
+				pTop[Index] = (BYTE) ((Bits >> pAttr[Index].Bearing) & 1);
+			}
+			break;
+
+		case PredicateState:
+			for (Index = 0; Index < Count; Index++)
+			{
+				pTop[Index] = pTable[pAttr[Index].State];
+			}
+			break;
+
+		case PredicateCountry:
+			for (Index = 0; Index < Count; Index++)
+			{
+				pTop[Index] = pTable[pAttr[Index].Country];
+			}
+			break;
+
+		case PredicateDistance:
+			for (Index = 0; Index < Count; Index++)
+			{
+				Values[Index] = pAttr[Index].Distance;
+			}
+
+			Compare(Values, Step.Compare, Step.Value, pTop, Count);
+			break;
+
+		case PredicateDifficulty:
+			for (Index = 0; Index < Count; Index++)
+			{
+				Values[Index] = pAttr[Index].Difficulty;
+			}
+
+			Compare(Values, Step.Compare, Step.Value, pTop, Count);
+			break;
+
+		case PredicateTerrain:
+			for (Index = 0; Index < Count; Index++)
+			{
+				Values[Index] = pAttr[Index].Terrain;
+			}
+
+			Compare(Values, Step.Compare, Step.Value, pTop, Count);
+			break;
+
+		case PredicateAnd:
+			for (Index = 0; Index < Count; Index++)
+			{
+				pTop[Index] &= pTop[Index + PREDICATE_BLOCK];
+			}
+			break;
+
+		case PredicateOr:
+			for (Index = 0; Index < Count; Index++)
+			{
+				pTop[Index] |= pTop[Index + PREDICATE_BLOCK];
+			}
+			break;
+
+		case PredicateNot:
+			for (Index = 0; Index < Count; Index++)
+			{
+				pTop[Index] ^= 1;
+			}
+			break;
+		}
+	}
+
+	for (Index = 0; Index < Count; Index++)
+	{
+		pResult[Index] &= pTop[Index];
+	}
+}
+
+// Sets pResult[n] to !0 when the comparison of pValues[n] to Value holds, for Count values.
+// The switch is outside of the loops: each loop is a plain comparison.
+void CFilterPredicate::Compare(const double* pValues, BYTE Operator, double Value, BYTE* pResult, long Count)
+{
+	long Index;
+
+	switch (Operator)
+	{
+	case CompareLess:
+		for (Index = 0; Index < Count; Index++)
+		{
+			pResult[Index] = (BYTE) (pValues[Index] < Value);
+		}
+		break;
+
+	case CompareLessEqual:
+		for (Index = 0; Index < Count; Index++)
+		{
+			pResult[Index] = (BYTE) (pValues[Index] <= Value);
+		}
+		break;
+
+	case CompareEqual:
+		for (Index = 0; Index < Count; Index++)
+		{
+			pResult[Index] = (BYTE) (pValues[Index] == Value);
+		}
+		break;
+
+	case CompareNotEqual:
+		for (Index = 0; Index < Count; Index++)
+		{
+			pResult[Index] = (BYTE) (pValues[Index] != Value);
+		}
+		break;
+
+	case CompareGreaterEqual:
+		for (Index = 0; Index < Count; Index++)
+		{
+			pResult[Index] = (BYTE) (pValues[Index] >= Value);
+		}
+		break;
+
+	default:
+		for (Index = 0; Index < Count; Index++)
+		{
+			pResult[Index] = (BYTE) (pValues[Index] > Value);
+		}
+		break;
+	}
+}
+
+// Returns the number of caches gathered
+long CFilterPredicate::GetCacheCount()
+{
+	return m_Caches.size();
+}
+
+// Returns a cache gathered by its position in the list
+CGeoCache* CFilterPredicate::GetCache(long Index)
+{
+	return m_Caches[Index];
+}
+
+// Returns the caches gathered, in the order of the list
+vector<CGeoCache*>& CFilterPredicate::GetCaches()
+{
+	return m_Caches;
+}
+
+// Returns the attributes of a cache gathered by its position in the list
+const CacheAttributes& CFilterPredicate::GetAttributes(long Index)
+{
+	return m_Attributes[Index];
+}
+
+// Returns the numbers of the states met
+const CFilterPredicate::StringIds& CFilterPredicate::GetStateIds()
+{
+	return m_StateIds;
+}
+
+// Returns the numbers of the countries met
+const CFilterPredicate::StringIds& CFilterPredicate::GetCountryIds()
+{
+	return m_CountryIds;
+}
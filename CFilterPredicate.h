@@ -0,0 +1,209 @@
+#ifndef _INC_CFilterPredicate
+	#define _INC_CFilterPredicate
+
+#include "CommonDefs.h"
+#include <vector>
+#include <map>
+
+using namespace std;
+
+class CGeoCache;
+class CGpxParser;
+
+// Flags of the packed attributes of a cache
+#define CA_FOUND			0x0001		// Marked as found, or has a 'Found It' field note
+#define CA_FIELDNOTE		0x0002		// Has a field note
+#define CA_IGNORED			0x0004
+#define CA_UNAVAILABLE		0x0008		// Disabled or archived
+#define CA_TRAVELBUGS		0x0010		// Holds travel bugs
+#define CA_ARCHIVED			0x0020
+#define CA_DISABLED			0x0040		// Not available, archived or not
+
+// The attributes of a cache looked at by the compiled filters, packed so that a filtering pass reads them in sequence
+typedef struct {
+	double	Distance;
+	float	Difficulty;
+	float	Terrain;
+	WORD	Flags;
+	BYTE	Type;
+	BYTE	Container;
+	BYTE	Bearing;
+	BYTE	TravelBugs;		// Number of travel bugs held, up to 255
+	WORD	State;
+	WORD	Country;
+} CacheAttributes;
+
+// Operations of the steps of a filter expression (see CFilterExpression)
+typedef enum {
+	PredicateFlags = 0,		// The cache has one of the flags of Bits
+	PredicateType,			// The bit of the type of the cache is set in Bits
+	PredicateContainer,		// Same for the container
+	PredicateBearing,		// Same for the bearing
+	PredicateState,			// The state of the cache is set in the table Table
+	PredicateCountry,		// Same for the country
+	PredicateDistance,		// Compare the distance of the cache to Value
+	PredicateDifficulty,	// Same for the difficulty
+	PredicateTerrain,		// Same for the terrain
+	PredicateAnd,			// Combine the results of the two previous steps
+	PredicateOr,
+	PredicateNot			// Negate the result of the previous step
+} PredicateOp;
+
+// Comparisons of the PredicateDistance, PredicateDifficulty and PredicateTerrain steps
+typedef enum {
+	CompareLess = 0,
+	CompareLessEqual,
+	CompareEqual,
+	CompareNotEqual,
+	CompareGreaterEqual,
+	CompareGreater
+} PredicateCompare;
+
+// Facets of the caches: the options of the compiled tests that the filter dialogs list (see CFilterFacets)
+typedef enum {
+	FacetType = 0,
+	FacetContainer,
+	FacetBearing,
+	FacetState,
+	FacetCountry,
+	FacetDifficulty,
+	FacetTerrain,
+	EndOfFacet
+} FilterFacet;
+
+// Outcomes of Sideways() for a cache that passes the whole test, and for one that fails more than the test of a facet
+#define FACET_PASSED		0xFF
+#define FACET_REJECTED		0xFE
+
+// A step of a filter expression. The steps are run in postfix order: a test pushes its result, for every cache,
+// and the operators combine the results on top of the stack.
+typedef struct {
+	BYTE	Op;
+	BYTE	Compare;
+	DWORD	Bits;
+	double	Value;
+	long	Table;
+} PredicateStep;
+
+// The enabled filters compiled into a single test, run over the packed attributes of the caches.
+// At the start of a filtering pass, Gather() packs the attributes of the caches and Reset() clears the test.
+// Each filter then folds its settings into the test (see CFilterBase::Compile()): the types, containers, bearings,
+// states and countries that are filtered out become sets of bits, the ratings and the distance become ranges and
+// the found / ignored / travel bugs conditions become masks over the flags. Evaluate() runs the test over every
+// cache in one loop, without function calls or string comparisons.
+// The states and countries are strings: a pass numbers the distinct ones it meets and the caches refer to them by number.
+// A filter expression, which the fixed test can't express as it may use OR and NOT, is added as a list of steps.
+// Evaluate() runs each step over a block of caches before the next one: the switch on the operation is taken once
+// per step and block, and the loops over the caches stay as simple as the fixed test.
+// Sideways() takes the test apart by facet instead, to tell for each cache which facet alone filters it out.
+class CFilterPredicate
+{
+	// Caches run through a step at a time by the filter expression
+	#define PREDICATE_BLOCK		256
+
+public:
+	typedef map<String, WORD>					StringIds;
+	typedef map<String, WORD>::iterator			itStringIds;
+	typedef map<String, WORD>::const_iterator	citStringIds;
+
+	// Sets of filtered out values, one bit per GcType, GcContainer and GcBearing
+	DWORD			m_RejectedTypes;
+	DWORD			m_RejectedContainers;
+	DWORD			m_RejectedBearings;
+
+	// A cache is filtered out if it has any of the rejected flags, or lacks one of the required flags
+	WORD			m_RejectedFlags;
+	WORD			m_RequiredFlags;
+
+	// Caches further away are filtered out
+	double			m_MaxDistance;
+
+	// Ranges of the ratings, only looked at when the rating is tested
+	bool			m_TestDifficulty;
+	float			m_MinDifficulty;
+	float			m_MaxDifficulty;
+	bool			m_TestTerrain;
+	float			m_MinTerrain;
+	float			m_MaxTerrain;
+
+protected:
+	// Attributes of the caches, in the order of the cache list
+	vector<CacheAttributes>	m_Attributes;
+	vector<CGeoCache*>		m_Caches;
+
+	// Numbers of the states and countries met, and !0 for the filtered out ones
+	StringIds		m_StateIds;
+	StringIds		m_CountryIds;
+	vector<BYTE>	m_RejectedStates;
+	vector<BYTE>	m_RejectedCountries;
+
+	// Steps of the filter expression, tables of the states and countries they look for, and results they stack
+	vector<PredicateStep>	m_Steps;
+	vector< vector<BYTE> >	m_Tables;
+	long					m_Depth;
+	long					m_MaxDepth;
+
+public:
+	CFilterPredicate();
+	~CFilterPredicate();
+
+	// Packs the attributes of the caches of a parser
+	void		Gather(CGpxParser& Parser);
+
+	// Clears the test: every cache passes
+	void		Reset();
+
+	// Filters out the caches of a state or a country
+	void		RejectState(const String& State);
+	void		RejectCountry(const String& Country);
+
+	// Returns the number of a table holding !0 for the states or the countries listed (regardless of case), for a
+	// PredicateState or a PredicateCountry step
+	long		StateTable(const vector<String>& States);
+	long		CountryTable(const vector<String>& Countries);
+
+	// Appends a step to the filter expression. A cache passes the expression if the last step leaves !0 for it.
+	void		AddStep(const PredicateStep& Step);
+
+	// Sets Passed[n] to !0 when the cache n, from First to Last - 1, passes the test. Passed must hold every cache.
+	// Several threads may evaluate different caches at the same time.
+	void		Evaluate(vector<BYTE>& Passed, long First, long Last);
+
+	// Sets pFacets[n - First] for the caches n from First to Last - 1, at most PREDICATE_BLOCK of them: FACET_PASSED
+	// when the cache passes the test, the facet (FilterFacet) whose test alone filters it out, or FACET_REJECTED.
+	// Several threads may look at different caches at the same time.
+	void		Sideways(BYTE* pFacets, long First, long Last);
+
+	// Returns the attributes of a cache gathered by its position in the list
+	const CacheAttributes&	GetAttributes(long Index);
+
+	// Returns the numbers of the states and countries met
+	const StringIds&	GetStateIds();
+	const StringIds&	GetCountryIds();
+
+	// Returns the number of caches gathered
+	long		GetCacheCount();
+
+	// Returns a cache gathered by its position in the list
+	CGeoCache*	GetCache(long Index);
+
+	// Returns the caches gathered, in the order of the list
+	vector<CGeoCache*>&	GetCaches();
+
+protected:
+	// Returns the number of a string, numbering it if it wasn't met before. Last points to the previous string,
+	// which caches from the same area often share.
+	static WORD	Number(StringIds& Ids, const String& Str, itStringIds& Last);
+
+	// Returns the number of a table holding !0 for the strings listed, regardless of case
+	long		Table(StringIds& Ids, const vector<String>& Strs);
+
+	// Runs the steps of the filter expression over the caches First to Last - 1, at most PREDICATE_BLOCK of them,
+	// and clears pResult[n - First] for the caches that fail it
+	void		RunSteps(BYTE* pResult, long First, long Last);
+
+	// Sets pResult[n] to !0 when the comparison of pValues[n] to Value holds, for Count values
+	static void	Compare(const double* pValues, BYTE Operator, double Value, BYTE* pResult, long Count);
+};
+
+#endif
@@ -2,6 +2,7 @@
 #include "gpxsonar.h"
 #include "CFilterRatingsDlg.h"
 #include "CFilterCacheRatings.h"
+#include "CFilterFacets.h"
 
 #ifdef _DEBUG
 #define new DEBUG_NEW
@@ -17,6 +18,7 @@ CFilterRatingsDlg::CFilterRatingsDlg(CWnd* pParent): CNonFSDialog(CFilterRatings
 	//}}AFX_DATA_INIT
 
 	m_pRatings = 0;
+	m_pFacets = 0;
 }
 
 void CFilterRatingsDlg::DoDataExchange(CDataExchange* pDX)
@@ -34,6 +36,10 @@ void CFilterRatingsDlg::DoDataExchange(CDataExchange* pDX)
 
 BEGIN_MESSAGE_MAP(CFilterRatingsDlg, CNonFSDialog)
 	//{{AFX_MSG_MAP(CFilterRatingsDlg)
+	ON_CBN_SELCHANGE(IDC_DIFF_OPER, OnSelchangeRating)
+	ON_CBN_SELCHANGE(IDC_DIFF_LVL, OnSelchangeRating)
+	ON_CBN_SELCHANGE(IDC_TERR_OPER, OnSelchangeRating)
+	ON_CBN_SELCHANGE(IDC_TERR_LVL, OnSelchangeRating)
 	//}}AFX_MSG_MAP
 END_MESSAGE_MAP()
 
@@ -70,6 +76,8 @@ BOOL CFilterRatingsDlg::OnInitDialog()
 	m_TerrEnabled = (BOOL) m_pRatings->m_TerrEnabled;
 
 	UpdateData(false);
+
+	ShowCounts();
 	
 	return TRUE;  // return TRUE unless you set the focus to a control
 	              // EXCEPTION: OCX Property Pages should return FALSE
@@ -95,6 +103,34 @@ void CFilterRatingsDlg::OnCancel()
 	CNonFSDialog::OnCancel();
 }
 
+void CFilterRatingsDlg::OnSelchangeRating() 
+{
+	ShowCounts();
+}
+
+// Shows next to each rating the number of caches the comparison selected would keep, whatever the rating filter
+// does with the other rating
+void CFilterRatingsDlg::ShowCounts()
+{
+	if (!m_pFacets || m_DiffLvl.GetCurSel() == CB_ERR || m_TerrLvl.GetCurSel() == CB_ERR)
+	{
+		return;
+	}
+
+	CString	Rating;
+	float	Min, Max;
+
+	m_DiffLvl.GetLBText(m_DiffLvl.GetCurSel(), Rating);
+	CFilterCacheRatings::OperRange((OperType) m_DiffOper.GetCurSel(), ToNumerical(Rating), Min, Max);
+
+	SetDlgItemText(IDC_DIFFICULTY, CFilterFacets::Label(_T("Difficulty"), m_pFacets->GetRatingCount(FacetDifficulty, Min, Max)).c_str());
+
+	m_TerrLvl.GetLBText(m_TerrLvl.GetCurSel(), Rating);
+	CFilterCacheRatings::OperRange((OperType) m_TerrOper.GetCurSel(), ToNumerical(Rating), Min, Max);
+
+	SetDlgItemText(IDC_TERRAIN, CFilterFacets::Label(_T("Terrain"), m_pFacets->GetRatingCount(FacetTerrain, Min, Max)).c_str());
+}
+
 double CFilterRatingsDlg::ToNumerical(CString& Rating)
 {
 	double Val;
@@ -8,6 +8,7 @@
 #include "NonFSDialog.h"
 
 class CFilterCacheRatings;
+class CFilterFacets;
 
 class CFilterRatingsDlg : public CNonFSDialog
 {
@@ -28,6 +29,9 @@ public:
 
 	CFilterCacheRatings* m_pRatings;
 
+	// Counts of the ratings given the other filters, or null to show no count
+	CFilterFacets*	m_pFacets;
+
 // Overrides
 	// ClassWizard generated virtual function overrides
 	//{{AFX_VIRTUAL(CFilterRatingsDlg)
@@ -42,11 +46,15 @@ protected:
 	//{{AFX_MSG(CFilterRatingsDlg)
 	virtual BOOL OnInitDialog();
 	virtual void OnCancel();
+	afx_msg void OnSelchangeRating();
 	//}}AFX_MSG
 	DECLARE_MESSAGE_MAP()
 
 	double	ToNumerical(CString& Rating);
 	CString	ToText(double RatingVal);
+
+	// Shows next to each rating the number of caches the comparison selected would keep
+	void	ShowCounts();
 };
 
 //{{AFX_INSERT_LOCATION}}
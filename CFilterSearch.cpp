@@ -1,19 +1,140 @@
 #include "CFilterSearch.h"
 #include "CGpxParser.h"
+#include "CTextIndex.h"
+#include <algorithm>
 
 CFilterSearch::CFilterSearch(const TCHAR* pText, GcFilter FilterType) : CFilterBase(pText, FilterType)
 {
 	m_Match = PartialMatch;
+	m_SignedMatch = ExactMatch;
+	m_pIndex = 0;
+	m_Indexed = false;
+	m_FuzzyEdits = 0;
+	m_FuzzyRevision = 0;
+	m_pBest = 0;
 }
 
 CFilterSearch::~CFilterSearch()
 {
 }
 
-bool CFilterSearch::OnFilterCache(CGeoCache* pCache)
+// Sets the text index of the loaded caches
+void CFilterSearch::SetTextIndex(CTextIndex* pIndex)
+{
+	m_pIndex = pIndex;
+}
+
+// Returns the cache needing the fewest edits in the last fuzzy search, if any
+CGeoCache* CFilterSearch::GetBestMatch()
+{
+	return m_pBest;
+}
+
+// A partial match on a longer text that contains the previous one can only reject more caches, and the other way around.
+// So does a fuzzy match, as long as both texts tolerate the same edits.
+FilterChange CFilterSearch::GetChange()
+{
+	FilterChange Change = CFilterBase::GetChange();
+
+	bool Partial = (m_Match == PartialMatch && m_SignedMatch == PartialMatch);
+	bool Fuzzy = (m_Match == FuzzyMatch && m_SignedMatch == FuzzyMatch &&
+		CTextIndex::FuzzyEdits(m_Text.size()) == CTextIndex::FuzzyEdits(m_SignedText.size()));
+
+	if (Change == FilterChanged && (Partial || Fuzzy))
+	{
+		int Found = m_Text.find(m_SignedText);
+
+		if (Found != -1)
+		{
+			Change = FilterNarrower;
+		}
+		else
+		{
+			Found = m_SignedText.find(m_Text);
+
+			if (Found != -1)
+			{
+				Change = FilterWider;
+			}
+		}
+	}
+
+	m_SignedMatch = m_Match;
+	m_SignedText = m_Text;
+
+	return Change;
+}
+
+void CFilterSearch::OnBeginFilter(CGpxParser& Parser)
+{
+	m_Matches.clear();
+	m_pBest = 0;
+
+	// The index only helps if it holds the caches being filtered
+	m_Indexed = (m_Match != ExactMatch && m_pIndex && !m_pIndex->IsEmpty() && m_pIndex->GetCacheCount() == Parser.CacheCount());
+
+	if (!m_Indexed)
+	{
+		return;
+	}
+
+	// No text matches every cache, as a partial match does
+	if (m_Match == FuzzyMatch && !m_Text.empty())
+	{
+		FuzzySearch();
+	}
+	else
+	{
+		m_pIndex->Search(m_Text.c_str(), m_Matches);
+	}
+
+	sort(m_Matches.begin(), m_Matches.end());
+}
+
+// Searches the index for the caches matching the text give or take a few edits
+void CFilterSearch::FuzzySearch()
+{
+	String			Text = m_Text.substr(0, TEXT_FUZZY_MAX);
+	long			Edits = CTextIndex::FuzzyEdits(Text.size());
+	long			Revision = m_pIndex->GetRevision();
+	TextMatchCont	Found;
+
+	// A cache within Edits of the text is within Edits of any part of it: when the previous text is part of this one,
+	// the caches the previous search rejected can be skipped. Usually the previous search was one keystroke ago.
+	bool Reuse = (!m_FuzzyText.empty() && Edits == m_FuzzyEdits && Revision == m_FuzzyRevision &&
+		Text.find(m_FuzzyText) != -1);
+
+	m_pIndex->FuzzySearch(Text.c_str(), Edits, Reuse ? &m_FuzzyPositions : NULL, Found);
+
+	m_FuzzyText = Text;
+	m_FuzzyEdits = Edits;
+	m_FuzzyRevision = Revision;
+	m_FuzzyPositions.clear();
+
+	// The matches come ranked, best first
+	for (itTextMatch it = Found.begin(); it != Found.end(); it++)
+	{
+		m_FuzzyPositions.push_back(it->second);
+		m_Matches.push_back(m_pIndex->GetCache(it->second));
+	}
+
+	if (!m_Matches.empty())
+	{
+		m_pBest = m_Matches[0];
+	}
+
+	sort(m_FuzzyPositions.begin(), m_FuzzyPositions.end());
+}
+
+bool CFilterSearch::OnFilterCache(CGeoCache* pCache) const
 {
 	const TCHAR* pText = m_Text.c_str();
 
+	if (m_Indexed)
+	{
+		return binary_search(m_Matches.begin(), m_Matches.end(), pCache);
+	}
+
 	if (ExactMatch == m_Match)
 	{
 		if (!_tcsicmp(pText, (TCHAR*) pCache->m_Shortname.c_str()) || 
@@ -25,8 +146,8 @@ bool CFilterSearch::OnFilterCache(CGeoCache* pCache)
 	}
 	else
 	{
-		// Allocate a buffer large enough to handle any of the strings
-		long Size = pCache->m_Shortname.size() + pCache->m_GsCacheName.size() + pCache->m_GsCacheOwnerName.size();
+		// Allocate a buffer large enough to handle any of the strings and its terminator
+		long Size = pCache->m_Shortname.size() + pCache->m_GsCacheName.size() + pCache->m_GsCacheOwnerName.size() + 1;
 
 		TCHAR* pBuffer = new TCHAR[Size];
 
@@ -58,18 +179,14 @@ bool CFilterSearch::OnFilterCache(CGeoCache* pCache)
 }
 
 // Attempt to find a substring in another after making lowercase conversions. Returns 'true' if the substring is found.
-bool CFilterSearch::FindSubstr(TCHAR* pBuffer, long BuffSize, const TCHAR* pSubstr, String& Text)
+bool CFilterSearch::FindSubstr(TCHAR* pBuffer, long BuffSize, const TCHAR* pSubstr, String& Text) const
 {
 	long TextSize = Text.size();
 
 	// Copy the Substring into the provided buffer and convert it to lower case before the comparison
 	for (long I = 0; I < TextSize; I++)
 	{
-#ifdef PPC2K2
-		pBuffer[I] = tolower(Text[I]);
-#else
-		pBuffer[I] = _tolower(Text[I]);
-#endif
+		pBuffer[I] = CTextIndex::Lower(Text[I]);
 	}
 
 	// Terminate the buffer
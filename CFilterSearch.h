@@ -3,32 +3,74 @@
 
 #include "CommonDefs.h"
 #include "CFilterMgr.h"
+#include "CGpxParser.h"
 
 using namespace std;
 
+class CTextIndex;
+
 typedef enum {
 	ExactMatch = 0,
-	PartialMatch
+	PartialMatch,
+	FuzzyMatch
 } StringMatchType;
 
-
+// Keeps the caches whose waypoint, name or owner matches a text, either exactly or partially. When the text
+// index holds the caches being filtered, a partial match is worked out once per filtering pass, in
+// OnBeginFilter(), from the caches sharing the trigrams of the text.
+// A fuzzy match also tolerates a few mistyped characters and needs the index; without it, it is a partial match.
+// Typing one more character only rules caches out as long as the edits tolerated stay the same: the positions
+// matched by the previous pass are then the only ones searched again.
 class CFilterSearch : public CFilterBase
 {
 public:
 	StringMatchType	m_Match;
 	String			m_Text;
 
+protected:
+	// Settings as of the previous filtering pass
+	StringMatchType	m_SignedMatch;
+	String			m_SignedText;
+
+	CTextIndex*		m_pIndex;
+
+	// Caches matching partially during a filtering pass, sorted by address, when the index was searched
+	bool			m_Indexed;
+	GCCont			m_Matches;
+
+	// Text, edits tolerated, index revision and ascending positions matched by the previous fuzzy search
+	String			m_FuzzyText;
+	long			m_FuzzyEdits;
+	long			m_FuzzyRevision;
+	vector<long>	m_FuzzyPositions;
+
+	// Cache needing the fewest edits in the previous fuzzy search
+	CGeoCache*		m_pBest;
+
 public:
 	CFilterSearch(const TCHAR* pText, GcFilter FilterType);
 	virtual ~CFilterSearch();
 
-	virtual bool	OnFilterCache(CGeoCache* pCache);
+	// Sets the text index of the loaded caches
+	void	SetTextIndex(CTextIndex* pIndex);
+
+	// Returns the cache needing the fewest edits in the last fuzzy search, if any
+	CGeoCache*	GetBestMatch();
+
+	virtual void	OnBeginFilter(CGpxParser& Parser);
+
+	virtual bool	OnFilterCache(CGeoCache* pCache) const;
+
+	virtual FilterChange	GetChange();
 
 	virtual void	Serialize(CStream& ar);
 
 protected:
 	// Attempt to find a substring in another after making lowercase conversions. Returns 'true' if the substring is found.
-	bool	FindSubstr(TCHAR* pBuffer, long BuffSize, const TCHAR* pSubstr, String& Text);
+	bool	FindSubstr(TCHAR* pBuffer, long BuffSize, const TCHAR* pSubstr, String& Text) const;
+
+	// Searches the index for the caches matching the text give or take a few edits
+	void	FuzzySearch();
 
 };
 
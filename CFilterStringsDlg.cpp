@@ -2,6 +2,7 @@
 #include "GpxSonar.h"
 #include "CFilterStringsDlg.h"
 #include "CFilterOnStrings.h"
+#include "CFilterFacets.h"
 
 #ifdef _DEBUG
 #define new DEBUG_NEW
@@ -16,6 +17,8 @@ CFilterStringsDlg::CFilterStringsDlg(CWnd* pParent) : CNonFSDialog(CFilterString
 	//}}AFX_DATA_INIT
 
 	m_pFiltStrs = 0;
+	m_pFacets = 0;
+	m_Facet = FacetState;
 }
 
 CFilterStringsDlg::~CFilterStringsDlg()
@@ -57,7 +60,14 @@ BOOL CFilterStringsDlg::OnInitDialog()
 		{
 			CFilteredString* pFS = *S;
 
-			HTREEITEM Item = InsertItem(m_Tree, TVI_ROOT, pFS->m_Str.c_str(), (void*) pFS, GENERIC_STR_BMP);
+			String Text = pFS->m_Str;
+
+			if (m_pFacets)
+			{
+				Text = CFilterFacets::Label(Text.c_str(), m_pFacets->GetStringCount(m_Facet, pFS->m_Str));
+			}
+
+			HTREEITEM Item = InsertItem(m_Tree, TVI_ROOT, Text.c_str(), (void*) pFS, GENERIC_STR_BMP);
 
 			m_Tree.SetCheck(Item, pFS->m_Enabled);
 		}
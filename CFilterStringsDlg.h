@@ -6,8 +6,10 @@
 #endif // _MSC_VER > 1000
 
 #include "NonFSDialog.h"
+#include "CFilterPredicate.h"
 
 class CFilterOnStrings;
+class CFilterFacets;
 
 class CFilterStringsDlg : public CNonFSDialog
 {
@@ -24,6 +26,10 @@ public:
 
 	CFilterOnStrings*	m_pFiltStrs;
 
+	// Counts of the options given the other filters, or null to list the options alone
+	CFilterFacets*	m_pFacets;
+	FilterFacet		m_Facet;	// FacetState or FacetCountry
+
 // Overrides
 	// ClassWizard generated virtual function overrides
 	//{{AFX_VIRTUAL(CFilterStringsDlg)
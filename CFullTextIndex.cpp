@@ -0,0 +1,860 @@
+#include "CFullTextIndex.h"
+#include "CBaseException.h"
+#include "CXmlMap.h"
+#include "CPath.h"
+#include "Literals.h"
+#include <algorithm>
+
+// Posting list of a term while the index is being built
+typedef struct {
+	vector<BYTE>	Bytes;
+	long			Last;
+} FullTextBuild;
+
+typedef map<string, FullTextBuild>				FullTextBuildMap;
+typedef map<string, FullTextBuild>::iterator	itFullTextBuild;
+
+CFullTextIndex::CFullTextIndex()
+{
+	InitializeCriticalSection(&m_Lock);
+
+	m_hThread = NULL;
+	m_bExit = false;
+	m_bReady = false;
+	m_hNotify = NULL;
+	m_Revision = 0;
+	m_pParser = 0;
+
+	Reset();
+}
+
+CFullTextIndex::~CFullTextIndex()
+{
+	Reset();
+
+	DeleteCriticalSection(&m_Lock);
+}
+
+// Starts indexing the caches currently loaded by the parser on a worker thread
+void CFullTextIndex::Start(CGpxParser& Parser, const String& SourceFname, HWND hNotify)
+{
+	Reset();
+
+	CPath	Path;
+	itGC	it;
+
+	m_pParser = &Parser;
+	m_SourceFname = SourceFname;
+	m_Fname = Path.BuildPath(FULL_TEXT_INDEX);
+	m_hNotify = hNotify;
+
+	// The list gets sorted while the worker runs: the worker reads its own copy
+	CGeoCache* pCache = Parser.First(it);
+
+	while (!Parser.EndOfCacheList(it))
+	{
+		m_Caches.push_back(pCache);
+
+		pCache = Parser.Next(it);
+	}
+
+	if (m_Caches.empty())
+	{
+		return;
+	}
+
+	m_bExit = false;
+
+	DWORD ThreadId = 0;
+
+	m_hThread = CreateThread(NULL, 0, ThreadProc, (LPVOID) this, 0, &ThreadId);
+
+	if (m_hThread == NULL)
+	{
+		CBaseException Up;
+
+		Up.m_szSrc = _T("CFullTextIndex::Start()");
+		Up.m_szMsg = _T("Failed to create the indexing thread! The caches will be indexed by the calling thread.");
+		Up.Win32Error();
+		Up.Log();
+
+		Run();
+	}
+	else
+	{
+		// Stay out of the way of the UI
+		SetThreadPriority(m_hThread, THREAD_PRIORITY_BELOW_NORMAL);
+	}
+}
+
+// Stops the worker and empties the index
+void CFullTextIndex::Reset()
+{
+	if (m_hThread)
+	{
+		EnterCriticalSection(&m_Lock);
+		m_bExit = true;
+		LeaveCriticalSection(&m_Lock);
+
+		WaitForSingleObject(m_hThread, INFINITE);
+
+		CloseHandle(m_hThread);
+		m_hThread = NULL;
+	}
+
+	m_Map.Close();
+
+	m_TermStartBuf.clear();
+	m_PostingStartBuf.clear();
+	m_TermPoolBuf.clear();
+	m_PostingBuf.clear();
+
+	m_TermCount = 0;
+	m_pTermStarts = NULL;
+	m_pPostingStarts = NULL;
+	m_pTermPool = NULL;
+	m_pPostings = NULL;
+
+	m_Caches.clear();
+
+	m_bReady = false;
+
+	InterlockedIncrement(&m_Revision);
+}
+
+// Returns 'true' once the index can be searched
+bool CFullTextIndex::IsReady()
+{
+	EnterCriticalSection(&m_Lock);
+	bool Ready = m_bReady;
+	LeaveCriticalSection(&m_Lock);
+
+	return Ready;
+}
+
+// Returns a number that changes each time the index is emptied or becomes ready
+long CFullTextIndex::GetRevision()
+{
+	return m_Revision;
+}
+
+// Returns 'true' once the worker has been told to stop
+bool CFullTextIndex::Cancelled()
+{
+	EnterCriticalSection(&m_Lock);
+	bool Exit = m_bExit;
+	LeaveCriticalSection(&m_Lock);
+
+	return Exit;
+}
+
+// Thread entry point
+DWORD WINAPI CFullTextIndex::ThreadProc(LPVOID pParam)
+{
+	((CFullTextIndex*) pParam)->Run();
+
+	return 0;
+}
+
+// Maps the index written by a previous load of the same GPX file, or builds it
+void CFullTextIndex::Run()
+{
+	if (!Open())
+	{
+		if (!Build())
+		{
+			return;
+		}
+
+		// The mapped file is paged in on demand, the buffers would stay in memory
+		if (Write() && Open())
+		{
+			m_TermStartBuf.clear();
+			m_PostingStartBuf.clear();
+			m_TermPoolBuf.clear();
+			m_PostingBuf.clear();
+		}
+		else
+		{
+			UseBuffers();
+		}
+	}
+
+	EnterCriticalSection(&m_Lock);
+	m_bReady = !m_bExit;
+	LeaveCriticalSection(&m_Lock);
+
+	InterlockedIncrement(&m_Revision);
+
+	if (m_hNotify)
+	{
+		PostMessage(m_hNotify, WM_FULL_TEXT_INDEX_READY, 0, 0);
+	}
+}
+
+// Maps the index file if it was built from the current version of the GPX file and the same caches
+bool CFullTextIndex::Open()
+{
+	DWORD		SourceSize = 0;
+	FILETIME	SourceTime;
+
+	if (!GetSourceInfo(m_SourceFname, SourceSize, SourceTime) || !m_Map.Open(m_Fname))
+	{
+		return false;
+	}
+
+	const BYTE*				pView = m_Map.GetData();
+	DWORD					Size = m_Map.GetSize();
+	const FullTextHeader*	pHeader = (const FullTextHeader*) pView;
+
+	if (Size < sizeof(FullTextHeader) || pHeader->Magic != CFullTextIndexMagic || pHeader->Version != CFullTextIndexVersion ||
+		pHeader->CacheCount != m_Caches.size() || pHeader->SourceSize != SourceSize ||
+		pHeader->SourceTime.dwLowDateTime != SourceTime.dwLowDateTime ||
+		pHeader->SourceTime.dwHighDateTime != SourceTime.dwHighDateTime)
+	{
+		m_Map.Close();
+		return false;
+	}
+
+	// Make sure every part fits in the file before handing out pointers into it
+	DWORD Starts = (pHeader->TermCount + 1) * sizeof(DWORD);
+
+	if (pHeader->TermStartsOffset + Starts > Size || pHeader->PostingStartsOffset + Starts > Size ||
+		pHeader->SourceNameOffset + (m_SourceFname.size() + 1) * sizeof(TCHAR) > Size ||
+		pHeader->TermPoolOffset + pHeader->TermPoolSize > Size || pHeader->PostingsOffset + pHeader->PostingsSize > Size)
+	{
+		m_Map.Close();
+		return false;
+	}
+
+	if (_tcsicmp((const TCHAR*) (pView + pHeader->SourceNameOffset), m_SourceFname.c_str()))
+	{
+		m_Map.Close();
+		return false;
+	}
+
+	m_TermCount = pHeader->TermCount;
+	m_pTermStarts = (const DWORD*) (pView + pHeader->TermStartsOffset);
+	m_pPostingStarts = (const DWORD*) (pView + pHeader->PostingStartsOffset);
+	m_pTermPool = (const char*) (pView + pHeader->TermPoolOffset);
+	m_pPostings = pView + pHeader->PostingsOffset;
+
+	return true;
+}
+
+// Builds the index into the buffers. Returns 'false' if the worker was told to stop.
+bool CFullTextIndex::Build()
+{
+	FullTextBuildMap	Terms;
+	vector<string>		Fields;
+	vector<string>		Tokens;
+	long				Count = m_Caches.size();
+
+	for (long Position = 0; Position < Count; Position++)
+	{
+		if (Cancelled())
+		{
+			return false;
+		}
+
+		Fields.clear();
+
+		ReadCache(Position, Fields);
+
+		for (vector<string>::iterator itField = Fields.begin(); itField != Fields.end(); itField++)
+		{
+			Tokens.clear();
+
+			Tokenize(itField->c_str(), Tokens);
+
+			for (vector<string>::iterator itToken = Tokens.begin(); itToken != Tokens.end(); itToken++)
+			{
+				itFullTextBuild it = Terms.find(*itToken);
+
+				if (it == Terms.end())
+				{
+					FullTextBuild Empty;
+
+					Empty.Last = -1;
+
+					it = Terms.insert(FullTextBuildMap::value_type(*itToken, Empty)).first;
+				}
+
+				// A cache using a word several times is posted once
+				if ((*it).second.Last != Position)
+				{
+					Encode(Position - (*it).second.Last, (*it).second.Bytes);
+
+					(*it).second.Last = Position;
+				}
+			}
+		}
+	}
+
+	// The map is sorted by term: lay the terms and their posting lists out in that order
+	m_TermStartBuf.clear();
+	m_PostingStartBuf.clear();
+	m_TermPoolBuf.clear();
+	m_PostingBuf.clear();
+
+	m_TermStartBuf.reserve(Terms.size() + 1);
+	m_PostingStartBuf.reserve(Terms.size() + 1);
+
+	for (itFullTextBuild it = Terms.begin(); it != Terms.end(); it++)
+	{
+		m_TermStartBuf.push_back(m_TermPoolBuf.size());
+		m_TermPoolBuf.insert(m_TermPoolBuf.end(), (*it).first.begin(), (*it).first.end());
+		m_TermPoolBuf.push_back(0);
+
+		m_PostingStartBuf.push_back(m_PostingBuf.size());
+		m_PostingBuf.insert(m_PostingBuf.end(), (*it).second.Bytes.begin(), (*it).second.Bytes.end());
+	}
+
+	m_TermStartBuf.push_back(m_TermPoolBuf.size());
+	m_PostingStartBuf.push_back(m_PostingBuf.size());
+
+	return true;
+}
+
+// Writes the buffers to the index file
+bool CFullTextIndex::Write()
+{
+	FullTextHeader	Header;
+	DWORD			Terms = m_TermStartBuf.size() - 1;
+
+	ZeroMemory(&Header, sizeof(Header));
+
+	Header.Magic = CFullTextIndexMagic;
+	Header.Version = CFullTextIndexVersion;
+	Header.CacheCount = m_Caches.size();
+	Header.TermCount = Terms;
+
+	if (!GetSourceInfo(m_SourceFname, Header.SourceSize, Header.SourceTime))
+	{
+		return false;
+	}
+
+	FILE* fd = _tfopen(m_Fname.c_str(), _T("wb"));
+
+	if (fd == NULL)
+	{
+		CBaseException Up;
+
+		Up.m_szSrc = _T("CFullTextIndex::Write()");
+		Up.m_szMsg = _T("Failed to create file: ") + m_Fname;
+		Up.Win32Error();
+		Up.Log();
+
+		return false;
+	}
+
+	// The header gets written again once all the offsets are known. The DWORDs come first so that they are aligned.
+	DWORD Offset = fwrite(&Header, 1, sizeof(Header), fd);
+
+	Header.TermStartsOffset = Offset;
+	Offset += fwrite(&m_TermStartBuf[0], sizeof(DWORD), Terms + 1, fd) * sizeof(DWORD);
+
+	Header.PostingStartsOffset = Offset;
+	Offset += fwrite(&m_PostingStartBuf[0], sizeof(DWORD), Terms + 1, fd) * sizeof(DWORD);
+
+	Header.SourceNameOffset = Offset;
+	Offset += fwrite(m_SourceFname.c_str(), sizeof(TCHAR), m_SourceFname.size() + 1, fd) * sizeof(TCHAR);
+
+	Header.TermPoolOffset = Offset;
+	Header.TermPoolSize = m_TermPoolBuf.size();
+	Offset += fwrite(Terms ? &m_TermPoolBuf[0] : NULL, sizeof(char), m_TermPoolBuf.size(), fd);
+
+	Header.PostingsOffset = Offset;
+	Header.PostingsSize = m_PostingBuf.size();
+	Offset += fwrite(Terms ? &m_PostingBuf[0] : NULL, sizeof(BYTE), m_PostingBuf.size(), fd);
+
+	bool Status = true;
+
+	if (fseek(fd, 0, SEEK_SET) || fwrite(&Header, 1, sizeof(Header), fd) != sizeof(Header))
+	{
+		Status = false;
+	}
+
+	if (fclose(fd))
+	{
+		Status = false;
+	}
+
+	if (!Status)
+	{
+		CBaseException Up;
+
+		Up.m_szSrc = _T("CFullTextIndex::Write()");
+		Up.m_szMsg = _T("Failed while writing to: ") + m_Fname;
+		Up.Log();
+
+		DeleteFile(m_Fname.c_str());
+	}
+
+	return Status;
+}
+
+// Points the index at the buffers
+void CFullTextIndex::UseBuffers()
+{
+	m_TermCount = m_TermStartBuf.size() - 1;
+	m_pTermStarts = &m_TermStartBuf[0];
+	m_pPostingStarts = &m_PostingStartBuf[0];
+	m_pTermPool = m_TermPoolBuf.empty() ? NULL : &m_TermPoolBuf[0];
+	m_pPostings = m_PostingBuf.empty() ? NULL : &m_PostingBuf[0];
+}
+
+// Retrieves the text of the descriptions, hints and logs of a cache, one string per field (UTF-8).
+// The logs are read by index: FirstLog() would change the current log entry of the cache under the UI's feet.
+void CFullTextIndex::ReadCache(long Position, vector<string>& Fields)
+{
+	CGeoCache* pCache = m_Caches[Position];
+
+	AddField(pCache->m_GsCacheShortDesc, pCache->m_GsCacheShortDescIsHtml, Fields);
+	AddField(pCache->m_GsCacheLongDesc, pCache->m_GsCacheLongDescIsHtml, Fields);
+	AddField(pCache->m_GsCacheEncodedHints, false, Fields);
+
+	long Logs = pCache->GetLogCount();
+
+	for (long Log = 0; Log < Logs; Log++)
+	{
+		AddField(pCache->GetLog(Log)->m_Text, false, Fields);
+	}
+}
+
+// Appends a field to Fields, reading it back from the text store if it's stored there
+void CFullTextIndex::AddField(const String& Field, bool Html, vector<string>& Fields)
+{
+	Fields.push_back(string());
+
+	string& Text = Fields.back();
+
+	if (Field.substr(0, MEM_MISER_CANARY_SIZE) == MEM_MISER_CANARY)
+	{
+		String	Location(Field);
+		char*	pText = m_pParser->ReadFromTextStore(Location);
+
+		Text = pText;
+
+		delete [] pText;
+	}
+	else
+	{
+		ToUtf8(Field, Text);
+	}
+
+	if (Html)
+	{
+		StripMarkup(Text);
+	}
+}
+
+// Converts a string to UTF-8. The text is converted straight into the string: the w2a() macro would put a copy of
+// a whole cache description on the small stack of the worker thread.
+void CFullTextIndex::ToUtf8(const String& Str, string& Utf8)
+{
+	Utf8.erase();
+
+	if (Str.empty())
+	{
+		return;
+	}
+
+	long Size = WideCharToMultiByte(CP_UTF8, 0, Str.c_str(), Str.size(), NULL, 0, NULL, NULL);
+
+	if (Size <= 0)
+	{
+		return;
+	}
+
+	Utf8.resize(Size);
+
+	WideCharToMultiByte(CP_UTF8, 0, Str.c_str(), Str.size(), &Utf8[0], Size, NULL, NULL);
+}
+
+// Blanks out the HTML tags and character references of a text
+void CFullTextIndex::StripMarkup(string& Text)
+{
+	long Size = Text.size();
+	long Index = 0;
+	long End;
+
+	while (Index < Size)
+	{
+		if (Text[Index] == '<')
+		{
+			for (End = Index; End < Size && Text[End] != '>'; End++);
+		}
+		else if (Text[Index] == '&')
+		{
+			// Such as &amp; or &#39;. A lone '&' is left alone.
+			for (End = Index + 1; End < Size && End - Index < 10 && (isalnum((BYTE) Text[End]) || Text[End] == '#'); End++);
+
+			if (End == Size || Text[End] != ';')
+			{
+				Index++;
+				continue;
+			}
+		}
+		else
+		{
+			Index++;
+			continue;
+		}
+
+		// A blank keeps the words on either side apart
+		for (; Index <= End && Index < Size; Index++)
+		{
+			Text[Index] = ' ';
+		}
+	}
+}
+
+// Splits a text into lowercase words. Bytes of multibyte UTF-8 characters are taken as letters.
+void CFullTextIndex::Tokenize(const char* pText, vector<string>& Tokens)
+{
+	string Token;
+
+	for (const BYTE* pChar = (const BYTE*) pText; ; pChar++)
+	{
+		BYTE Char = *pChar;
+
+		if ((Char >= 'a' && Char <= 'z') || (Char >= '0' && Char <= '9') || Char >= 0x80)
+		{
+			if (Token.size() < FULL_TEXT_MAX_TERM)
+			{
+				Token += (char) Char;
+			}
+		}
+		else if (Char >= 'A' && Char <= 'Z')
+		{
+			if (Token.size() < FULL_TEXT_MAX_TERM)
+			{
+				Token += (char) (Char - 'A' + 'a');
+			}
+		}
+		else
+		{
+			if (!Token.empty())
+			{
+				Tokens.push_back(Token);
+				Token.erase();
+			}
+
+			if (!Char)
+			{
+				break;
+			}
+		}
+	}
+}
+
+// Appends a number to a posting list, seven bits per byte, lowest bits first
+void CFullTextIndex::Encode(DWORD Value, vector<BYTE>& Bytes)
+{
+	while (Value >= 0x80)
+	{
+		Bytes.push_back((BYTE) (Value | 0x80));
+
+		Value >>= 7;
+	}
+
+	Bytes.push_back((BYTE) Value);
+}
+
+// Retrieves the size and the last write time of the source file
+bool CFullTextIndex::GetSourceInfo(const String& SourceFname, DWORD& Size, FILETIME& Time)
+{
+	WIN32_FILE_ATTRIBUTE_DATA Attr;
+
+	ZeroMemory(&Time, sizeof(Time));
+	Size = 0;
+
+	if (!GetFileAttributesEx(SourceFname.c_str(), GetFileExInfoStandard, &Attr))
+	{
+		return false;
+	}
+
+	Size = Attr.nFileSizeLow;
+	Time = Attr.ftLastWriteTime;
+
+	return true;
+}
+
+// Splits a query into its groups, alternatives and words.
+// Words and "quoted phrases" must all match, unless OR joins them: then either one will do.
+void CFullTextIndex::Parse(const String& Query, FullTextQuery& Parsed)
+{
+	string			Text;
+	FullTextTerms	Terms;
+	bool			Or = false;
+
+	Parsed.clear();
+
+	ToUtf8(Query, Text);
+
+	long Size = Text.size();
+	long Index = 0;
+	long Start;
+
+	while (Index < Size)
+	{
+		if (Text[Index] == ' ' || Text[Index] == '\t')
+		{
+			Index++;
+			continue;
+		}
+
+		string Item;
+
+		if (Text[Index] == '"')
+		{
+			Start = ++Index;
+
+			for (; Index < Size && Text[Index] != '"'; Index++);
+
+			Item = Text.substr(Start, Index - Start);
+
+			// Skip the closing quote
+			Index++;
+		}
+		else
+		{
+			Start = Index;
+
+			for (; Index < Size && Text[Index] != ' ' && Text[Index] != '\t' && Text[Index] != '"'; Index++);
+
+			Item = Text.substr(Start, Index - Start);
+
+			if (Item == "OR")
+			{
+				Or = true;
+				continue;
+			}
+
+			if (Item == "AND")
+			{
+				continue;
+			}
+		}
+
+		Terms.clear();
+
+		Tokenize(Item.c_str(), Terms);
+
+		if (Terms.empty())
+		{
+			continue;
+		}
+
+		if (Or && !Parsed.empty())
+		{
+			Parsed.back().push_back(Terms);
+		}
+		else
+		{
+			Parsed.push_back(FullTextGroup(1, Terms));
+		}
+
+		Or = false;
+	}
+}
+
+// Retrieves the positions of the caches holding a term. Returns 'false' if no cache holds it.
+bool CFullTextIndex::Postings(const string& Term, vector<long>& Positions)
+{
+	Positions.clear();
+
+	// The terms are sorted the way the map that built them sorted them
+	long Low = 0;
+	long High = (long) m_TermCount - 1;
+
+	while (Low <= High)
+	{
+		long	Middle = (Low + High) / 2;
+		int		Order = Term.compare(m_pTermPool + m_pTermStarts[Middle]);
+
+		if (Order < 0)
+		{
+			High = Middle - 1;
+		}
+		else if (Order > 0)
+		{
+			Low = Middle + 1;
+		}
+		else
+		{
+			const BYTE*	pByte = m_pPostings + m_pPostingStarts[Middle];
+			const BYTE*	pEnd = m_pPostings + m_pPostingStarts[Middle + 1];
+			long		Position = -1;
+
+			while (pByte < pEnd)
+			{
+				DWORD	Gap = 0;
+				int		Shift = 0;
+				BYTE	Byte;
+
+				do
+				{
+					Byte = *pByte++;
+
+					Gap |= (DWORD) (Byte & 0x7F) << Shift;
+					Shift += 7;
+				}
+				while ((Byte & 0x80) && pByte < pEnd);
+
+				Position += Gap;
+
+				Positions.push_back(Position);
+			}
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Retrieves the positions of the caches holding a word or a phrase
+void CFullTextIndex::Match(const FullTextTerms& Terms, vector<long>& Positions)
+{
+	vector<long>	Term;
+	vector<long>	Common;
+	long			Index;
+
+	Positions.clear();
+
+	for (Index = 0; Index < Terms.size(); Index++)
+	{
+		if (!Postings(Terms[Index], Term))
+		{
+			Positions.clear();
+			return;
+		}
+
+		if (!Index)
+		{
+			Positions.swap(Term);
+		}
+		else
+		{
+			Common.clear();
+
+			set_intersection(Positions.begin(), Positions.end(), Term.begin(), Term.end(), back_inserter(Common));
+
+			Positions.swap(Common);
+		}
+
+		if (Positions.empty())
+		{
+			return;
+		}
+	}
+
+	if (Terms.size() < 2)
+	{
+		return;
+	}
+
+	// Holding every word of a phrase doesn't mean holding them in sequence
+	long Kept = 0;
+
+	for (Index = 0; Index < Positions.size(); Index++)
+	{
+		if (HasPhrase(Positions[Index], Terms))
+		{
+			Positions[Kept++] = Positions[Index];
+		}
+	}
+
+	Positions.resize(Kept);
+}
+
+// Returns 'true' if the words follow each other in a field of the cache
+bool CFullTextIndex::HasPhrase(long Position, const FullTextTerms& Terms)
+{
+	vector<string>	Fields;
+	vector<string>	Tokens;
+
+	ReadCache(Position, Fields);
+
+	for (vector<string>::iterator itField = Fields.begin(); itField != Fields.end(); itField++)
+	{
+		Tokens.clear();
+
+		Tokenize(itField->c_str(), Tokens);
+
+		if (search(Tokens.begin(), Tokens.end(), Terms.begin(), Terms.end()) != Tokens.end())
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Adds to Result the caches matching a query
+bool CFullTextIndex::Search(const String& Query, GCCont& Result)
+{
+	FullTextQuery Parsed;
+
+	if (!IsReady())
+	{
+		return false;
+	}
+
+	Parse(Query, Parsed);
+
+	if (Parsed.empty())
+	{
+		return false;
+	}
+
+	vector<long>	Matches;
+	vector<long>	Group;
+	vector<long>	Item;
+	vector<long>	Merged;
+
+	for (FullTextQuery::iterator itGroup = Parsed.begin(); itGroup != Parsed.end(); itGroup++)
+	{
+		// Any of the alternatives
+		Group.clear();
+
+		for (FullTextGroup::iterator itItem = itGroup->begin(); itItem != itGroup->end(); itItem++)
+		{
+			Match(*itItem, Item);
+
+			Merged.clear();
+
+			set_union(Group.begin(), Group.end(), Item.begin(), Item.end(), back_inserter(Merged));
+
+			Group.swap(Merged);
+		}
+
+		// Every group
+		if (itGroup == Parsed.begin())
+		{
+			Matches.swap(Group);
+		}
+		else
+		{
+			Merged.clear();
+
+			set_intersection(Matches.begin(), Matches.end(), Group.begin(), Group.end(), back_inserter(Merged));
+
+			Matches.swap(Merged);
+		}
+
+		if (Matches.empty())
+		{
+			break;
+		}
+	}
+
+	for (vector<long>::iterator it = Matches.begin(); it != Matches.end(); it++)
+	{
+		Result.push_back(m_Caches[*it]);
+	}
+
+	return true;
+}
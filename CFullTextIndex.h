@@ -0,0 +1,164 @@
+#ifndef _INC_CFullTextIndex
+	#define _INC_CFullTextIndex
+
+#include "CommonDefs.h"
+#include "CMappedFile.h"
+#include "CGpxParser.h"
+#include <vector>
+
+using namespace std;
+
+// Posted to the window passed to CFullTextIndex::Start() once the index can be searched
+#define WM_FULL_TEXT_INDEX_READY	(WM_APP + 1)
+
+// Fixed size header at the beginning of an index file. All offsets are in bytes from the beginning of the file.
+typedef struct {
+	DWORD		Magic;
+	DWORD		Version;
+	DWORD		CacheCount;
+	DWORD		SourceSize;
+	FILETIME	SourceTime;
+	DWORD		TermCount;
+	DWORD		TermStartsOffset;
+	DWORD		PostingStartsOffset;
+	DWORD		SourceNameOffset;
+	DWORD		TermPoolOffset;
+	DWORD		TermPoolSize;
+	DWORD		PostingsOffset;
+	DWORD		PostingsSize;
+} FullTextHeader;
+
+// A query: groups that must all match, each group being alternatives joined by OR, each alternative a word or a phrase
+typedef vector<string>			FullTextTerms;
+typedef vector<FullTextTerms>	FullTextGroup;
+typedef vector<FullTextGroup>	FullTextQuery;
+
+// Inverted index of the words of the descriptions, hints and logs of the loaded caches.
+// The words are cut at the characters that are neither letters nor digits, ASCII letters are lowercased and HTML
+// markup is skipped. Each word (term) has a posting list: the ascending positions of the caches using it, stored as
+// the gaps between them, seven bits per byte. The terms are sorted so that a query binary searches them.
+// Descriptions and logs sit in the text store: reading them all back takes a while, so the index is built by a
+// worker thread after the load and the window given to Start() is told when it is ready. The index is then written
+// next to the text store and mapped from there; loading the same GPX file again maps it rather than rebuilding it.
+// Queries are words, which must all be found, "quoted phrases", whose words must follow each other, and OR between
+// two of those to accept either. The index only finds the caches holding every word of a phrase: these are then
+// read back to check the order.
+// The index holds pointers to the caches: Reset() must be called before the parser loads another file.
+class CFullTextIndex
+{
+	#define CFullTextIndexMagic		0x58495446	// 'FTIX'
+	#define CFullTextIndexVersion	100
+
+	// Longest word indexed, in bytes. Longer words are cut, the same way when indexing and when searching.
+	#define FULL_TEXT_MAX_TERM		24
+
+protected:
+	CRITICAL_SECTION	m_Lock;
+	HANDLE				m_hThread;
+	bool				m_bExit;
+	bool				m_bReady;
+	HWND				m_hNotify;
+
+	// Incremented each time the index is emptied or becomes ready
+	LONG				m_Revision;
+
+	CGpxParser*			m_pParser;
+	String				m_SourceFname;
+	String				m_Fname;
+
+	// Caches in the order of the cache list when the index was started
+	GCCont				m_Caches;
+
+	// Index built by the worker, until it is written to disk and mapped
+	vector<DWORD>		m_TermStartBuf;
+	vector<DWORD>		m_PostingStartBuf;
+	vector<char>		m_TermPoolBuf;
+	vector<BYTE>		m_PostingBuf;
+
+	CMappedFile			m_Map;
+
+	// The terms, null terminated, and their posting lists, either in the mapped file or in the buffers.
+	// There is one more start than terms, for the end of the last one.
+	DWORD				m_TermCount;
+	const DWORD*		m_pTermStarts;
+	const DWORD*		m_pPostingStarts;
+	const char*			m_pTermPool;
+	const BYTE*			m_pPostings;
+
+public:
+	CFullTextIndex();
+	~CFullTextIndex();
+
+	// Starts indexing the caches currently loaded by the parser on a worker thread. SourceFname is the GPX file they
+	// were loaded from and hNotify the window told when the index is ready.
+	void	Start(CGpxParser& Parser, const String& SourceFname, HWND hNotify);
+
+	// Stops the worker and empties the index
+	void	Reset();
+
+	// Returns 'true' once the index can be searched
+	bool	IsReady();
+
+	// Returns a number that changes each time the index is emptied or becomes ready
+	long	GetRevision();
+
+	// Adds to Result the caches matching a query. Returns 'false' if the index is not ready or the query has no word.
+	bool	Search(const String& Query, GCCont& Result);
+
+	// Splits a query into its groups, alternatives and words
+	static void	Parse(const String& Query, FullTextQuery& Parsed);
+
+protected:
+	// Thread entry point
+	static DWORD WINAPI	ThreadProc(LPVOID pParam);
+
+	// Maps the index written by a previous load of the same GPX file, or builds it
+	void	Run();
+
+	// Returns 'true' once the worker has been told to stop
+	bool	Cancelled();
+
+	// Maps the index file if it was built from the current version of the GPX file and the same caches
+	bool	Open();
+
+	// Builds the index into the buffers. Returns 'false' if the worker was told to stop.
+	bool	Build();
+
+	// Writes the buffers to the index file
+	bool	Write();
+
+	// Points the index at the buffers
+	void	UseBuffers();
+
+	// Retrieves the text of the descriptions, hints and logs of a cache, one string per field (UTF-8)
+	void	ReadCache(long Position, vector<string>& Fields);
+
+	// Appends a field to Fields, reading it back from the text store if it's stored there
+	void	AddField(const String& Field, bool Html, vector<string>& Fields);
+
+	// Retrieves the positions of the caches holding a term. Returns 'false' if no cache holds it.
+	bool	Postings(const string& Term, vector<long>& Positions);
+
+	// Retrieves the positions of the caches holding a word or a phrase
+	void	Match(const FullTextTerms& Terms, vector<long>& Positions);
+
+	// Returns 'true' if the words follow each other in a field of the cache
+	bool	HasPhrase(long Position, const FullTextTerms& Terms);
+
+	// Splits a text into lowercase words
+	static void	Tokenize(const char* pText, vector<string>& Tokens);
+
+	// Blanks out the HTML tags and character references of a text
+	static void	StripMarkup(string& Text);
+
+	// Converts a string to UTF-8
+	static void	ToUtf8(const String& Str, string& Utf8);
+
+	// Appends a number to a posting list, seven bits per byte, lowest bits first
+	static void	Encode(DWORD Value, vector<BYTE>& Bytes);
+
+	// Retrieves the size and the last write time of the source file
+	static bool	GetSourceInfo(const String& SourceFname, DWORD& Size, FILETIME& Time);
+};
+
+#endif
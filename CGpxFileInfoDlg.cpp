@@ -6,6 +6,8 @@
 #include "CHeading.h"
 #include "IDB_CACHES.h"
 #include "CFieldNoteMgr.h"
+#include "CFilterMgr.h"
+#include "CFilterFacets.h"
 
 #ifdef _DEBUG
 #define new DEBUG_NEW
@@ -20,6 +22,7 @@ CGpxFileInfoDlg::CGpxFileInfoDlg(CWnd* pParent /*=NULL*/) : CDialog(CGpxFileInfo
 	//}}AFX_DATA_INIT
 
 	m_pNotesMgr = 0;
+	m_pFilterMgr = 0;
 }
 
 CGpxFileInfoDlg::~CGpxFileInfoDlg()
@@ -79,90 +82,12 @@ BOOL CGpxFileInfoDlg::OnInitDialog()
 		m_CacheList.InsertColumn(Col++, (*I)->m_Name.c_str(), LVCFMT_LEFT, (*I)->m_Length);
 	}
 	
-	itGC		C;
-
-	int Traditional = 0;
-	int Multi = 0;
-	int Virtual = 0;
-	int Webcam = 0;
-	int Unknown = 0;
-	int LetterboxHybrid = 0;
-	int Event = 0;
-	int ProjectAPE = 0;
-	int Locationless = 0;
-	int CITO = 0;
-	int Earth = 0;
-	int TBs = 0;
-	int Disabled = 0;
-	int Archived = 0;
-	int Found = 0;
-	int Notes = 0;
-
-	// Gather the numbers for each type of cache
-	CGeoCache* pCache = pGpxParser->First(C);
-
-	while (!pGpxParser->EndOfCacheList(C))
-	{
-		TBs += pCache->GetTBCount();
-
-		if (!pCache->m_Sym.empty())
-		{
-			Found++;
-		}
-
-		if (pCache->m_pFieldNote)
-		{
-			Notes++;
-		}
-
-		if (pCache->m_GsCacheArchived)
-		{
-			Archived++;
-		}
-
-		if (!pCache->m_GsCacheAvailable)
-		{
-			Disabled++;
-		}
-
-		switch (pCache->m_GcType)
-		{
-		case GT_Traditional:
-			Traditional++;
-			break;
-		case GT_Multi:
-			Multi++;
-			break;
-		case GT_Virtual:
-			Virtual++;
-			break;
-		case GT_Webcam:
-			Webcam++;
-			break;
-		case GT_Unknown:
-			Unknown++;
-			break;
-		case GT_LetterboxHybrid:
-			LetterboxHybrid++;
-			break;
-		case GT_Event:
-			Event++;
-			break;
-		case GT_ProjectAPE:
-			ProjectAPE++;
-			break;
-		case GT_Locationless:
-			Locationless++;
-			break;
-		case GT_CITO:
-			CITO++;
-			break;
-		case GT_Earthcache:
-			Earth++;
-			break;
-		}
+	CFilterFacets Facets;
 
-		pCache = pGpxParser->Next(C);
+	// The numbers for each type of cache are taken along with the counts of the filter options
+	if (m_pFilterMgr)
+	{
+		m_pFilterMgr->CountFacets(*pGpxParser, Facets);
 	}
 
 	int Item = 0;
@@ -172,27 +97,52 @@ BOOL CGpxFileInfoDlg::OnInitDialog()
 
 	InsertStatLine(Item, (GcType) (EMPTY_BITMAP), _T("--- Statistics ---"), -1);
 
-	InsertStatLine(Item, (GcType) (TB_PRESENT), _T("Travel Bugs"), TBs);
-	InsertStatLine(Item, GT_Traditional, _T("Traditional"), Traditional);
-	InsertStatLine(Item, GT_Multi, _T("Multi"), Multi);
-	InsertStatLine(Item, GT_Virtual, _T("Virtual"), Virtual);
-	InsertStatLine(Item, GT_Webcam, _T("Webcam"), Webcam);
-	InsertStatLine(Item, GT_Unknown, _T("Unknown"), Unknown);
-	InsertStatLine(Item, GT_LetterboxHybrid, _T("Letterbox Hybrid"), LetterboxHybrid);
-	InsertStatLine(Item, GT_Event, _T("Event"), Event);
-	InsertStatLine(Item, GT_ProjectAPE, _T("Project APE"), ProjectAPE);
-	InsertStatLine(Item, GT_Locationless, _T("Locationless"), Locationless);
-	InsertStatLine(Item, GT_CITO, _T("CITO"), CITO);
-	InsertStatLine(Item, GT_Earthcache, _T("Earthcache"), Earth);
+	InsertStatLine(Item, (GcType) (TB_PRESENT), _T("Travel Bugs"), Facets.m_TravelBugs);
+	InsertStatLine(Item, GT_Traditional, _T("Traditional"), Facets.GetTotal(FacetType, GT_Traditional));
+	InsertStatLine(Item, GT_Multi, _T("Multi"), Facets.GetTotal(FacetType, GT_Multi));
+	InsertStatLine(Item, GT_Virtual, _T("Virtual"), Facets.GetTotal(FacetType, GT_Virtual));
+	InsertStatLine(Item, GT_Webcam, _T("Webcam"), Facets.GetTotal(FacetType, GT_Webcam));
+	InsertStatLine(Item, GT_Unknown, _T("Unknown"), Facets.GetTotal(FacetType, GT_Unknown));
+	InsertStatLine(Item, GT_LetterboxHybrid, _T("Letterbox Hybrid"), Facets.GetTotal(FacetType, GT_LetterboxHybrid));
+	InsertStatLine(Item, GT_Event, _T("Event"), Facets.GetTotal(FacetType, GT_Event));
+	InsertStatLine(Item, GT_ProjectAPE, _T("Project APE"), Facets.GetTotal(FacetType, GT_ProjectAPE));
+	InsertStatLine(Item, GT_Locationless, _T("Locationless"), Facets.GetTotal(FacetType, GT_Locationless));
+	InsertStatLine(Item, GT_CITO, _T("CITO"), Facets.GetTotal(FacetType, GT_CITO));
+	InsertStatLine(Item, GT_Earthcache, _T("Earthcache"), Facets.GetTotal(FacetType, GT_Earthcache));
 
 	InsertStatLine(Item, (GcType) (EMPTY_BITMAP), _T("--- Other ---"), -1);
 
-	InsertStatLine(Item, (GcType) (FOUND_CACHE), _T("Found Caches"), Found);
-	InsertStatLine(Item, (GcType) (FIELD_NOTE), _T("Visible Field Notes"), Notes);
+	InsertStatLine(Item, (GcType) (FOUND_CACHE), _T("Found Caches"), Facets.GetFlagCount(CA_FOUND));
+	InsertStatLine(Item, (GcType) (FIELD_NOTE), _T("Visible Field Notes"), Facets.GetFlagCount(CA_FIELDNOTE));
 	InsertStatLine(Item, (GcType) (FIELD_NOTE), _T("Total Field Notes"), m_pNotesMgr->Size());
 
-	InsertStatLine(Item, (GcType) (CACHE_ARCHIVED), _T("Archived Caches"), Archived);
-	InsertStatLine(Item, (GcType) (CACHE_DISABLED), _T("Disabled Caches"), Disabled);
+	InsertStatLine(Item, (GcType) (CACHE_ARCHIVED), _T("Archived Caches"), Facets.GetFlagCount(CA_ARCHIVED));
+	InsertStatLine(Item, (GcType) (CACHE_DISABLED), _T("Disabled Caches"), Facets.GetFlagCount(CA_DISABLED));
+
+#ifdef _DEBUG
+	if (m_pFilterMgr)
+	{
+		InsertStatLine(Item, (GcType) (EMPTY_BITMAP), _T("--- Filters ---"), -1);
+
+		InsertFilterStats(Item, _T("Compiled Filters"), m_pFilterMgr->GetCompiledStats());
+
+		itFilter F;
+
+		// Only the filters that aren't compiled keep statistics of their own
+		for (CFilterBase* pFilter = m_pFilterMgr->First(F); pFilter; pFilter = m_pFilterMgr->Next(F))
+		{
+			if (pFilter->IsEnabled() && pFilter->m_Stats.m_Passes)
+			{
+				InsertFilterStats(Item, pFilter->GetName().c_str(), pFilter->m_Stats);
+			}
+		}
+	}
+
+	InsertStatLine(Item, (GcType) (EMPTY_BITMAP), _T("--- Distances ---"), -1);
+
+	// Vincenty computations that fell back to a great circle since the application started
+	InsertStatLine(Item, (GcType) (EMPTY_BITMAP), _T("Vincenty Fallbacks"), CLatLon::m_VincentyFallbacks);
+#endif
 
 	return TRUE;  // return TRUE unless you set the focus to a control
 	              // EXCEPTION: OCX Property Pages should return FALSE
@@ -204,7 +154,6 @@ void CGpxFileInfoDlg::InsertStatLine(int& Line, GcType Type, const TCHAR* pText,
 	{
 		#define MAX_BUFFER_SIZE  20
 
-		LVITEM		Item;
 		TCHAR		Buffer[MAX_BUFFER_SIZE];
 
 		if (Count >= 0)
@@ -216,22 +165,44 @@ void CGpxFileInfoDlg::InsertStatLine(int& Line, GcType Type, const TCHAR* pText,
 			Buffer[0] = 0;
 		}
 
-		// Image / Text of cache type
-		Item.mask =  LVIF_IMAGE | LVIF_TEXT;
-		Item.iItem = Line;
-		Item.iSubItem = 0;
-		Item.iImage = Type;
-		Item.pszText = (TCHAR*) pText;
+		InsertStatText(Line, Type, pText, Buffer);
+	}
+}
 
-		m_CacheList.InsertItem(&Item);
-		
-		// Count for this type
-		Item.mask =  LVIF_TEXT;
-		Item.iSubItem++;
-		Item.pszText = Buffer;
+void CGpxFileInfoDlg::InsertStatText(int& Line, GcType Type, const TCHAR* pText, const TCHAR* pValue)
+{
+	LVITEM		Item;
 
-		m_CacheList.SetItem(&Item);
+	// Image / Text of cache type
+	Item.mask =  LVIF_IMAGE | LVIF_TEXT;
+	Item.iItem = Line;
+	Item.iSubItem = 0;
+	Item.iImage = Type;
+	Item.pszText = (TCHAR*) pText;
 
-		Line++;
-	}
+	m_CacheList.InsertItem(&Item);
+	
+	// Count for this type
+	Item.mask =  LVIF_TEXT;
+	Item.iSubItem++;
+	Item.pszText = (TCHAR*) pValue;
+
+	m_CacheList.SetItem(&Item);
+
+	Line++;
+}
+
+// Debug builds show how the filters fared during the last filtering pass: the share of the caches
+// rejected and the time taken per cache, both averaged over the passes
+void CGpxFileInfoDlg::InsertFilterStats(int& Line, const TCHAR* pName, CFilterStats& Stats)
+{
+	#define MAX_STATS_SIZE  32
+
+	TCHAR		Buffer[MAX_STATS_SIZE];
+
+	_sntprintf(Buffer, MAX_STATS_SIZE, _T("%i%% %.2fus"), (int) (Stats.m_RejectRate * 100.0 + 0.5), Stats.m_Cost);
+
+	Buffer[MAX_STATS_SIZE - 1] = 0;
+
+	InsertStatText(Line, (GcType) (EMPTY_BITMAP), pName, Buffer);
 }
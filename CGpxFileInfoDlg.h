@@ -8,6 +8,8 @@
 #include "CGpxParser.h"
 
 class CFieldNoteMgr;
+class CFilterMgr;
+class CFilterStats;
 
 class CGpxFileInfoDlg : public CDialog
 {
@@ -25,6 +27,7 @@ public:
 	CString			m_SavedGpxFilename;
 	CImageList		m_ImageList;
 	CFieldNoteMgr*	m_pNotesMgr;
+	CFilterMgr*		m_pFilterMgr;
 
 // Overrides
 	// ClassWizard generated virtual function overrides
@@ -43,6 +46,10 @@ protected:
 	DECLARE_MESSAGE_MAP()
 
 	void InsertStatLine(int& Line, GcType Type, const TCHAR* pText, int Count);
+	void InsertStatText(int& Line, GcType Type, const TCHAR* pText, const TCHAR* pValue);
+
+	// Debug builds show how the filters fared during the last filtering pass
+	void InsertFilterStats(int& Line, const TCHAR* pName, CFilterStats& Stats);
 };
 
 //{{AFX_INSERT_LOCATION}}
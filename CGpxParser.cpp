@@ -99,6 +99,7 @@ void CGeoCache::InitializeInternalState()
 
 	m_Lat = 0.0;
 	m_Long = 0.0;
+	m_Point.Prepare(0.0, 0.0);
 	memset(&m_CreationTime,sizeof(m_CreationTime), 0);
 	m_GsCacheId = 0;
 	m_pFieldNote = 0;
@@ -110,12 +111,24 @@ void CGeoCache::InitializeInternalState()
 	m_pCurrTB = 0;
 	m_WpMgr = 0;
 	m_Distance = 0;
+	m_DistanceState = GD_None;
+	m_Bearing = GB_Unknown;
 
 	m_GcType = GT_NotInitialized;
+	m_GcContainer = GC_NotInitialized;
 
 	m_Category = NO_CATEGORY;
 }
 
+// Moves the cache and prepares the new coordinates for the distance computations
+void CGeoCache::SetCoords(double Lat, double Long)
+{
+	m_Lat = Lat;
+	m_Long = Long;
+
+	m_Point.Prepare(m_Lat, m_Long);
+}
+
 // Add a new log entry to the cache
 void CGeoCache::AddLogEntry(CGeoCacheLogEntry* pLogEntry)
 {
@@ -174,6 +187,18 @@ CGeoCacheLogEntry* CGeoCache::FirstLog(itGCLogEntry& it)
 	return m_pCurrCLE;
 }
 
+// Returns the # of log entries
+long CGeoCache::GetLogCount()
+{
+	return m_Logs.size();
+}
+
+// Returns a log entry by its position. Unlike FirstLog(), doesn't change the current log entry.
+CGeoCacheLogEntry* CGeoCache::GetLog(long Index)
+{
+	return m_Logs[Index];
+}
+
 // Returns a pointer to the next log entry in the list. The iterator is set to end() at the end of the list.
 CGeoCacheLogEntry* CGeoCache::NextLog(itGCLogEntry& it)
 {
@@ -312,6 +337,11 @@ GcType CGeoCache::TypeLookup()
 // Returns an enumerated value for the string container of the cache
 GcContainer	CGeoCache::ContainerLookup()
 {
+	if (m_GcContainer != GC_NotInitialized)
+	{
+		return m_GcContainer;
+	}
+
 	if (m_CacheContainerMap.empty())
 	{
 		m_CacheContainerMap[CONT_UNKNOWN] = GC_Unknown;
@@ -327,12 +357,14 @@ GcContainer	CGeoCache::ContainerLookup()
 
 	if (it != m_CacheContainerMap.end())
 	{
-		return (*it).second;
+		m_GcContainer = (*it).second;
 	}
 	else
 	{
-		return GC_Unknown;
+		m_GcContainer = GC_Unknown;
 	}
+
+	return m_GcContainer;
 }
 
 // Removes all log entries
@@ -478,6 +510,8 @@ void CGeoCache::Serialize(CStream& ar)
 		{
 			m_Category = NO_CATEGORY;
 		}
+
+		m_Point.Prepare(m_Lat, m_Long);
 	}
 }
 
@@ -495,6 +529,8 @@ CGpxParser::CGpxParser()
 	m_StripImgTags = false;
 	m_pTextStore = 0;
 
+	InitializeCriticalSection(&m_TextStoreLock);
+
 	m_pCaches = &m_Caches;
 
 	if (!pInst)
@@ -519,6 +555,8 @@ CGpxParser::~CGpxParser()
 
 		pInst = 0;
 	}
+
+	DeleteCriticalSection(&m_TextStoreLock);
 }
 
 CGpxParser*	CGpxParser::GetInstance()
@@ -932,6 +970,9 @@ GpxLoadStatus CGpxParser::Load(const String& GpxFile, bool AlterGlobalState)
 
 	if (Status == GpxLoadStatusOk)
 	{
+		// Prepare the coordinates of the caches for the distance computations
+		PrepareCoordinates();
+
 		// Build the Country / State maps
 		UpdateBuiltInMaps();
 	}
@@ -939,6 +980,15 @@ GpxLoadStatus CGpxParser::Load(const String& GpxFile, bool AlterGlobalState)
 	return Status;
 }
 
+// Prepare the coordinates of the caches for the distance computations
+void CGpxParser::PrepareCoordinates()
+{
+	for (itGC I = m_pCaches->begin(); I != m_pCaches->end(); I++)
+	{
+		(*I)->m_Point.Prepare((*I)->m_Lat, (*I)->m_Long);
+	}
+}
+
 // Build the Country / State maps
 void CGpxParser::UpdateBuiltInMaps()
 {
@@ -1162,7 +1212,11 @@ void CGpxParser::OpenTextStore()
 
 	CPath	Path;
 
+	EnterCriticalSection(&m_TextStoreLock);
+
 	m_pTextStore = _tfopen(Path.BuildPath(TEXT_STORE).c_str(), _T("w+b"));
+
+	LeaveCriticalSection(&m_TextStoreLock);
 }
 
 // Initialize the variables related to the Text Store
@@ -1179,11 +1233,15 @@ void CGpxParser::CloseTextStore()
 		return;
 	}
 
+	EnterCriticalSection(&m_TextStoreLock);
+
 	if (m_pTextStore)
 	{
 		fclose(m_pTextStore);
 		m_pTextStore = 0;
 	}
+
+	LeaveCriticalSection(&m_TextStoreLock);
 }
 
 // Get the position where the next write I/O will take place
@@ -1200,17 +1258,26 @@ void CGpxParser::WriteTextStore(BYTE* pData, long Length)
 		return;
 	}
 
+	EnterCriticalSection(&m_TextStoreLock);
+
 	if (m_pTextStore)
 	{
 		fwrite(pData, sizeof(char), Length, m_pTextStore);
 
 		m_WriteTextStoreOffset += Length;
 	}
+
+	LeaveCriticalSection(&m_TextStoreLock);
 }
 
-// Read a block of text from the store based on the content of the location passed as a string
+// Read a block of text from the store based on the content of the location passed as a string.
+// The text is always allocated, even when it's empty or couldn't be read, so that the caller can delete it.
 char* CGpxParser::ReadFromTextStore(String& Location)
 {
+	char* pText;
+
+	EnterCriticalSection(&m_TextStoreLock);
+
 	if (m_pTextStore)
 	{
 		#define	MAX_LOCATION_SIZE 50
@@ -1232,24 +1299,27 @@ char* CGpxParser::ReadFromTextStore(String& Location)
 		// Extract the Length value
 		long Length = _ttol(_tcstok(NULL, _T("&")));
 
-		if (!Length)
-		{
-			return "";
-		}
+		pText = new char[Length+1];
 
-		char* pText = new char[Length+1];
+		pText[0] = 0;
 
-		if (!fseek(m_pTextStore, Offset, SEEK_SET))
+		if (Length && !fseek(m_pTextStore, Offset, SEEK_SET))
 		{
 			long Read = fread(pText, sizeof(char), Length, m_pTextStore);
 
 			pText[Read] = 0;
 		}
+	}
+	else
+	{
+		pText = new char[sizeof("Failed")];
 
-		return pText;
+		strcpy(pText, "Failed");
 	}
 
-	return "Failed";
+	LeaveCriticalSection(&m_TextStoreLock);
+
+	return pText;
 }
 
 // Serialize some state information used by the parser to handle the text store
@@ -1287,7 +1357,61 @@ void CGpxParser::Serialize(CStream& ar)
 // Sort the caches according to their distance from the center
 void CGpxParser::SortByDistance()
 {
-	sort( m_pCaches->begin(), m_pCaches->end(), SortByDistanceImpl);
+	// Above one run per 8 caches, merging the runs is no faster than sorting from scratch
+	#define NATURAL_MERGE_MAX_RUN_RATIO	8
+
+	GCCont&			Caches = *m_pCaches;
+	long			Count = Caches.size();
+	vector<long>	Runs;
+	long			Index;
+
+	// Locate the start of each ascending run
+	Runs.push_back(0);
+
+	for (Index = 1; Index < Count; Index++)
+	{
+		if (SortByDistanceImpl(Caches[Index], Caches[Index - 1]))
+		{
+			Runs.push_back(Index);
+		}
+	}
+
+	if (Runs.size() == 1)
+	{
+		// Already sorted
+		return;
+	}
+
+	if (Runs.size() > (Count / NATURAL_MERGE_MAX_RUN_RATIO))
+	{
+		sort(Caches.begin(), Caches.end(), SortByDistanceImpl);
+		return;
+	}
+
+	Runs.push_back(Count);
+
+	// Merge adjacent runs two by two until a single one is left
+	while (Runs.size() > 2)
+	{
+		vector<long>	Merged;
+
+		for (Index = 0; Index + 2 < Runs.size(); Index += 2)
+		{
+			inplace_merge(Caches.begin() + Runs[Index], Caches.begin() + Runs[Index + 1], Caches.begin() + Runs[Index + 2], SortByDistanceImpl);
+
+			Merged.push_back(Runs[Index]);
+		}
+
+		// Odd run left over
+		if (Index + 1 < Runs.size())
+		{
+			Merged.push_back(Runs[Index]);
+		}
+
+		Merged.push_back(Count);
+
+		Runs.swap(Merged);
+	}
 }
 
 // Function used to sort caches by proximity
@@ -5,6 +5,7 @@
 #include "CXmlMap.h"
 #include ".\Expat\expat.h"
 #include "CDynStr.h"
+#include "Coord.h"
 
 typedef enum {
 	GT_NotInitialized = -1,
@@ -42,6 +43,7 @@ typedef enum {
 #define TYPE_EARTHCACHE				_T("Earthcache")
 
 typedef enum {
+	GC_NotInitialized = -1,
 	GC_Unknown = 0,
 	GC_Micro,
 	GC_Small,
@@ -72,6 +74,30 @@ typedef enum {
 	LOG_TemporarilyDisableListing
 } GcLogType;
 
+typedef enum {
+	GD_None = 0,	// Not computed: the cache is beyond the radius of the bearing/distance filter
+	GD_Approx,		// Spherical estimate, see CLatLon::m_HaversineError
+	GD_Exact		// Vincenty
+} GcDistance;
+
+// Distance of the caches whose distance is not computed. Sorts them last and fails the bearing/distance filter.
+// Only the caches beyond the radius of that filter are left without a distance: CGpxSonarView::RefineDistances()
+// estimates them as soon as the filter is disabled or its radius grows, before the other filters look at them.
+#define DISTANCE_UNKNOWN	1.0e30
+
+// Points of the compass, clockwise from the north. Also the bits of CFilterBearingDistance::m_DisabledBearings.
+typedef enum {
+	GB_North = 0,
+	GB_NorthEast,
+	GB_East,
+	GB_SouthEast,
+	GB_South,
+	GB_SouthWest,
+	GB_West,
+	GB_NorthWest,
+	GB_Unknown		// Not computed, sorts last
+} GcBearing;
+
 class CTravelBug
 {
 public:
@@ -131,6 +157,8 @@ public:
 
 	double		m_Lat;
 	double		m_Long;
+	// Coordinates prepared for the distance computations, kept in sync with m_Lat / m_Long by the parser and SetCoords()
+	CPreparedPoint	m_Point;
 	SYSTEMTIME	m_CreationTime;
 	String		m_Shortname;
 
@@ -144,12 +172,14 @@ public:
 
 	// GroundSpeak Extensions
 	GcType		m_GcType;
+	GcContainer	m_GcContainer;
 	bool		m_GsCacheAvailable;
 	bool		m_GsCacheArchived;
 	bool		m_GsCacheShortDescIsHtml;
 	bool		m_GsCacheLongDescIsHtml;
 	long		m_GsCacheId;
 	double		m_Distance;
+	GcDistance	m_DistanceState;
 	double		m_GsCacheDifficulty;
 	double		m_GsCacheTerrain;
 	String		m_Sym;
@@ -163,7 +193,7 @@ public:
 	String		m_GsCacheShortDesc;
 	String		m_GsCacheLongDesc;
 	String		m_GsCacheEncodedHints;
-	String		m_Bearing;
+	GcBearing	m_Bearing;
 	String		m_Category;
 
 	// !0 if a note has been associated with the cache
@@ -188,6 +218,9 @@ public:
 	CGeoCache();
 	virtual ~CGeoCache();
 
+	// Moves the cache and prepares the new coordinates for the distance computations
+	void						SetCoords(double Lat, double Long);
+
 	// Add a new log entry to the cache. The last log entry to be added is made the current one and it can be accessed through CurrentLogEntry().
 	void						AddLogEntry(CGeoCacheLogEntry* pLogEntry);
 
@@ -207,6 +240,10 @@ public:
 	// Returns a pointer to the first log entry in the list. The iterator is set to end() at the end of the list.
 	CGeoCacheLogEntry*			FirstLog(itGCLogEntry& it);
 
+	// Returns the # of log entries and a log entry by its position. Unlike FirstLog(), doesn't change the current log entry.
+	long						GetLogCount();
+	CGeoCacheLogEntry*			GetLog(long Index);
+
 	// Returns a pointer to the next log entry in the list. The iterator is set to end() at the end of the list.
 	CGeoCacheLogEntry*			NextLog(itGCLogEntry& it);
 
@@ -275,6 +312,8 @@ private:
 	// This file is used to store text which would normally be in memory. It is accessed based on an offset from the beginning of the file + a length
 	FILE*		m_pTextStore;
 	long		m_WriteTextStoreOffset;
+	// Guards the text store, which the full text index reads from another thread
+	CRITICAL_SECTION	m_TextStoreLock;
 	CGeoCache*	m_pCurCache;
 	CDynStr		m_CData;
 	double		m_Version;
@@ -321,7 +360,7 @@ public:
 	// Serialize some state information used by the parser to handle the text store
 	void		Serialize(CStream& ar);
 
-	// Read a block of text from the store based on the content of the location passed as a string
+	// Read a block of text from the store based on the content of the location passed as a string. The caller deletes the text.
 	char*		ReadFromTextStore(String& Location);
 
 	// Returns the text msg of the last error
@@ -336,7 +375,8 @@ public:
 	// Set the pointer to the current cache container. Returns the pointer to the old one.
 	GCCont*		SetCacheContainer(GCCont* pCont);
 
-	// Sort the caches according to their distance from the center
+	// Sort the caches according to their distance from the center.
+	// Cheap when the caches are already nearly sorted, such as after a small move of the center.
 	void		SortByDistance();
 
 	// Enables / Disables stripping <IMG SRC=""> tags
@@ -356,6 +396,9 @@ private:
 	// Build the Country / State maps
 	void UpdateBuiltInMaps();
 
+	// Prepare the coordinates of the caches for the distance computations
+	void PrepareCoordinates();
+
 	void BuildXmlMap();
 
 	void MapAttr(const char* pElem, const char* pAttr, const char* pFormat, void* pVar);
@@ -1,5 +1,6 @@
 #include "StdAfx.h"
 #include "CHeading.h"
+#include "CSchema.h"
 
 CHeading::CHeading()
 {
@@ -18,32 +19,14 @@ CHeading::CHeading(int Id, const String& Name, int Length, PFNLVCOMPARE pSortFun
 
 void CHeading::Serialize(CStream& ar)
 {
-	#define CHeadingVersion	100
+	CSchema Schema;
 
-	if (ar.IsStoring())
-	{
-		ar << CHeadingVersion;
-		ar << m_Id;
-		ar << m_Name;
-		ar << m_Length;
-		ar << m_SortToggle;
-		ar << m_Visible;
-		ar << m_Searchable;
-	}
-	else
-	{
-		int Version;
+	Schema.Add(m_Id, 100);
+	Schema.Add(m_Name, 100);
+	Schema.Add(m_Length, 100);
+	Schema.Add(m_SortToggle, 100);
+	Schema.Add(m_Visible, 100);
+	Schema.Add(m_Searchable, 100);
 
-		ar >> Version;
-
-		if (Version >= 100)
-		{
-			ar >> m_Id;
-			ar >> m_Name;
-			ar >> m_Length;
-			ar >> m_SortToggle;
-			ar >> m_Visible;
-			ar >> m_Searchable;
-		}
-	}
+	Schema.Serialize(ar);
 }
@@ -0,0 +1,116 @@
+#include "CMappedFile.h"
+#include "CBaseException.h"
+
+CMappedFile::CMappedFile()
+{
+	m_hFile = INVALID_HANDLE_VALUE;
+	m_hMap = NULL;
+	m_pView = NULL;
+	m_Size = 0;
+}
+
+CMappedFile::~CMappedFile()
+{
+	Close();
+}
+
+// Maps the file read-only. Returns false if the file can't be opened or mapped.
+bool CMappedFile::Open(const String& szFilename)
+{
+	Close();
+
+	#ifdef _WIN32_WCE
+	// Files must be opened with CreateFileForMapping() on CE in order to be mapped
+	m_hFile = CreateFileForMapping(szFilename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	#else
+	m_hFile = CreateFile(szFilename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	#endif
+
+	if (m_hFile == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	m_Size = GetFileSize(m_hFile, NULL);
+
+	// Empty files can't be mapped
+	if (!m_Size || m_Size == 0xFFFFFFFF)
+	{
+		Close();
+		return false;
+	}
+
+	m_hMap = CreateFileMapping(m_hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+
+	if (m_hMap == NULL)
+	{
+		CBaseException Up;
+
+		Up.m_szSrc = _T("CMappedFile::Open()");
+		Up.m_szMsg = _T("Failed to create the file mapping: ") + szFilename;
+		Up.Win32Error();
+		Up.Log();
+
+		Close();
+		return false;
+	}
+
+	m_pView = (const BYTE*) MapViewOfFile(m_hMap, FILE_MAP_READ, 0, 0, 0);
+
+	if (m_pView == NULL)
+	{
+		CBaseException Up;
+
+		Up.m_szSrc = _T("CMappedFile::Open()");
+		Up.m_szMsg = _T("Failed to map a view of: ") + szFilename;
+		Up.Win32Error();
+		Up.Log();
+
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+// Unmaps the view and closes the file
+void CMappedFile::Close()
+{
+	if (m_pView)
+	{
+		UnmapViewOfFile((LPVOID) m_pView);
+		m_pView = NULL;
+	}
+
+	if (m_hMap)
+	{
+		CloseHandle(m_hMap);
+		m_hMap = NULL;
+	}
+
+	if (m_hFile != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_hFile);
+		m_hFile = INVALID_HANDLE_VALUE;
+	}
+
+	m_Size = 0;
+}
+
+// Returns true when a file is currently mapped
+bool CMappedFile::IsOpen()
+{
+	return (m_pView != NULL);
+}
+
+// Returns the first byte of the view
+const BYTE* CMappedFile::GetData()
+{
+	return m_pView;
+}
+
+// Returns the size of the view in bytes
+DWORD CMappedFile::GetSize()
+{
+	return m_Size;
+}
@@ -0,0 +1,36 @@
+#ifndef _INC_CMappedFile
+	#define _INC_CMappedFile
+
+#include "CommonDefs.h"
+
+// Read-only view of a whole file mapped into memory.
+// The pages are backed by the file itself: nothing is copied and the OS can discard them under memory pressure.
+class CMappedFile
+{
+protected:
+	HANDLE		m_hFile;
+	HANDLE		m_hMap;
+	const BYTE*	m_pView;
+	DWORD		m_Size;
+
+public:
+	CMappedFile();
+	~CMappedFile();
+
+	// Maps the file read-only. Returns false if the file can't be opened or mapped.
+	bool		Open(const String& szFilename);
+
+	// Unmaps the view and closes the file
+	void		Close();
+
+	// Returns true when a file is currently mapped
+	bool		IsOpen();
+
+	// Returns the first byte of the view
+	const BYTE*	GetData();
+
+	// Returns the size of the view in bytes
+	DWORD		GetSize();
+};
+
+#endif
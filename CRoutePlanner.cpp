@@ -0,0 +1,379 @@
+#include "CRoutePlanner.h"
+#include "CBaseException.h"
+#include "Coord.h"
+#include <algorithm>
+
+CRoutePlanner::CRoutePlanner()
+{
+	m_Count = 0;
+	m_Start = 0;
+	m_Budget = 0;
+	m_BestLength = 0.0;
+	m_Stale = 0;
+
+	InitializeCriticalSection(&m_Lock);
+}
+
+CRoutePlanner::~CRoutePlanner()
+{
+	DeleteCriticalSection(&m_Lock);
+}
+
+// Reorders the caches into a short route starting at the first one, within a time budget in milliseconds
+void CRoutePlanner::Plan(GCCont& Caches, DWORD Budget)
+{
+	m_Count = Caches.size();
+
+	// Nothing to choose from
+	if (m_Count <= 2)
+	{
+		return;
+	}
+
+	m_Start = GetTickCount();
+	m_Budget = Budget;
+
+	BuildMatrix(Caches);
+
+	m_Best.clear();
+	m_BestLength = 0.0;
+	m_Stale = 0;
+
+	RouteWorker	Workers[ROUTE_PLANNER_THREADS];
+	HANDLE		Threads[ROUTE_PLANNER_THREADS];
+	long		Index;
+
+	for (Index = 0; Index < ROUTE_PLANNER_THREADS; Index++)
+	{
+		Workers[Index].pPlanner = this;
+		Workers[Index].Seed = m_Start + Index;
+		Workers[Index].Randomize = (Index != 0);
+
+		DWORD ThreadId = 0;
+
+		Threads[Index] = CreateThread(NULL, 0, ThreadProc, (LPVOID) &Workers[Index], 0, &ThreadId);
+
+		if (Threads[Index] == NULL)
+		{
+			CBaseException Up;
+
+			Up.m_szSrc = _T("CRoutePlanner::Plan()");
+			Up.m_szMsg = _T("Failed to create a planning thread! The route will be planned by the calling thread.");
+			Up.Win32Error();
+			Up.Log();
+
+			Run(Workers[Index].Seed, Workers[Index].Randomize);
+		}
+	}
+
+	for (Index = 0; Index < ROUTE_PLANNER_THREADS; Index++)
+	{
+		if (Threads[Index])
+		{
+			WaitForSingleObject(Threads[Index], INFINITE);
+			CloseHandle(Threads[Index]);
+		}
+	}
+
+	GCCont	Unordered(Caches);
+
+	for (Index = 0; Index < m_Count; Index++)
+	{
+		Caches[Index] = Unordered[m_Best[Index]];
+	}
+
+	m_Matrix.clear();
+}
+
+// Estimates the distance between every pair of caches
+void CRoutePlanner::BuildMatrix(GCCont& Caches)
+{
+	vector<CPreparedPoint>	Points(m_Count);
+	vector<double>			Row(m_Count);
+	vector<double>			Azimuth(m_Count);
+	long					From, To;
+
+	for (From = 0; From < m_Count; From++)
+	{
+		Points[From] = Caches[From]->m_Point;
+	}
+
+	m_Matrix.resize(Cell(m_Count, 0));
+
+	// The distances are symmetric: compute each pair once, from the cache with the lower index
+	for (From = 0; From + 1 < m_Count; From++)
+	{
+		Points[From].HaversineDistances(&Points[From + 1], m_Count - From - 1, &Row[0], &Azimuth[0]);
+
+		for (To = From + 1; To < m_Count; To++)
+		{
+			m_Matrix[Cell(To, From)] = (float) Row[To - From - 1];
+		}
+	}
+}
+
+// Length in meters of a route
+double CRoutePlanner::Length(vector<long>& Route)
+{
+	double Meters = 0.0;
+
+	for (long Index = 1; Index < (long) Route.size(); Index++)
+	{
+		Meters += Distance(Route[Index - 1], Route[Index]);
+	}
+
+	return Meters;
+}
+
+// Returns 'true' once the time budget is spent
+bool CRoutePlanner::Expired()
+{
+	// Unsigned arithmetic copes with the tick count wrapping around
+	return (GetTickCount() - m_Start >= m_Budget);
+}
+
+// Thread entry point
+DWORD WINAPI CRoutePlanner::ThreadProc(LPVOID pParam)
+{
+	RouteWorker* pWorker = (RouteWorker*) pParam;
+
+	pWorker->pPlanner->Run(pWorker->Seed, pWorker->Randomize);
+
+	return 0;
+}
+
+// Runs restarts until the search is over
+void CRoutePlanner::Run(DWORD Seed, bool Randomize)
+{
+	vector<long>	Route;
+	bool			Improved;
+
+	do
+	{
+		NearestNeighbour(Route, Randomize ? &Seed : NULL);
+
+		do
+		{
+			Improved = TwoOpt(Route);
+
+			if (OrOpt(Route))
+			{
+				Improved = true;
+			}
+		}
+		while (Improved && !Expired());
+
+		Randomize = true;
+	}
+	while (Offer(Route) && !Expired());
+}
+
+// Builds a route by walking to the nearest cache not visited yet (or sometimes the second nearest)
+void CRoutePlanner::NearestNeighbour(vector<long>& Route, DWORD* pSeed)
+{
+	vector<bool>	Visited(m_Count, false);
+	long			Current = 0;
+	long			Nearest, Second, To;
+
+	Route.clear();
+	Route.push_back(Current);
+	Visited[Current] = true;
+
+	while ((long) Route.size() < m_Count)
+	{
+		Nearest = Second = -1;
+
+		for (To = 0; To < m_Count; To++)
+		{
+			if (Visited[To])
+			{
+				continue;
+			}
+
+			if (Nearest < 0 || Distance(Current, To) < Distance(Current, Nearest))
+			{
+				Second = Nearest;
+				Nearest = To;
+			}
+			else if (Second < 0 || Distance(Current, To) < Distance(Current, Second))
+			{
+				Second = To;
+			}
+		}
+
+		// One time out of three, go to the second nearest
+		if (pSeed && Second >= 0 && Random(pSeed) % 3 == 0)
+		{
+			Nearest = Second;
+		}
+
+		Current = Nearest;
+
+		Route.push_back(Current);
+		Visited[Current] = true;
+	}
+}
+
+// Reverses parts of the route as long as it makes it shorter. The route is open: the last cache is not linked
+// back to the first one, which stays in place.
+bool CRoutePlanner::TwoOpt(vector<long>& Route)
+{
+	bool	Changed = false;
+	bool	Improved;
+	long	I, J;
+	double	Delta;
+
+	do
+	{
+		Improved = false;
+
+		for (I = 0; I + 2 < m_Count; I++)
+		{
+			if (Expired())
+			{
+				return Changed;
+			}
+
+			for (J = I + 2; J < m_Count; J++)
+			{
+				// Replace links I -> I + 1 and J -> J + 1 with I -> J and I + 1 -> J + 1
+				Delta = Distance(Route[I], Route[J]) - Distance(Route[I], Route[I + 1]);
+
+				if (J + 1 < m_Count)
+				{
+					Delta += Distance(Route[I + 1], Route[J + 1]) - Distance(Route[J], Route[J + 1]);
+				}
+
+				if (Delta < -ROUTE_PLANNER_EPSILON)
+				{
+					reverse(Route.begin() + I + 1, Route.begin() + J + 1);
+
+					Improved = Changed = true;
+				}
+			}
+		}
+	}
+	while (Improved);
+
+	return Changed;
+}
+
+// Moves runs of caches elsewhere in the route, possibly reversed, as long as it makes it shorter
+bool CRoutePlanner::OrOpt(vector<long>& Route)
+{
+	bool	Changed = false;
+	bool	Improved;
+	long	Size, I, P, Prev, First, Last, Next, A, B, To;
+	double	Gain, Cost, Reversed;
+
+	do
+	{
+		Improved = false;
+
+		for (Size = 1; Size <= ROUTE_PLANNER_OR_OPT_LENGTH; Size++)
+		{
+			if (Expired())
+			{
+				return Changed;
+			}
+
+			for (I = 1; I + Size <= m_Count; I++)
+			{
+				Prev = Route[I - 1];
+				First = Route[I];
+				Last = Route[I + Size - 1];
+				Next = (I + Size < m_Count) ? Route[I + Size] : -1;
+
+				// Taking the run out
+				Gain = Distance(Prev, First);
+
+				if (Next >= 0)
+				{
+					Gain += Distance(Last, Next) - Distance(Prev, Next);
+				}
+
+				for (P = 0; P < m_Count; P++)
+				{
+					// Already there, or inside the run
+					if (P >= I - 1 && P <= I + Size - 1)
+					{
+						continue;
+					}
+
+					A = Route[P];
+					B = (P + 1 < m_Count) ? Route[P + 1] : -1;
+
+					// Putting the run back between A and B
+					Cost = Distance(A, First);
+					Reversed = Distance(A, Last);
+
+					if (B >= 0)
+					{
+						Cost += Distance(Last, B) - Distance(A, B);
+						Reversed += Distance(First, B) - Distance(A, B);
+					}
+
+					if (Cost >= Gain - ROUTE_PLANNER_EPSILON && Reversed >= Gain - ROUTE_PLANNER_EPSILON)
+					{
+						continue;
+					}
+
+					vector<long> Moved(Route.begin() + I, Route.begin() + I + Size);
+
+					if (Reversed < Cost)
+					{
+						reverse(Moved.begin(), Moved.end());
+					}
+
+					Route.erase(Route.begin() + I, Route.begin() + I + Size);
+
+					// Once the run is out, the caches after it moved back
+					To = (P < I) ? P + 1 : P - Size + 1;
+
+					Route.insert(Route.begin() + To, Moved.begin(), Moved.end());
+
+					Improved = Changed = true;
+					break;
+				}
+			}
+		}
+	}
+	while (Improved);
+
+	return Changed;
+}
+
+// Records a route if it is the best so far. Returns 'false' when the search should stop.
+bool CRoutePlanner::Offer(vector<long>& Route)
+{
+	double	Meters = Length(Route);
+	bool	Continue;
+
+	EnterCriticalSection(&m_Lock);
+
+	if (m_Best.empty() || Meters < m_BestLength - ROUTE_PLANNER_EPSILON)
+	{
+		m_Best = Route;
+		m_BestLength = Meters;
+		m_Stale = 0;
+	}
+	else
+	{
+		m_Stale++;
+	}
+
+	// A handful of caches leaves little to explore
+	Continue = (m_Stale < ROUTE_PLANNER_MAX_STALE_RESTARTS && m_Count > 3);
+
+	LeaveCriticalSection(&m_Lock);
+
+	return Continue;
+}
+
+// Pseudo random numbers, one sequence per thread
+long CRoutePlanner::Random(DWORD* pSeed)
+{
+	*pSeed = *pSeed * 1103515245 + 12345;
+
+	return (*pSeed >> 16) & 0x7FFF;
+}
@@ -0,0 +1,105 @@
+#ifndef _INC_CRoutePlanner
+	#define _INC_CRoutePlanner
+
+#include "CommonDefs.h"
+#include "CGpxParser.h"
+#include <vector>
+
+using namespace std;
+
+// Orders a set of caches into a short path that starts at the first cache and visits every other one once.
+// The distances between the caches are estimated once (see CPreparedPoint::HaversineDistances()) and kept in a matrix.
+// The distances are symmetric: only the lower triangle is stored, which halves the memory of the matrix.
+// Routes are built by a nearest neighbour walk, then improved by 2-opt (reversing part of the route) and
+// Or-opt (moving up to three consecutive caches elsewhere) until neither finds a shorter route.
+// The first walk always goes to the nearest cache, the following ones sometimes pick the second nearest
+// instead. Several threads run these restarts until the time budget runs out or the best route stops improving.
+class CRoutePlanner
+{
+	// Number of threads running restarts
+	#define ROUTE_PLANNER_THREADS				2
+	// Default time budget in milliseconds
+	#define ROUTE_PLANNER_TIME_BUDGET			3000
+	// Restarts in a row that did not improve the best route, after which the search stops
+	#define ROUTE_PLANNER_MAX_STALE_RESTARTS	50
+	// Longest run of caches moved by Or-opt
+	#define ROUTE_PLANNER_OR_OPT_LENGTH			3
+	// Smallest improvement in meters worth a move
+	#define ROUTE_PLANNER_EPSILON				0.01
+
+	// Parameters of a thread
+	typedef struct {
+		CRoutePlanner*	pPlanner;
+		DWORD			Seed;
+		bool			Randomize;
+	} RouteWorker;
+
+protected:
+	long				m_Count;
+	vector<float>		m_Matrix;
+
+	DWORD				m_Start;
+	DWORD				m_Budget;
+
+	CRITICAL_SECTION	m_Lock;
+	vector<long>		m_Best;
+	double				m_BestLength;
+	long				m_Stale;
+
+public:
+	CRoutePlanner();
+	~CRoutePlanner();
+
+	// Reorders the caches into a short route starting at the first one, within a time budget in milliseconds
+	void	Plan(GCCont& Caches, DWORD Budget = ROUTE_PLANNER_TIME_BUDGET);
+
+protected:
+	// Estimates the distance between every pair of caches
+	void	BuildMatrix(GCCont& Caches);
+
+	// Distance in meters between two caches of the route
+	double	Distance(long From, long To)
+	{
+		if (From < To)
+		{
+			return m_Matrix[Cell(To, From)];
+		}
+
+		return (From == To) ? 0.0 : m_Matrix[Cell(From, To)];
+	}
+
+	// Index in the lower triangle of the matrix of the distance between two caches. Row must be above Column.
+	static long	Cell(long Row, long Column)
+	{
+		return (Row * (Row - 1)) / 2 + Column;
+	}
+
+	// Length in meters of a route
+	double	Length(vector<long>& Route);
+
+	// Returns 'true' once the time budget is spent
+	bool	Expired();
+
+	// Thread entry point
+	static DWORD WINAPI	ThreadProc(LPVOID pParam);
+
+	// Runs restarts until the search is over
+	void	Run(DWORD Seed, bool Randomize);
+
+	// Builds a route by walking to the nearest cache not visited yet (or sometimes the second nearest)
+	void	NearestNeighbour(vector<long>& Route, DWORD* pSeed);
+
+	// Reverses parts of the route as long as it makes it shorter. Returns 'true' if the route changed.
+	bool	TwoOpt(vector<long>& Route);
+
+	// Moves runs of caches elsewhere in the route as long as it makes it shorter. Returns 'true' if the route changed.
+	bool	OrOpt(vector<long>& Route);
+
+	// Records a route if it is the best so far. Returns 'false' when the search should stop.
+	bool	Offer(vector<long>& Route);
+
+	// Pseudo random numbers, one sequence per thread
+	static long	Random(DWORD* pSeed);
+};
+
+#endif
@@ -0,0 +1,166 @@
+#include "CSchema.h"
+#include "CBaseException.h"
+
+CSchema::CSchema()
+{
+	m_Count = 0;
+}
+
+// Adds a member of the object to the schema, with the version of Serialize() that introduced it
+void CSchema::Add(String& Member, int Since)
+{
+	AddField(SchemaString, &Member, Since);
+}
+
+void CSchema::Add(bool& Member, int Since)
+{
+	AddField(SchemaBool, &Member, Since);
+}
+
+void CSchema::Add(int& Member, int Since)
+{
+	AddField(SchemaInt, &Member, Since);
+}
+
+void CSchema::Add(long& Member, int Since)
+{
+	AddField(SchemaLong, &Member, Since);
+}
+
+void CSchema::Add(DWORD& Member, int Since)
+{
+	AddField(SchemaDWORD, &Member, Since);
+}
+
+void CSchema::Add(double& Member, int Since)
+{
+	AddField(SchemaDouble, &Member, Since);
+}
+
+void CSchema::Add(SYSTEMTIME& Member, int Since)
+{
+	AddField(SchemaSystemTime, &Member, Since);
+}
+
+// Adds a field of any type
+void CSchema::AddField(SchemaFieldType Type, void* pMember, int Since)
+{
+	if (m_Count == SchemaMaxFields)
+	{
+		CBaseException Up;
+
+		Up.m_dwError = 0;
+		Up.m_szSrc = _T("CSchema::AddField()");
+		Up.m_szMsg = _T("Too many fields! Raise SchemaMaxFields.");
+		Up.Log();
+		return;
+	}
+
+	m_Fields[m_Count].Type = Type;
+	m_Fields[m_Count].pMember = pMember;
+	m_Fields[m_Count].Since = Since;
+
+	m_Count++;
+}
+
+// Serializes the members added to the schema
+void CSchema::Serialize(CStream& ar)
+{
+	int I;
+
+	if (ar.IsStoring())
+	{
+		int Version = 0;
+
+		for (I = 0; I < m_Count; I++)
+		{
+			if (m_Fields[I].Since > Version)
+			{
+				Version = m_Fields[I].Since;
+			}
+		}
+
+		ar << Version;
+
+		for (I = 0; I < m_Count; I++)
+		{
+			Write(ar, m_Fields[I]);
+		}
+	}
+	else
+	{
+		int Version = 0;
+
+		ar >> Version;
+
+		for (I = 0; I < m_Count; I++)
+		{
+			if (m_Fields[I].Since <= Version)
+			{
+				Read(ar, m_Fields[I]);
+			}
+		}
+	}
+}
+
+// Writes the value of a member
+void CSchema::Write(CStream& ar, const SchemaField& Field)
+{
+	void* pMember = Field.pMember;
+
+	switch (Field.Type)
+	{
+	case SchemaString:
+		ar << *((String*) pMember);
+		break;
+	case SchemaBool:
+		ar << *((bool*) pMember);
+		break;
+	case SchemaInt:
+		ar << *((int*) pMember);
+		break;
+	case SchemaLong:
+		ar << *((long*) pMember);
+		break;
+	case SchemaDWORD:
+		ar << *((DWORD*) pMember);
+		break;
+	case SchemaDouble:
+		ar << *((double*) pMember);
+		break;
+	case SchemaSystemTime:
+		ar << *((SYSTEMTIME*) pMember);
+		break;
+	}
+}
+
+// Reads the value of a member
+void CSchema::Read(CStream& ar, const SchemaField& Field)
+{
+	void* pMember = Field.pMember;
+
+	switch (Field.Type)
+	{
+	case SchemaString:
+		ar >> *((String*) pMember);
+		break;
+	case SchemaBool:
+		ar >> *((bool*) pMember);
+		break;
+	case SchemaInt:
+		ar >> *((int*) pMember);
+		break;
+	case SchemaLong:
+		ar >> *((long*) pMember);
+		break;
+	case SchemaDWORD:
+		ar >> *((DWORD*) pMember);
+		break;
+	case SchemaDouble:
+		ar >> *((double*) pMember);
+		break;
+	case SchemaSystemTime:
+		ar >> *((SYSTEMTIME*) pMember);
+		break;
+	}
+}
@@ -0,0 +1,69 @@
+#ifndef _INC_CSchema
+	#define _INC_CSchema
+
+#include "CommonDefs.h"
+#include "CStream.h"
+
+// Types of the members that can be described by a schema
+typedef enum {
+	SchemaString = 0,
+	SchemaBool,
+	SchemaInt,
+	SchemaLong,
+	SchemaDWORD,
+	SchemaDouble,
+	SchemaSystemTime
+} SchemaFieldType;
+
+// Describes one member of an object for CSchema::Serialize()
+typedef struct {
+	SchemaFieldType	Type;
+	// The member itself
+	void*			pMember;
+	// Version of Serialize() that introduced the field
+	int				Since;
+} SchemaField;
+
+// Reads and writes the members of an object instead of a hand-written Serialize() ladder.
+// The object's Serialize() adds its members, then serializes the schema. The type of each field follows
+// from the overload of Add(). Enumerations go through a local int.
+//
+// The stream has the layout of the ladders: the version, which is the highest Since of the fields, then the
+// value of every field in the order of Add(). On the way back in, a field is read if the version of the stream
+// is at or above its Since, otherwise it keeps the value set by the constructor. A new member is added last,
+// with a new Since, just as a ladder would bump its version.
+class CSchema
+{
+	#define SchemaMaxFields			16
+
+protected:
+	SchemaField		m_Fields[SchemaMaxFields];
+	int				m_Count;
+
+public:
+	CSchema();
+
+	// Adds a member of the object to the schema, with the version of Serialize() that introduced it
+	void			Add(String& Member, int Since);
+	void			Add(bool& Member, int Since);
+	void			Add(int& Member, int Since);
+	void			Add(long& Member, int Since);
+	void			Add(DWORD& Member, int Since);
+	void			Add(double& Member, int Since);
+	void			Add(SYSTEMTIME& Member, int Since);
+
+	// Serializes the members added to the schema
+	void			Serialize(CStream& ar);
+
+protected:
+	// Adds a field of any type
+	void			AddField(SchemaFieldType Type, void* pMember, int Since);
+
+	// Writes the value of a member
+	static void		Write(CStream& ar, const SchemaField& Field);
+
+	// Reads the value of a member
+	static void		Read(CStream& ar, const SchemaField& Field);
+};
+
+#endif
@@ -14,6 +14,7 @@ CSearchDlg::CSearchDlg(CWnd* pParent): CNonFSDialog(CSearchDlg::IDD, pParent)
 {
 	m_pSearch = 0;
 	m_ShowEnableSearch = false;
+	m_hLiveWnd = NULL;
 
 	//{{AFX_DATA_INIT(CSearchDlg)
 	m_Match = ExactMatch;
@@ -42,6 +43,9 @@ void CSearchDlg::DoDataExchange(CDataExchange* pDX)
 BEGIN_MESSAGE_MAP(CSearchDlg, CNonFSDialog)
 	//{{AFX_MSG_MAP(CSearchDlg)
 	ON_BN_CLICKED(IDC_ENABLE_SEARCH, OnEnableSearch)
+	ON_EN_CHANGE(IDC_TEXT, OnChangeText)
+	ON_WM_TIMER()
+	ON_WM_DESTROY()
 	//}}AFX_MSG_MAP
 END_MESSAGE_MAP()
 
@@ -63,6 +67,8 @@ BOOL CSearchDlg::OnInitDialog()
 
 	m_ModHash = HashValues();
 
+	GetWindowText(m_Caption);
+
 	UpdateData(false);
 	
 	m_TextCtl.SetFocus();
@@ -86,7 +92,8 @@ String CSearchDlg::HashValues()
 	return Hash.Final();
 }
 
-void CSearchDlg::OnCancel() 
+// Hands the settings of the dialog to the filter
+void CSearchDlg::Apply()
 {
 	UpdateData(true);
 
@@ -95,6 +102,13 @@ void CSearchDlg::OnCancel()
 	m_pSearch->m_Match = (StringMatchType) m_Match;
 	m_pSearch->m_Text = (LPCTSTR) m_Text;
 	m_pSearch->Enable((bool) m_EnableSearch);
+}
+
+void CSearchDlg::OnCancel() 
+{
+	KillTimer(SEARCH_TIMER);
+
+	Apply();
 
 	::SHSipPreference(m_hWnd, SIP_DOWN);
 
@@ -113,6 +127,49 @@ void CSearchDlg::OnEnableSearch()
 	UpdateData(true);
 }
 
+// Each keystroke restarts the timer: the list is only refreshed once the typing pauses
+void CSearchDlg::OnChangeText() 
+{
+	if (m_hLiveWnd)
+	{
+		SetTimer(SEARCH_TIMER, SEARCH_TIMER_DELAY, NULL);
+	}
+}
+
+void CSearchDlg::OnTimer(UINT nIDEvent) 
+{
+	if (nIDEvent != SEARCH_TIMER)
+	{
+		CNonFSDialog::OnTimer(nIDEvent);
+		return;
+	}
+
+	KillTimer(SEARCH_TIMER);
+
+	// Typing something to look for means searching for it
+	if (m_TextCtl.GetWindowTextLength() && m_ShowEnableSearch)
+	{
+		m_EnableSearchCtl.SetCheck(1);
+	}
+
+	Apply();
+
+	long Count = ::SendMessage(m_hLiveWnd, WM_SEARCH_CHANGED, 0, 0);
+
+	CString Caption;
+
+	Caption.Format(_T("%s (%d)"), (LPCTSTR) m_Caption, Count);
+
+	SetWindowText(Caption);
+}
+
+void CSearchDlg::OnDestroy() 
+{
+	KillTimer(SEARCH_TIMER);
+
+	CNonFSDialog::OnDestroy();
+}
+
 BOOL CSearchDlg::PreTranslateMessage(MSG* pMsg) 
 {
     switch (pMsg->message)
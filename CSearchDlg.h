@@ -9,13 +9,24 @@
 
 class CFilterSearch;
 
+// Sent to the live window while the text is typed, once the search settings are applied. The window refreshes the
+// cache list and returns the number of caches listed.
+#define WM_SEARCH_CHANGED	(WM_APP + 2)
+
 class CSearchDlg : public CNonFSDialog
 {
+	// Delay after the last keystroke before the search is applied
+	#define SEARCH_TIMER		1968
+	#define SEARCH_TIMER_DELAY	250
+
 public:
 	CFilterSearch*	m_pSearch;
 
 	bool			m_ShowEnableSearch;
 
+	// Window refreshing its list as the text is typed, if any
+	HWND			m_hLiveWnd;
+
 // Construction
 public:
 	CSearchDlg(CWnd* pParent = NULL);
@@ -43,16 +54,23 @@ public:
 // Implementation
 protected:
 	String	m_ModHash;
+	CString	m_Caption;
 
 	// Generated message map functions
 	//{{AFX_MSG(CSearchDlg)
 	virtual BOOL OnInitDialog();
 	virtual void OnCancel();
 	afx_msg void OnEnableSearch();
+	afx_msg void OnChangeText();
+	afx_msg void OnTimer(UINT nIDEvent);
+	afx_msg void OnDestroy();
 	//}}AFX_MSG
 	DECLARE_MESSAGE_MAP()
 
 	String	HashValues();
+
+	// Hands the settings of the dialog to the filter
+	void	Apply();
 };
 
 //{{AFX_INSERT_LOCATION}}
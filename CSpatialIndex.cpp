@@ -0,0 +1,718 @@
+#include "CSpatialIndex.h"
+#include "Coord.h"
+#include <algorithm>
+
+typedef pair<DWORD, long>	SpatialKey;
+typedef pair<double, long>	SpatialRank;
+
+CSpatialIndex::CSpatialIndex()
+{
+	Reset();
+}
+
+void CSpatialIndex::Reset()
+{
+	m_MinLat = 0.0;
+	m_MinLong = 0.0;
+	m_MaxLat = 0.0;
+	m_MaxLong = 0.0;
+	m_CellHeight = 0.0;
+	m_CellWidth = 0.0;
+	m_Rows = 0;
+	m_Cols = 0;
+	m_Wrap = false;
+	m_MaxCellCount = 0;
+
+	m_Points.clear();
+	m_Caches.clear();
+	m_Cells.clear();
+}
+
+bool CSpatialIndex::IsEmpty()
+{
+	return m_Cells.empty();
+}
+
+// Indexes the caches currently loaded by the parser
+void CSpatialIndex::Build(CGpxParser& Parser)
+{
+	Reset();
+
+	itGC	it;
+	long	Index;
+
+	CGeoCache* pCache = Parser.First(it);
+
+	while (!Parser.EndOfCacheList(it))
+	{
+		if (m_Caches.empty())
+		{
+			m_MinLat = m_MaxLat = pCache->m_Lat;
+			m_MinLong = m_MaxLong = pCache->m_Long;
+		}
+
+		Extend(m_MinLat, m_MinLong, m_MaxLat, m_MaxLong, pCache);
+
+		m_Caches.push_back(pCache);
+
+		pCache = Parser.Next(it);
+	}
+
+	long Count = m_Caches.size();
+
+	if (!Count)
+	{
+		return;
+	}
+
+	// Caches spread over more than half of the globe: the columns cover every longitude and wrap around
+	if (m_MaxLong - m_MinLong > 180.0)
+	{
+		m_Wrap = true;
+		m_MinLong = -180.0;
+		m_MaxLong = 180.0;
+	}
+
+	// Start with cells sized for an even spread over the bounding box. Caches are clustered, so keep halving the
+	// cells as long as the cell of an average cache holds too many of them. Sparse areas end up with many single
+	// cache cells, which is why the occupancy is not averaged over the cells.
+	double			CellSize = sqrt((m_MaxLat - m_MinLat) * (m_MaxLong - m_MinLong) * SPATIAL_CELL_OCCUPANCY / Count);
+	vector<DWORD>	Keys;
+	vector<DWORD>	Sorted;
+	double			Occupancy;
+	long			Run;
+
+	for (;;)
+	{
+		ComputeKeys(CellSize, Keys);
+
+		Sorted = Keys;
+		sort(Sorted.begin(), Sorted.end());
+
+		// Sum of the squared cell counts
+		Occupancy = 0.0;
+
+		for (Index = 0; Index < Count; Index += Run)
+		{
+			for (Run = 1; Index + Run < Count && Sorted[Index + Run] == Sorted[Index]; Run++);
+
+			Occupancy += (double) Run * Run;
+		}
+
+		if (Occupancy <= (double) Count * SPATIAL_CELL_OCCUPANCY * 2 || m_CellHeight <= SPATIAL_MIN_CELL_SIZE)
+		{
+			break;
+		}
+
+		CellSize = m_CellHeight / 2.0;
+	}
+
+	// Sort the caches by cell
+	vector<SpatialKey>	Order(Count);
+
+	for (Index = 0; Index < Count; Index++)
+	{
+		Order[Index] = SpatialKey(Keys[Index], Index);
+	}
+
+	sort(Order.begin(), Order.end());
+
+	GCCont	Caches(m_Caches);
+
+	m_Points.resize(Count);
+
+	for (Index = 0; Index < Count; Index++)
+	{
+		pCache = Caches[Order[Index].second];
+
+		m_Caches[Index] = pCache;
+		m_Points[Index] = pCache->m_Point;
+
+		// First cache of a cell
+		if (m_Cells.empty() || m_Cells.back().Key != Order[Index].first)
+		{
+			SpatialCell	Cell;
+
+			Cell.Key = Order[Index].first;
+			Cell.First = Index;
+			Cell.Count = 0;
+			Cell.MinLat = Cell.MaxLat = pCache->m_Lat;
+			Cell.MinLong = Cell.MaxLong = pCache->m_Long;
+
+			m_Cells.push_back(Cell);
+		}
+
+		SpatialCell& Cell = m_Cells.back();
+
+		Cell.Count++;
+
+		Extend(Cell.MinLat, Cell.MinLong, Cell.MaxLat, Cell.MaxLong, pCache);
+
+		if (Cell.Count > m_MaxCellCount)
+		{
+			m_MaxCellCount = Cell.Count;
+		}
+	}
+
+}
+
+// Grows a bounding box to include a cache
+void CSpatialIndex::Extend(double& MinLat, double& MinLong, double& MaxLat, double& MaxLong, CGeoCache* pCache)
+{
+	if (pCache->m_Lat < MinLat)
+	{
+		MinLat = pCache->m_Lat;
+	}
+
+	if (pCache->m_Lat > MaxLat)
+	{
+		MaxLat = pCache->m_Lat;
+	}
+
+	if (pCache->m_Long < MinLong)
+	{
+		MinLong = pCache->m_Long;
+	}
+
+	if (pCache->m_Long > MaxLong)
+	{
+		MaxLong = pCache->m_Long;
+	}
+}
+
+// Sets the size of the cells and computes the key of the cell of each cache
+void CSpatialIndex::ComputeKeys(double CellSize, vector<DWORD>& Keys)
+{
+	if (CellSize < SPATIAL_MIN_CELL_SIZE)
+	{
+		CellSize = SPATIAL_MIN_CELL_SIZE;
+	}
+
+	m_CellHeight = CellSize;
+	m_Rows = (long) ((m_MaxLat - m_MinLat) / m_CellHeight) + 1;
+
+	if (m_Wrap)
+	{
+		// Whole number of columns around the globe
+		m_Cols = (long) ceil(360.0 / CellSize);
+		m_CellWidth = 360.0 / m_Cols;
+	}
+	else
+	{
+		m_Cols = (long) ((m_MaxLong - m_MinLong) / CellSize) + 1;
+		m_CellWidth = CellSize;
+	}
+
+	Keys.resize(m_Caches.size());
+
+	for (long Index = 0; Index < m_Caches.size(); Index++)
+	{
+		Keys[Index] = (DWORD) RowOf(m_Caches[Index]->m_Lat) * m_Cols + ColOf(m_Caches[Index]->m_Long);
+	}
+}
+
+long CSpatialIndex::RowOf(double Lat)
+{
+	long Row = (long) ((Lat - m_MinLat) / m_CellHeight);
+
+	if (Row < 0)
+	{
+		return 0;
+	}
+
+	return (Row < m_Rows) ? Row : m_Rows - 1;
+}
+
+long CSpatialIndex::ColOf(double Long)
+{
+	long Col = (long) ((Long - m_MinLong) / m_CellWidth);
+
+	if (Col < 0)
+	{
+		return 0;
+	}
+
+	return (Col < m_Cols) ? Col : m_Cols - 1;
+}
+
+// Retrieves the range [First, Last) of the non empty cells of a row between two columns
+void CSpatialIndex::CellRange(long Row, long FirstCol, long LastCol, long& First, long& Last)
+{
+	First = Last = 0;
+
+	if (Row < 0 || Row >= m_Rows)
+	{
+		return;
+	}
+
+	if (FirstCol < 0)
+	{
+		FirstCol = 0;
+	}
+
+	if (LastCol >= m_Cols)
+	{
+		LastCol = m_Cols - 1;
+	}
+
+	if (FirstCol > LastCol)
+	{
+		return;
+	}
+
+	DWORD	FirstKey = (DWORD) Row * m_Cols + FirstCol;
+	DWORD	LastKey = (DWORD) Row * m_Cols + LastCol;
+	long	Low = 0;
+	long	High = m_Cells.size();
+
+	// Binary search of the first cell whose key is at least FirstKey
+	while (Low < High)
+	{
+		long Middle = (Low + High) / 2;
+
+		if (m_Cells[Middle].Key < FirstKey)
+		{
+			Low = Middle + 1;
+		}
+		else
+		{
+			High = Middle;
+		}
+	}
+
+	First = Last = Low;
+
+	while (Last < m_Cells.size() && m_Cells[Last].Key <= LastKey)
+	{
+		Last++;
+	}
+}
+
+// Adds the caches located within the bounding box (degrees) to Result
+void CSpatialIndex::BoundingBox(double MinLat, double MinLong, double MaxLat, double MaxLong, GCCont& Result)
+{
+	if (IsEmpty() || MinLat > m_MaxLat || MaxLat < m_MinLat || MinLong > m_MaxLong || MaxLong < m_MinLong)
+	{
+		return;
+	}
+
+	long	LastRow = RowOf(MaxLat);
+	long	FirstCol = ColOf(MinLong);
+	long	LastCol = ColOf(MaxLong);
+	long	First, Last, Index;
+
+	for (long Row = RowOf(MinLat); Row <= LastRow; Row++)
+	{
+		CellRange(Row, FirstCol, LastCol, First, Last);
+
+		for (; First < Last; First++)
+		{
+			SpatialCell& Cell = m_Cells[First];
+
+			if (Cell.MinLat > MaxLat || Cell.MaxLat < MinLat || Cell.MinLong > MaxLong || Cell.MaxLong < MinLong)
+			{
+				// Nothing in common
+				continue;
+			}
+
+			if (Cell.MinLat >= MinLat && Cell.MaxLat <= MaxLat && Cell.MinLong >= MinLong && Cell.MaxLong <= MaxLong)
+			{
+				// Entirely within the box
+				Result.insert(Result.end(), m_Caches.begin() + Cell.First, m_Caches.begin() + Cell.First + Cell.Count);
+				continue;
+			}
+
+			for (Index = Cell.First; Index < Cell.First + Cell.Count; Index++)
+			{
+				CPreparedPoint& Point = m_Points[Index];
+
+				if (Point.m_Latitude >= MinLat && Point.m_Latitude <= MaxLat && Point.m_Longitude >= MinLong && Point.m_Longitude <= MaxLong)
+				{
+					Result.push_back(m_Caches[Index]);
+				}
+			}
+		}
+	}
+}
+
+// Retrieves the caches that may be located within 'Meters' of the point
+void CSpatialIndex::Radius(double Lat, double Long, double Meters, GCCont& Result)
+{
+	Result.clear();
+
+	double	DeltaLat = Meters * (1.0 + CLatLon::m_HaversineError) / (CLatLon::m_Radius * CLatLon::m_Deg2Rad);
+	double	MaxAbsLat = (fabs(Lat - DeltaLat) > fabs(Lat + DeltaLat)) ? fabs(Lat - DeltaLat) : fabs(Lat + DeltaLat);
+	double	DeltaLong = 180.0;
+
+	// Close to a pole, the circle may span every longitude
+	if (MaxAbsLat < 89.0)
+	{
+		DeltaLong = DeltaLat / cos(MaxAbsLat * CLatLon::m_Deg2Rad);
+	}
+
+	if (DeltaLong >= 180.0)
+	{
+		BoundingBox(Lat - DeltaLat, -180.0, Lat + DeltaLat, 180.0, Result);
+		return;
+	}
+
+	BoundingBox(Lat - DeltaLat, Long - DeltaLong, Lat + DeltaLat, Long + DeltaLong, Result);
+
+	// Wrap around the 180th meridian
+	if (Long - DeltaLong < -180.0)
+	{
+		BoundingBox(Lat - DeltaLat, Long - DeltaLong + 360.0, Lat + DeltaLat, 180.0, Result);
+	}
+	else if (Long + DeltaLong > 180.0)
+	{
+		BoundingBox(Lat - DeltaLat, -180.0, Lat + DeltaLat, Long + DeltaLong - 360.0, Result);
+	}
+}
+
+// Adds to Result the caches that may be located within 'Meters' of the great circle arc between two points
+void CSpatialIndex::Corridor(const CPreparedPoint& From, const CPreparedPoint& To, double Meters, GCCont& Result)
+{
+	double	MinLat, MaxLat;
+
+	// The arc may bulge toward a pole beyond its ends
+	From.ArcLatitudes(To, &MinLat, &MaxLat);
+
+	double	DeltaLat = Meters * (1.0 + CLatLon::m_HaversineError) / (CLatLon::m_Radius * CLatLon::m_Deg2Rad);
+
+	MinLat -= DeltaLat;
+	MaxLat += DeltaLat;
+
+	double	MaxAbsLat = (fabs(MinLat) > fabs(MaxLat)) ? fabs(MinLat) : fabs(MaxLat);
+	double	DeltaLong = 180.0;
+
+	// Close to a pole, or over it, the corridor may span every longitude
+	if (MaxAbsLat < 89.0)
+	{
+		DeltaLong = DeltaLat / cos(MaxAbsLat * CLatLon::m_Deg2Rad);
+	}
+
+	// The longitudes of an arc that doesn't go over a pole run from one end to the other, the short way around
+	double	MinLong = (From.m_Longitude < To.m_Longitude) ? From.m_Longitude : To.m_Longitude;
+	double	MaxLong = (From.m_Longitude > To.m_Longitude) ? From.m_Longitude : To.m_Longitude;
+
+	if (MaxLong - MinLong > 180.0)
+	{
+		double	West = MaxLong;
+
+		MaxLong = MinLong + 360.0;
+		MinLong = West;
+	}
+
+	MinLong -= DeltaLong;
+	MaxLong += DeltaLong;
+
+	if (DeltaLong >= 180.0 || MaxLong - MinLong >= 360.0)
+	{
+		BoundingBox(MinLat, -180.0, MaxLat, 180.0, Result);
+		return;
+	}
+
+	BoundingBox(MinLat, MinLong, MaxLat, MaxLong, Result);
+
+	// Wrap around the 180th meridian
+	if (MinLong < -180.0)
+	{
+		BoundingBox(MinLat, MinLong + 360.0, MaxLat, 180.0, Result);
+	}
+	else if (MaxLong > 180.0)
+	{
+		BoundingBox(MinLat, -180.0, MaxLat, MaxLong - 360.0, Result);
+	}
+}
+
+// Retrieves the K caches nearest to the point, closest first
+void CSpatialIndex::Nearest(double Lat, double Long, long K, GCCont& Result, vector<double>* pDistances)
+{
+	Result.clear();
+
+	if (pDistances)
+	{
+		pDistances->clear();
+	}
+
+	if (IsEmpty() || K <= 0)
+	{
+		return;
+	}
+
+	CPreparedPoint			Center(Lat, Long);
+	vector<double>			Distance(m_MaxCellCount);
+	vector<double>			Azimuth(m_MaxCellCount);
+	SpatialNeighbourCont	Best;	// Max heap on the distance
+	long					Row = RowOf(Lat);
+	long					Col = ColOf(Long);
+	long					R;
+	double					MaxAbsLat = fabs(Lat);
+
+	if (fabs(m_MinLat) > MaxAbsLat)
+	{
+		MaxAbsLat = fabs(m_MinLat);
+	}
+
+	if (fabs(m_MaxLat) > MaxAbsLat)
+	{
+		MaxAbsLat = fabs(m_MaxLat);
+	}
+
+	double	CosLat = cos(MaxAbsLat * CLatLon::m_Deg2Rad);
+	double	Span = ((Long > m_MaxLong) ? Long : m_MaxLong) - ((Long < m_MinLong) ? Long : m_MinLong);
+
+	// Visit the rings of cells around the cell of the point, closest first
+	for (long Ring = 0; ; Ring++)
+	{
+		// None of the caches left can be closer
+		if (Best.size() == K && Best.front().first <= RingDistance(Ring, CosLat, Span))
+		{
+			break;
+		}
+
+		// The previous ring covered the whole grid
+		if (Ring && CoversGrid(Row, Col, Ring - 1))
+		{
+			break;
+		}
+
+		for (R = Row - Ring; R <= Row + Ring; R++)
+		{
+			if (R < 0 || R >= m_Rows)
+			{
+				continue;
+			}
+
+			// The top and bottom rows of the ring are complete, the others only have their first and last cells
+			if (R == Row - Ring || R == Row + Ring)
+			{
+				ScanColumns(R, Col - Ring, Col + Ring, Center, K, Best, Distance, Azimuth);
+			}
+			else if (!m_Wrap || 2 * Ring < m_Cols)
+			{
+				ScanColumns(R, Col - Ring, Col - Ring, Center, K, Best, Distance, Azimuth);
+				ScanColumns(R, Col + Ring, Col + Ring, Center, K, Best, Distance, Azimuth);
+			}
+			else if (2 * Ring == m_Cols)
+			{
+				// Both sides are the same column, opposite to the point
+				ScanColumns(R, Col + Ring, Col + Ring, Center, K, Best, Distance, Azimuth);
+			}
+		}
+	}
+
+	sort_heap(Best.begin(), Best.end());
+
+	for (itSpatialNeighbour it = Best.begin(); it != Best.end(); it++)
+	{
+		Result.push_back(it->second);
+
+		if (pDistances)
+		{
+			pDistances->push_back(it->first);
+		}
+	}
+}
+
+// Retrieves the K caches nearest to a cache, closest first, along with their exact distance and azimuth from it
+void CSpatialIndex::NearbyCaches(CGeoCache* pCache, long K, GCCont& Result, vector<double>& Distances, vector<double>& Azimuths)
+{
+	Result.clear();
+	Distances.clear();
+	Azimuths.clear();
+
+	if (K <= 0)
+	{
+		return;
+	}
+
+	GCCont					Candidates;
+	GCCont					Caches;
+	vector<CPreparedPoint>	Points;
+	vector<double>			Estimates;
+	vector<double>			Distance;
+	vector<double>			Azimuth;
+	vector<SpatialRank>		Order;
+	long					Index;
+	long					Count;
+
+	// One more to account for the cache itself
+	long					Wanted = K + 1;
+
+	// The spherical estimates rank the candidates, the exact distances may not agree with them. Widen the search
+	// until the caches left out are farther than the K nearest candidates, even allowing for the error of the estimates.
+	for (;;)
+	{
+		Nearest(pCache->m_Lat, pCache->m_Long, Wanted, Candidates, &Estimates);
+
+		Caches.clear();
+		Points.clear();
+
+		for (Index = 0; Index < Candidates.size(); Index++)
+		{
+			if (Candidates[Index] != pCache)
+			{
+				Caches.push_back(Candidates[Index]);
+				Points.push_back(Candidates[Index]->m_Point);
+			}
+		}
+
+		Count = Caches.size();
+
+		if (!Count)
+		{
+			return;
+		}
+
+		Distance.resize(Count);
+		Azimuth.resize(Count);
+
+		pCache->m_Point.VincentyDistances(&Points[0], Count, &Distance[0], &Azimuth[0]);
+
+		Order.resize(Count);
+
+		for (Index = 0; Index < Count; Index++)
+		{
+			Order[Index] = SpatialRank(Distance[Index], Index);
+		}
+
+		sort(Order.begin(), Order.end());
+
+		// Every cache is a candidate
+		if (Candidates.size() < Wanted)
+		{
+			break;
+		}
+
+		if (Count >= K && Order[K - 1].first <= Estimates.back() / (1.0 + CLatLon::m_HaversineError))
+		{
+			break;
+		}
+
+		Wanted *= 2;
+	}
+
+	if (Count > K)
+	{
+		Count = K;
+	}
+
+	for (Index = 0; Index < Count; Index++)
+	{
+		Result.push_back(Caches[Order[Index].second]);
+		Distances.push_back(Order[Index].first);
+		Azimuths.push_back(Azimuth[Order[Index].second]);
+	}
+}
+
+// Nearest neighbour search: offers the caches of a row between two columns (wrapping around if needed)
+// to the heap of the K best candidates
+void CSpatialIndex::ScanColumns(long Row, long FirstCol, long LastCol, const CPreparedPoint& Center, long K, SpatialNeighbourCont& Best, vector<double>& Distance, vector<double>& Azimuth)
+{
+	long	First, Last, Index, Range;
+	long	Ranges[2][2];
+	long	RangeCount = 1;
+
+	Ranges[0][0] = FirstCol;
+	Ranges[0][1] = LastCol;
+
+	if (m_Wrap)
+	{
+		if (LastCol - FirstCol + 1 >= m_Cols)
+		{
+			Ranges[0][0] = 0;
+			Ranges[0][1] = m_Cols - 1;
+		}
+		else
+		{
+			FirstCol = ((FirstCol % m_Cols) + m_Cols) % m_Cols;
+			LastCol = ((LastCol % m_Cols) + m_Cols) % m_Cols;
+
+			Ranges[0][0] = FirstCol;
+			Ranges[0][1] = LastCol;
+
+			// Across the 180th meridian
+			if (LastCol < FirstCol)
+			{
+				Ranges[0][1] = m_Cols - 1;
+				Ranges[1][0] = 0;
+				Ranges[1][1] = LastCol;
+				RangeCount = 2;
+			}
+		}
+	}
+
+	for (Range = 0; Range < RangeCount; Range++)
+	{
+		CellRange(Row, Ranges[Range][0], Ranges[Range][1], First, Last);
+
+		for (; First < Last; First++)
+		{
+			SpatialCell& Cell = m_Cells[First];
+
+			Center.HaversineDistances(&m_Points[Cell.First], Cell.Count, &Distance[0], &Azimuth[0]);
+
+			for (Index = 0; Index < Cell.Count; Index++)
+			{
+				if (Best.size() < K)
+				{
+					Best.push_back(SpatialNeighbour(Distance[Index], m_Caches[Cell.First + Index]));
+					push_heap(Best.begin(), Best.end());
+				}
+				else if (Distance[Index] < Best.front().first)
+				{
+					pop_heap(Best.begin(), Best.end());
+					Best.back() = SpatialNeighbour(Distance[Index], m_Caches[Cell.First + Index]);
+					push_heap(Best.begin(), Best.end());
+				}
+			}
+		}
+	}
+}
+
+// Nearest neighbour search: lower bound of the distance in meters between the point and the caches of the
+// cells that are at least Ring cells away from its cell
+double CSpatialIndex::RingDistance(long Ring, double CosLat, double Span)
+{
+	if (Ring < 2)
+	{
+		return 0.0;
+	}
+
+	// The caches are at least Ring - 1 cells away along a meridian or along a parallel
+	double	LatBound = CLatLon::m_Radius * (Ring - 1) * m_CellHeight * CLatLon::m_Deg2Rad;
+	double	Degrees = (Ring - 1) * m_CellWidth;
+
+	// Unless the columns wrap around, going around the other way may be shorter
+	if (!m_Wrap && Degrees > 360.0 - Span)
+	{
+		Degrees = 360.0 - Span;
+	}
+
+	if (Degrees > 180.0)
+	{
+		Degrees = 180.0;
+	}
+
+	// From the haversine formula: hav(d) >= cos(lat1) * cos(lat2) * hav(delta long)
+	double	LongBound = 2.0 * CLatLon::m_Radius * asin(CosLat * sin(Degrees * CLatLon::m_Deg2Rad / 2.0));
+
+	return (LatBound < LongBound) ? LatBound : LongBound;
+}
+
+// Nearest neighbour search: returns 'true' if the cells within Ring cells of the cell of the point cover the grid
+bool CSpatialIndex::CoversGrid(long Row, long Col, long Ring)
+{
+	if (Row - Ring > 0 || Row + Ring < m_Rows - 1)
+	{
+		return false;
+	}
+
+	if (m_Wrap)
+	{
+		return (2 * Ring + 1 >= m_Cols);
+	}
+
+	return (Col - Ring <= 0 && Col + Ring >= m_Cols - 1);
+}
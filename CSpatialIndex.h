@@ -0,0 +1,121 @@
+#ifndef _INC_CSpatialIndex
+	#define _INC_CSpatialIndex
+
+#include "CommonDefs.h"
+#include "CGpxParser.h"
+#include <vector>
+
+using namespace std;
+
+class CPreparedPoint;
+
+// Non empty cell of the grid. The caches of a cell are stored contiguously, starting at First.
+typedef struct {
+	DWORD		Key;
+	long		First;
+	long		Count;
+	double		MinLat;
+	double		MinLong;
+	double		MaxLat;
+	double		MaxLong;
+} SpatialCell;
+
+typedef vector<SpatialCell>				SpatialCellCont;
+typedef vector<SpatialCell>::iterator	itSpatialCell;
+
+typedef pair<double, CGeoCache*>				SpatialNeighbour;
+typedef vector<SpatialNeighbour>				SpatialNeighbourCont;
+typedef vector<SpatialNeighbour>::iterator		itSpatialNeighbour;
+
+// Grid of cells laid over the bounding box of the loaded caches.
+// The caches are sorted by cell (row major) and only the non empty cells are kept, sorted by key, along with
+// the bounding box of their caches. A query walks the rows it overlaps and binary searches the first cell of
+// each row, so that it only touches the caches of the cells near the area of interest.
+// When the caches are spread over more than half of the longitudes, the columns cover the whole globe and
+// wrap around the 180th meridian.
+// The index holds pointers to the caches: it must be rebuilt whenever the parser loads another file.
+class CSpatialIndex
+{
+	// Number of caches per cell aimed for when sizing the cells, as seen from a cache
+	#define SPATIAL_CELL_OCCUPANCY	8
+	// Smallest cell size in degrees (about 500 meters)
+	#define SPATIAL_MIN_CELL_SIZE	0.005
+
+protected:
+	double			m_MinLat;
+	double			m_MinLong;
+	double			m_MaxLat;
+	double			m_MaxLong;
+	double			m_CellHeight;
+	double			m_CellWidth;
+	long			m_Rows;
+	long			m_Cols;
+	bool			m_Wrap;
+	long			m_MaxCellCount;
+
+	// Prepared cache coordinates and pointers, sorted by cell
+	vector<CPreparedPoint>	m_Points;
+	GCCont					m_Caches;
+
+	SpatialCellCont		m_Cells;
+
+public:
+	CSpatialIndex();
+
+	// Indexes the caches currently loaded by the parser
+	void	Build(CGpxParser& Parser);
+
+	// Empties the index
+	void	Reset();
+
+	// Returns 'true' if the index contains no cache
+	bool	IsEmpty();
+
+	// Adds the caches located within the bounding box (degrees) to Result
+	void	BoundingBox(double MinLat, double MinLong, double MaxLat, double MaxLong, GCCont& Result);
+
+	// Retrieves the caches that may be located within 'Meters' of the point. The result is a superset of the
+	// exact answer: it comes from the bounding box of the circle, enlarged by CLatLon::m_HaversineError.
+	void	Radius(double Lat, double Long, double Meters, GCCont& Result);
+
+	// Adds to Result the caches that may be located within 'Meters' of the great circle arc between two points.
+	// Like Radius(), the result is a superset of the exact answer. Only reads the index: threads may share it.
+	void	Corridor(const CPreparedPoint& From, const CPreparedPoint& To, double Meters, GCCont& Result);
+
+	// Retrieves the K caches nearest to the point, closest first. The distances are spherical estimates
+	// (see CPreparedPoint::HaversineDistances()) and are returned in Distances (meters) when it isn't null.
+	void	Nearest(double Lat, double Long, long K, GCCont& Result, vector<double>* pDistances = NULL);
+
+	// Retrieves the K caches nearest to a cache, closest first, along with their exact distance (meters) and
+	// forward azimuth (degrees) from it. The cache itself is left out of the result. Neither the cache nor its
+	// neighbours are modified, so the list of caches can be refreshed while this runs.
+	void	NearbyCaches(CGeoCache* pCache, long K, GCCont& Result, vector<double>& Distances, vector<double>& Azimuths);
+
+protected:
+	// Row and column of the cell containing the point, clamped to the grid
+	long	RowOf(double Lat);
+	long	ColOf(double Long);
+
+	// Retrieves the range [First, Last) of the non empty cells of a row between two columns
+	void	CellRange(long Row, long FirstCol, long LastCol, long& First, long& Last);
+
+	// Sets the size of the cells and computes the key of the cell of each cache
+	void	ComputeKeys(double CellSize, vector<DWORD>& Keys);
+
+	// Grows a bounding box to include a cache
+	static void	Extend(double& MinLat, double& MinLong, double& MaxLat, double& MaxLong, CGeoCache* pCache);
+
+	// Nearest neighbour search: offers the caches of a row between two columns (wrapping around if needed)
+	// to the heap of the K best candidates
+	void	ScanColumns(long Row, long FirstCol, long LastCol, const CPreparedPoint& Center, long K, SpatialNeighbourCont& Best, vector<double>& Distance, vector<double>& Azimuth);
+
+	// Nearest neighbour search: lower bound of the distance in meters between the point and the caches of the
+	// cells that are at least Ring cells away from its cell. CosLat is the cosine of the largest absolute
+	// latitude of the point and the grid, Span the range of longitudes they cover.
+	double	RingDistance(long Ring, double CosLat, double Span);
+
+	// Nearest neighbour search: returns 'true' if the cells within Ring cells of the cell of the point cover the grid
+	bool	CoversGrid(long Row, long Col, long Ring);
+};
+
+#endif
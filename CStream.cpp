@@ -1,14 +1,17 @@
 #include "CStream.h"
 #include "CBaseException.h"
+#include ".\Zlib\zlib.h"
 
 CStream::CStream()
 {
 	m_pBuffer = NULL;
 	m_pUnpack = NULL;
+	m_pUnpackEnd = NULL;
 	m_lBufferSizeInChars = 0;
 	m_lLastValLen = 0;
 	m_bIsStoring = false;
-	m_cSaved = 0;
+	m_bWriteFailed = false;
+	m_Checksum = ChecksumMd5;
 
 	#ifdef _UNICODE
 	m_lUnicode = 0xFFFE;
@@ -26,8 +29,13 @@ CStream::~CStream()
 void CStream::SetStoring(bool bIsStoring)
 {
 	m_bIsStoring = bIsStoring;
+}
 
-	m_Md5.Init();
+// Selects the checksum written in the header by Save(). MD5 is the default.
+// CRC32 is much cheaper on large blobs.
+void CStream::SetChecksum(ChecksumType Checksum)
+{
+	m_Checksum = Checksum;
 }
 
 // Returns 'true' when storing to the stream and false when extracting from it.
@@ -45,9 +53,6 @@ void CStream::Push(const String& szStr, int iDataLen)
 	m_szTemp = m_Header;
 	m_szTemp += szStr;
 
-	// Update the Md5 with each successive string that gets stored
-	m_Md5.Update((BYTE*) m_szTemp.c_str(), m_szTemp.size() * sizeof(TCHAR));
-
 	// Store the string into the list
 	m_List.push_back(m_szTemp);
 
@@ -55,79 +60,80 @@ void CStream::Push(const String& szStr, int iDataLen)
 	m_lBufferSizeInChars += m_szTemp.size();
 }
 
-// Used by the extraction operators to move to the next value to return
-TCHAR* CStream::GetNext()
+// Used by the extraction operators to move to the next value to return.
+// Returns the size of the value in characters and moves past it.
+long CStream::GetNext(const TCHAR** ppValue)
 {
 	static TCHAR szNothing[] = _T("");
 
-	if (!m_pUnpack)
+	*ppValue = szNothing;
+	m_lLastValLen = 0;
+
+	if (!m_pUnpack || (m_pUnpackEnd && (m_pUnpack >= m_pUnpackEnd)))
 	{
-		return szNothing;
+		return 0;
 	}
 
-	// Retrieve the size of the next value in characters
-	m_lLastValLen = _tcstol(m_pUnpack, NULL, 10);
+	// Retrieve the size of the next value in characters.
+	// The digits are parsed here because the data may be a read-only view that isn't null terminated.
+	const TCHAR* pScan = m_pUnpack;
+	long lLen = 0;
 
-	if (!m_lLastValLen && (m_pUnpack >= (m_pBuffer + m_lBufferSizeInChars)))
+	while ((!m_pUnpackEnd || (pScan < m_pUnpackEnd)) && (*pScan >= _T('0')) && (*pScan <= _T('9')))
 	{
-		m_cSaved = 0;
-		return szNothing;
+		lLen = (lLen * 10) + (*pScan - _T('0'));
+		pScan++;
 	}
 
-	// Move to the '='
-	while (*m_pUnpack != _T('=')) m_pUnpack++;
+	// Each value is preceded by its size and a '='. Anything else is the end of the data.
+	if ((m_pUnpackEnd && (pScan >= m_pUnpackEnd)) || (*pScan != _T('=')))
+	{
+		return 0;
+	}
 
 	// skip the '='
-	m_pUnpack++;
+	pScan++;
+
+	// Never run past the end of a truncated file
+	if (m_pUnpackEnd && (lLen > (m_pUnpackEnd - pScan)))
+	{
+		lLen = m_pUnpackEnd - pScan;
+	}
 
-	// Save the character after the last character of the current value
-	m_cSaved = m_pUnpack[m_lLastValLen];
+	*ppValue = pScan;
+	m_lLastValLen = lLen;
 
-	// Replace the character with a NULL
-	m_pUnpack[m_lLastValLen] = _T('\0');
+	// Move to the next value to be retrieved
+	m_pUnpack = pScan + lLen;
 
-	// return the pointer to the current value
-	return m_pUnpack;
+	return lLen;
 }
 
-// Used to synch pointers and restore data altered by GetNext()
-void CStream::Synch()
+// Copies the next value into m_DataBuffer as a null terminated string for the numeric conversions
+TCHAR* CStream::GetNextNumber()
 {
-	if (m_lLastValLen || m_cSaved)
-	{
-		// Restore the character that was replaced by a NULL in GetNext()
-		m_pUnpack[m_lLastValLen] = m_cSaved;
-		// Move to the next value to be retrieved
-		m_pUnpack += m_lLastValLen;
-	}
-}
+	const TCHAR*	pValue = NULL;
+	long			lLen = GetNext(&pValue);
+	long			lMaxLen = (sizeof(m_DataBuffer) / sizeof(TCHAR)) - 1;
 
-// Size is expressed in characters
-void CStream::GetNextPointer(TCHAR** ppString, DWORD& Size)
-{
-	if(!m_pUnpack)
+	if (lLen > lMaxLen)
 	{
-		*ppString = NULL;
-		Size = 0;
-		return;
+		lLen = lMaxLen;
 	}
 
-	m_lLastValLen = _tcstol(m_pUnpack, NULL, 10);
+	CopyMemory((void*) m_DataBuffer, (const void*) pValue, lLen * sizeof(TCHAR));
 
-	Size = m_lLastValLen;
+	m_DataBuffer[lLen] = _T('\0');
 
-	if (m_lLastValLen)
-	{
-		while (*m_pUnpack != _T('=')) m_pUnpack++;
-
-		// skip the '='
-		m_pUnpack++;
+	return m_DataBuffer;
+}
 
-		*ppString = m_pUnpack;
+// Size is expressed in characters
+void CStream::GetNextPointer(const TCHAR** ppString, DWORD& Size)
+{
+	Size = GetNext(ppString);
 
-		m_pUnpack += m_lLastValLen;
-	}
-	else
+	if (!Size)
 	{
 		*ppString = NULL;
 	}
@@ -139,9 +145,9 @@ long CStream::GetSize()
 	return m_lBufferSizeInChars;
 }
 
-// Saves the stream from memory to disk
+// Saves the stream from memory to disk. Returns false if the file could not be completely written.
 // Throws a CBaseException in case of error
-THROWx void CStream::Save(const String& szFilename)
+THROWx bool CStream::Save(const String& szFilename)
 {
 	FILE* hFile = _tfopen((TCHAR*) szFilename.c_str(), _T("w"));
 
@@ -155,7 +161,10 @@ THROWx void CStream::Save(const String& szFilename)
 		Up.Log();
 
 		//throw Up;
+		return false;
 	}
+
+	m_bWriteFailed = false;
 	
 	//try
 	{
@@ -177,7 +186,12 @@ THROWx void CStream::Save(const String& szFilename)
 		//throw e;
 	}
 	*/
-	fclose(hFile);
+	if (fclose(hFile))
+	{
+		m_bWriteFailed = true;
+	}
+
+	return !m_bWriteFailed;
 }
 
 // Writes the header preceding the data
@@ -187,8 +201,8 @@ THROWx void CStream::WriteHeader(FILE* hFile)
 	// Write the Unicode identifier
 	Write((void*) &m_lUnicode, sizeof(m_lUnicode), hFile);
 
-	// Write the MD5 string
-	String szMd5 = m_Md5.Final();
+	// Write the checksum string
+	String szMd5 = GetChecksum();
 	int iMd5Size = szMd5.size();
 	Write((void*) &iMd5Size, sizeof(iMd5Size), hFile);
 	Write((void*) szMd5.c_str(), iMd5Size * sizeof(TCHAR), hFile);
@@ -209,14 +223,95 @@ THROWx void CStream::Write(void* pData, long lSize, FILE* hFile)
 
 	if (lWritten != lSize)
 	{
+		m_bWriteFailed = true;
+
 		CBaseException Up;
 		Up.m_szSrc = _T("CStream::Write()");
 	}
 }
 
-// Loads a stream from disk back into memory
+// Loads a stream from disk. The file is mapped read-only when possible and the values are
+// extracted straight from the mapped pages, otherwise it is read into memory.
 // Throws a CBaseException in case of error
 THROWx void CStream::Load(const String& szFilename)
+{
+	// Clean everything up before loading the data from disk
+	Reset();
+
+	if (!LoadMapped(szFilename))
+	{
+		LoadBuffered(szFilename);
+	}
+
+	SetStoring(false);
+}
+
+// Maps the file and points the extraction operators at the mapped data. Returns false if the file can't be mapped.
+bool CStream::LoadMapped(const String& szFilename)
+{
+	if (!m_Map.Open(szFilename))
+	{
+		return false;
+	}
+
+	const BYTE*	pView = m_Map.GetData();
+	DWORD		ViewSize = m_Map.GetSize();
+	String		szMd5;
+
+	// Parse the header preceding the data. Returns the offset of the data section.
+	DWORD DataOffset = ParseHeader(pView, ViewSize, szMd5);
+
+	if (!DataOffset)
+	{
+		CBaseException Up;
+
+		Up.m_szSrc = _T("CStream::LoadMapped()");
+		Up.m_szMsg = _T("Invalid header! The file: ") + szFilename + _T(" is corrupt!");
+		Up.Log();
+
+		m_Map.Close();
+		m_lBufferSizeInChars = 0;
+		return true;
+	}
+
+	const BYTE*	pData = pView + DataOffset;
+	long		lDataSize = m_lBufferSizeInChars * sizeof(TCHAR);
+	DWORD		Crc = crc32(0L, Z_NULL, 0);
+	bool		bIsCrc32 = IsCrc32(szMd5);
+
+	// Calculate the checksum on the mapped data. Working in blocks keeps the page faults and the hashing interleaved.
+	m_Md5.Init();
+
+	for (long lOffset = 0; lOffset < lDataSize; lOffset += CStreamReadChunk)
+	{
+		long lChunk = lDataSize - lOffset;
+
+		if (lChunk > CStreamReadChunk)
+		{
+			lChunk = CStreamReadChunk;
+		}
+
+		if (bIsCrc32)
+		{
+			Crc = crc32(Crc, (const Bytef*) (pData + lOffset), lChunk);
+		}
+		else
+		{
+			m_Md5.Update((BYTE*) (pData + lOffset), lChunk);
+		}
+	}
+
+	VerifyChecksum(szMd5, bIsCrc32 ? Crc32AsString(Crc) : m_Md5.Final(), szFilename);
+
+	// Set the data extraction pointers on the mapped data. Nothing is copied.
+	m_pUnpack = (const TCHAR*) pData;
+	m_pUnpackEnd = m_pUnpack + m_lBufferSizeInChars;
+
+	return true;
+}
+
+// Loads the file in memory when it can't be mapped
+THROWx void CStream::LoadBuffered(const String& szFilename)
 {
 	FILE* hFile = _tfopen((TCHAR*) szFilename.c_str(), _T("r"));
 
@@ -227,20 +322,20 @@ THROWx void CStream::Load(const String& szFilename)
 		Up.m_szSrc = _T("CStream::Load()");
 		Up.m_szMsg = _T("Failed to open file: ") + szFilename;
 		Up.Win32Error();
+		Up.Log();
 
 		//throw Up;
+		return;
 	}
 	
 	//try
 	{
-		// Clean everything up before loading the data from disk
-		Reset();
-
-		// Read the header preceding the data. Returns the size of the buffer required to read the data in one chunk.
+		// Read the header preceding the data. Returns the checksum of the data section.
 		String szMd5 = ReadHeader(hFile);
 
+		bool bIsCrc32 = IsCrc32(szMd5);
+
 		// Allocate a buffer large enough to hold the data section in the file.
-		// The buffer needs to be a bit larger due to the extraction process
 		if (m_lBufferSizeInChars)
 		{
 			// allocate a target character buffer large enough to receive all the packed data
@@ -257,30 +352,45 @@ THROWx void CStream::Load(const String& szFilename)
 				fclose(hFile);
 
 				//throw Up;
+				return;
 			}
 
-			// Read the whole chunk of data into the buffer.
-			Read((void*) m_pBuffer, m_lBufferSizeInChars * sizeof(TCHAR), hFile);
+			// Read the data one block at a time and fold each block into the checksum
+			// while it is still in the cache instead of hashing the whole buffer again afterwards.
+			BYTE*	pDest = (BYTE*) m_pBuffer;
+			long	lRemaining = m_lBufferSizeInChars * sizeof(TCHAR);
+			DWORD	Crc = crc32(0L, Z_NULL, 0);
 
-			// Terminate the buffer with a null
-			m_pBuffer[m_lBufferSizeInChars] = _T('\0');
+			m_Md5.Init();
 
-			// Calculate the MD5 on the data and compare with the header
-			if (m_Md5.Hash((BYTE*) m_pBuffer, m_lBufferSizeInChars * sizeof(TCHAR)) != szMd5)
+			while (lRemaining > 0)
 			{
-				CBaseException Up;
+				long lChunk = (lRemaining > CStreamReadChunk) ? CStreamReadChunk : lRemaining;
 
-				Up.m_szSrc = _T("CStream::Load()");
-				Up.m_szMsg = _T("Md5 mismatch! The file: ") + szFilename + _T(" is corrupt!");
-				Up.Log();
+				Read((void*) pDest, lChunk, hFile);
 
-				fclose(hFile);
+				if (bIsCrc32)
+				{
+					Crc = crc32(Crc, (const Bytef*) pDest, lChunk);
+				}
+				else
+				{
+					m_Md5.Update(pDest, lChunk);
+				}
 
-				//throw Up;
+				pDest += lChunk;
+				lRemaining -= lChunk;
 			}
 
+			// Terminate the buffer with a null
+			m_pBuffer[m_lBufferSizeInChars] = _T('\0');
+
+			// Compare the checksum of the data with the header
+			VerifyChecksum(szMd5, bIsCrc32 ? Crc32AsString(Crc) : m_Md5.Final(), szFilename);
+
 			// Set the data extraction buffer on the data
 			m_pUnpack = m_pBuffer;
+			m_pUnpackEnd = m_pBuffer + m_lBufferSizeInChars;
 		}
 	}
 	/*
@@ -297,6 +407,31 @@ THROWx void CStream::Load(const String& szFilename)
 	fclose(hFile);
 }
 
+// Checks the checksum of the data against the one saved in the header and logs a mismatch
+bool CStream::VerifyChecksum(const String& szMd5, const String& szChecksum, const String& szFilename)
+{
+	if (szChecksum != szMd5)
+	{
+		CBaseException Up;
+
+		Up.m_szSrc = _T("CStream::Load()");
+		Up.m_szMsg = _T("Checksum mismatch! The file: ") + szFilename + _T(" is corrupt!");
+		Up.Log();
+
+		//throw Up;
+		return false;
+	}
+
+	return true;
+}
+
+// Returns true when the checksum saved in the header is a CRC32
+bool CStream::IsCrc32(const String& szMd5)
+{
+	// Files saved with a CRC32 flag it in front of the checksum, anything else is an MD5
+	return (_tcsncmp(szMd5.c_str(), CStreamCrc32Tag, _tcslen(CStreamCrc32Tag)) == 0);
+}
+
 // Reads the header preceding the data. Returns the MD5 saved in the header
 // Throws a CBaseException in case of error
 THROWx String CStream::ReadHeader(FILE* hFile)
@@ -379,8 +514,101 @@ THROWx void CStream::Read(void* pData, long lSize, FILE* hFile)
 	}
 }
 
+// Same as ReadHeader() from a mapped view. Returns the offset of the data in bytes or 0 if the header is invalid.
+DWORD CStream::ParseHeader(const BYTE* pView, DWORD ViewSize, String& szMd5)
+{
+	DWORD	Offset = 0;
+	int		iMd5Size = 0;
+	int		iDescriptorSize = 0;
+
+	// The integers in the header aren't necessarily aligned, copy them out of the view
+	if (ViewSize < sizeof(m_lUnicode) + sizeof(iMd5Size))
+	{
+		return 0;
+	}
+
+	// Read the Unicode identifier
+	CopyMemory((void*) &m_lUnicode, pView + Offset, sizeof(m_lUnicode));
+	Offset += sizeof(m_lUnicode);
+
+	// Read the MD5 string
+	CopyMemory((void*) &iMd5Size, pView + Offset, sizeof(iMd5Size));
+	Offset += sizeof(iMd5Size);
+
+	if ((iMd5Size < 0) || ((ViewSize - Offset) < (iMd5Size * sizeof(TCHAR) + sizeof(iDescriptorSize))))
+	{
+		return 0;
+	}
+
+	szMd5.assign((const TCHAR*) (pView + Offset), iMd5Size);
+	Offset += iMd5Size * sizeof(TCHAR);
+
+	// Read the metadata info
+	CopyMemory((void*) &iDescriptorSize, pView + Offset, sizeof(iDescriptorSize));
+	Offset += sizeof(iDescriptorSize);
+
+	if ((iDescriptorSize < 0) || ((ViewSize - Offset) < (iDescriptorSize * sizeof(TCHAR) + sizeof(m_lBufferSizeInChars))))
+	{
+		return 0;
+	}
+
+	m_szDescriptor.assign((const TCHAR*) (pView + Offset), iDescriptorSize);
+	Offset += iDescriptorSize * sizeof(TCHAR);
+
+	// Read the size of the data itself (in characters)
+	CopyMemory((void*) &m_lBufferSizeInChars, pView + Offset, sizeof(m_lBufferSizeInChars));
+	Offset += sizeof(m_lBufferSizeInChars);
+
+	// Never trust the size of the data beyond what's actually in the file
+	if ((m_lBufferSizeInChars < 0) || ((DWORD) m_lBufferSizeInChars > ((ViewSize - Offset) / sizeof(TCHAR))))
+	{
+		m_lBufferSizeInChars = (ViewSize - Offset) / sizeof(TCHAR);
+	}
+
+	return Offset;
+}
+
+// Returns the checksum of the inserted data as it is stored in the header.
+// It's computed when the stream is saved, not as the values are inserted, so a stream handed
+// over to another thread is checksummed there.
+String CStream::GetChecksum()
+{
+	itStr it;
+
+	if (m_Checksum == ChecksumCrc32)
+	{
+		DWORD Crc = crc32(0L, Z_NULL, 0);
+
+		for (it = m_List.begin(); it != m_List.end(); it++)
+		{
+			Crc = crc32(Crc, (const Bytef*) (*it).c_str(), (*it).size() * sizeof(TCHAR));
+		}
+
+		return Crc32AsString(Crc);
+	}
+
+	m_Md5.Init();
+
+	for (it = m_List.begin(); it != m_List.end(); it++)
+	{
+		m_Md5.Update((BYTE*) (*it).c_str(), (*it).size() * sizeof(TCHAR));
+	}
+
+	return m_Md5.Final();
+}
+
+// Formats a CRC32 the way it is stored in the header
+String CStream::Crc32AsString(DWORD Crc)
+{
+	TCHAR Buffer[20];
+
+	_stprintf(Buffer, _T("%s%08lx"), CStreamCrc32Tag, Crc);
+
+	return Buffer;
+}
+
 // Returns the current position of the pointer 
-TCHAR *CStream::GetUnpackPointer()
+const TCHAR *CStream::GetUnpackPointer()
 {
 	return m_pUnpack;
 }
@@ -435,12 +663,14 @@ THROWx void CStream::Pack(DWORD& dwSizeInBytes, TCHAR** Ptr, bool bAddNullTermin
 	*(Ptr) = m_pBuffer;
 }
 
-// Assign a buffer to the stream before using the extraction operators
-void CStream::Unpack(TCHAR* pBuffer)
+// Assign a buffer to the stream before using the extraction operators.
+// The buffer is never written to. Without a size, it must be null terminated.
+void CStream::Unpack(const TCHAR* pBuffer, long lSizeInChars)
 {
 	Reset();
 
 	m_pUnpack = pBuffer;
+	m_pUnpackEnd = lSizeInChars ? (pBuffer + lSizeInChars) : NULL;
 
 	SetStoring(false);
 }
@@ -450,6 +680,12 @@ void CStream::Reset()
 {
 	DestroyBuffer();
 
+	m_Map.Close();
+
+	m_pUnpack = NULL;
+	m_pUnpackEnd = NULL;
+	m_lBufferSizeInChars = 0;
+
 	m_List.clear();
 }
 
@@ -636,38 +872,35 @@ void CStream::operator<<(SYSTEMTIME& ST)
 
 void CStream::operator>>(String& szStr)
 {
-	szStr = GetNext();
-	Synch();
+	const TCHAR*	pValue = NULL;
+	long			lLen = GetNext(&pValue);
+
+	szStr.assign(pValue, lLen);
 }
 
 void CStream::operator>>(DWORD& Dword)
 {
-	Dword = _tcstoul(GetNext(),NULL,10);
-	Synch();
+	Dword = _tcstoul(GetNextNumber(),NULL,10);
 }
 
 void CStream::operator>>(float& Float)
 {
-	Float = _tcstod(GetNext(),NULL);
-	Synch();
+	Float = _tcstod(GetNextNumber(),NULL);
 }
 
 void CStream::operator>>(double& Double)
 {
-	Double = _tcstod(GetNext(),NULL);
-	Synch();
+	Double = _tcstod(GetNextNumber(),NULL);
 }
 
 void CStream::operator>>(LONGLONG& LongLong)
 {
-	LongLong = _ttol(GetNext());
-	Synch();
+	LongLong = _ttol(GetNextNumber());
 }
 
 void CStream::operator>>(long& Long)
 {
-	Long = _tcstol(GetNext(),NULL,10);
-	Synch();
+	Long = _tcstol(GetNextNumber(),NULL,10);
 }
 
 void CStream::operator>>(WORD& Word)
@@ -677,35 +910,30 @@ void CStream::operator>>(WORD& Word)
 
 void CStream::GetWord(WORD& Word)
 {
-	long LTemp = _tcstol(GetNext(),NULL,10);
+	long LTemp = _tcstol(GetNextNumber(),NULL,10);
 	Word = (WORD) LTemp;
-	Synch();
 }
 
 void CStream::operator>>(int& Int)
 {
-	Int = _ttoi(GetNext());
-	Synch();
+	Int = _ttoi(GetNextNumber());
 }
 
 void CStream::operator>>(short& Short)
 {
-	long LTemp = _tcstol(GetNext(),NULL,10);
+	long LTemp = _tcstol(GetNextNumber(),NULL,10);
 	Short = LTemp;
-	Synch();
 }
 
 void CStream::operator>>(UINT& UInt)
 {
-	long LTemp = _tcstol(GetNext(),NULL,10);
+	long LTemp = _tcstol(GetNextNumber(),NULL,10);
 	UInt = LTemp;
-	Synch();
 }
 
 void CStream::operator>>(bool& Boolean)
 {
-	long LTemp = _tcstol(GetNext(),NULL,10);
-	Synch();
+	long LTemp = _tcstol(GetNextNumber(),NULL,10);
 
 	if (LTemp)
 	{
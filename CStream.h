@@ -3,28 +3,47 @@
 
 #include "CommonDefs.h"
 #include "CMd5.h"
+#include "CMappedFile.h"
 
 class CStream
 {
 	#define CStreamVersion		100
 
+	// Size of the blocks read from disk and folded into the checksum by Load()
+	#define CStreamReadChunk	32768
+
+	// Prefix identifying a CRC32 checksum in the header instead of an MD5
+	#define CStreamCrc32Tag		_T("CRC32:")
+
+public:
+	// Checksums that can protect the data section of a stream
+	enum ChecksumType
+	{
+		ChecksumMd5,
+		ChecksumCrc32
+	};
+
 protected:
 
 	StringList	m_List;
 
 	CMd5		m_Md5;
+	ChecksumType	m_Checksum;
+
+	CMappedFile	m_Map;
 
 	String		m_szDescriptor;
 	String		m_szTemp;
-	TCHAR		m_cSaved;
 	TCHAR		m_DataBuffer[80];
 	TCHAR		m_Header[25];
 	TCHAR*		m_pBuffer;
-	TCHAR*		m_pUnpack;
+	const TCHAR*	m_pUnpack;
+	const TCHAR*	m_pUnpackEnd;
 	long		m_lBufferSizeInChars;
 	long		m_lLastValLen;
 	long		m_lUnicode;
 	bool		m_bIsStoring;
+	bool		m_bWriteFailed;
 
 public:
 	CStream();
@@ -40,6 +59,10 @@ public:
 	// Returns 'true' when storing to the stream and false when extracting from it.
 	bool			IsStoring();
 
+	// Selects the checksum written in the header by Save(). MD5 is the default.
+	// CRC32 is much cheaper on large blobs.
+	void			SetChecksum(ChecksumType Checksum);
+
 	// Stream insertion operators
 	void operator<<(TCHAR* pszStr);
 	void operator<<(const String& str);
@@ -73,25 +96,27 @@ public:
 	// Throws a CBaseException in case of memory allocation failure.
 	THROWx	void	Pack(DWORD& dwSizeInBytes, TCHAR** Ptr, bool bAddNullTerminator = false);
 
-	// Assign a buffer to the stream before using the extraction operators
-	void			Unpack(TCHAR* pBuffer);
+	// Assign a buffer to the stream before using the extraction operators.
+	// The buffer is never written to. Without a size, it must be null terminated.
+	void			Unpack(const TCHAR* pBuffer, long lSizeInChars = 0);
 
 	// returns the size of the buffer in characters
 	long			GetSize();
 	
-	// Saves the stream from memory to disk
+	// Saves the stream from memory to disk. Returns false if the file could not be completely written.
 	// Throws a CBaseException in case of error
-	THROWx	void	Save(const String& szFilename);
+	THROWx	bool	Save(const String& szFilename);
 
-	// Loads a stream from disk back into memory
+	// Loads a stream from disk. The file is mapped read-only when possible and the values are
+	// extracted straight from the mapped pages, otherwise it is read into memory.
 	// Throws a CBaseException in case of error
 	THROWx	void	Load(const String& szFilename);
 
-	// Retrieves the pointer to the next value and its size
-	void			GetNextPointer(TCHAR** ppString, DWORD& Size);
+	// Retrieves the pointer to the next value and its size. The value is not null terminated.
+	void			GetNextPointer(const TCHAR** ppString, DWORD& Size);
 
 	// Returns the current position of the pointer 
-	TCHAR*			GetUnpackPointer();
+	const TCHAR*	GetUnpackPointer();
 
 	// Resets the stream object
 	void			Reset();
@@ -100,11 +125,12 @@ protected:
 	// Add a string to the list
 	virtual	void	Push(const String& szBuffer, int iDataLen);
 
-	// Used by the extraction operators to move to the next value to return
-	virtual	TCHAR*	GetNext();
+	// Used by the extraction operators to move to the next value to return.
+	// Returns the size of the value in characters and moves past it.
+	virtual	long	GetNext(const TCHAR** ppValue);
 
-	// Used to synch pointers and restore data altered by GetNext()
-	virtual	void	Synch();
+	// Copies the next value into m_DataBuffer as a null terminated string for the numeric conversions
+	TCHAR*			GetNextNumber();
 
 	// Helpers dealing with WORD data types
 	void			PutWord(WORD Word);
@@ -127,8 +153,29 @@ protected:
 	// Throws a CBaseException in case of error
 	THROWx String	ReadHeader(FILE* hFile);
 
+	// Same as ReadHeader() from a mapped view. Returns the offset of the data in bytes or 0 if the header is invalid.
+	DWORD			ParseHeader(const BYTE* pView, DWORD ViewSize, String& szMd5);
+
+	// Maps the file and points the extraction operators at the mapped data. Returns false if the file can't be mapped.
+	bool			LoadMapped(const String& szFilename);
+
+	// Loads the file in memory when it can't be mapped
+	THROWx void		LoadBuffered(const String& szFilename);
+
+	// Checks the checksum of the data against the one saved in the header and logs a mismatch
+	bool			VerifyChecksum(const String& szMd5, const String& szChecksum, const String& szFilename);
+
+	// Returns true when the checksum saved in the header is a CRC32
+	bool			IsCrc32(const String& szMd5);
+
 	// Reads a chunk of data from disk and throws an exception in case of a problem
 	THROWx void		Read(void* pData, long lSize, FILE* hFile);
+
+	// Returns the checksum of the inserted data as it is stored in the header
+	String			GetChecksum();
+
+	// Formats a CRC32 the way it is stored in the header
+	String			Crc32AsString(DWORD Crc);
 };
 
 #endif
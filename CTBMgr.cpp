@@ -1,4 +1,5 @@
 #include "CTBMgr.h"
+#include "CSchema.h"
 
 CTB::CTB()
 {
@@ -19,36 +20,15 @@ void CTB::AssignToCache(const String& CacheShortName)
 
 void CTB::Serialize(CStream& ar)
 {
-	#define CTBVersion 100
+	CSchema Schema;
 
-	if (ar.IsStoring())
-	{
-		ar << CTBVersion;
-		ar << m_CacheShortName;
-		ar << m_Serial;
-
-		// Base class members
-		ar << m_Id;
-		ar << m_Ref;
-		ar << m_Name;
-	}
-	else
-	{
-		int Version;
+	Schema.Add(m_CacheShortName, 100);
+	Schema.Add(m_Serial, 100);
+	Schema.Add(m_Id, 100);
+	Schema.Add(m_Ref, 100);
+	Schema.Add(m_Name, 100);
 
-		ar >> Version;
-
-		if (Version >= 100)
-		{
-			ar >> m_CacheShortName;
-			ar >> m_Serial;
-
-			// Base class members
-			ar >> m_Id;
-			ar >> m_Ref;
-			ar >> m_Name;
-		}
-	}
+	Schema.Serialize(ar);
 }
 
 //----------------------------------------------------------------------------------------------------
@@ -0,0 +1,486 @@
+#include "CTextIndex.h"
+#include <algorithm>
+
+typedef pair<DWORD, long>	TextGram;
+typedef pair<long, long>	TextList;
+
+CTextIndex::CTextIndex()
+{
+	m_Revision = 0;
+
+	Reset();
+}
+
+void CTextIndex::Reset()
+{
+	m_Caches.clear();
+	m_Text.clear();
+	m_Starts.clear();
+	m_Keys.clear();
+	m_First.clear();
+	m_Postings.clear();
+
+	m_Revision++;
+}
+
+bool CTextIndex::IsEmpty()
+{
+	return m_Caches.empty();
+}
+
+long CTextIndex::GetCacheCount()
+{
+	return m_Caches.size();
+}
+
+// Returns a cache by its position in the index
+CGeoCache* CTextIndex::GetCache(long Position)
+{
+	return m_Caches[Position];
+}
+
+// Returns a number that changes each time the index is built or emptied
+long CTextIndex::GetRevision()
+{
+	return m_Revision;
+}
+
+// Lowercases a character the way the index and the search filter do
+TCHAR CTextIndex::Lower(TCHAR Char)
+{
+#ifdef PPC2K2
+	return tolower(Char);
+#else
+	return _tolower(Char);
+#endif
+}
+
+// Returns the key of the trigram starting at pGram
+DWORD CTextIndex::GramKey(const TCHAR* pGram)
+{
+	return ((DWORD) pGram[0] << 20) ^ ((DWORD) pGram[1] << 10) ^ (DWORD) pGram[2];
+}
+
+// Appends a field, lowercased and terminated, to the text of the caches
+void CTextIndex::AddField(const String& Field)
+{
+	long Size = Field.size();
+
+	for (long Index = 0; Index < Size; Index++)
+	{
+		m_Text.push_back(Lower(Field[Index]));
+	}
+
+	m_Text.push_back(0);
+}
+
+// Indexes the caches currently loaded by the parser
+void CTextIndex::Build(CGpxParser& Parser)
+{
+	Reset();
+
+	vector<TextGram>	Grams;
+	vector<DWORD>		CacheKeys;
+	itGC				it;
+	long				Index;
+
+	CGeoCache* pCache = Parser.First(it);
+
+	while (!Parser.EndOfCacheList(it))
+	{
+		long Position = m_Caches.size();
+		long Start = m_Text.size();
+
+		m_Caches.push_back(pCache);
+		m_Starts.push_back(Start);
+
+		AddField(pCache->m_Shortname);
+		AddField(pCache->m_GsCacheName);
+		AddField(pCache->m_GsCacheOwnerName);
+
+		long End = m_Text.size();
+
+		// The terminators keep the trigrams within a field. A cache holding a trigram several times is posted once.
+		CacheKeys.clear();
+
+		for (Index = Start; Index + TEXT_INDEX_GRAM <= End; Index++)
+		{
+			if (m_Text[Index] && m_Text[Index + 1] && m_Text[Index + 2])
+			{
+				CacheKeys.push_back(GramKey(&m_Text[Index]));
+			}
+		}
+
+		sort(CacheKeys.begin(), CacheKeys.end());
+		CacheKeys.erase(unique(CacheKeys.begin(), CacheKeys.end()), CacheKeys.end());
+
+		for (vector<DWORD>::iterator itKey = CacheKeys.begin(); itKey != CacheKeys.end(); itKey++)
+		{
+			Grams.push_back(TextGram(*itKey, Position));
+		}
+
+		pCache = Parser.Next(it);
+	}
+
+	m_Starts.push_back(m_Text.size());
+
+	// Group the postings by trigram, the caches of a trigram in ascending order
+	sort(Grams.begin(), Grams.end());
+
+	m_Postings.reserve(Grams.size());
+
+	for (vector<TextGram>::iterator itGram = Grams.begin(); itGram != Grams.end(); itGram++)
+	{
+		if (m_Keys.empty() || m_Keys.back() != itGram->first)
+		{
+			m_Keys.push_back(itGram->first);
+			m_First.push_back(m_Postings.size());
+		}
+
+		m_Postings.push_back(itGram->second);
+	}
+
+	m_First.push_back(m_Postings.size());
+
+	m_Revision++;
+}
+
+// Retrieves the posting list of a trigram key. Returns 'false' if no cache holds the trigram.
+bool CTextIndex::Postings(DWORD Key, long& First, long& Last)
+{
+	vector<DWORD>::iterator it = lower_bound(m_Keys.begin(), m_Keys.end(), Key);
+
+	if (it == m_Keys.end() || *it != Key)
+	{
+		return false;
+	}
+
+	long Index = it - m_Keys.begin();
+
+	First = m_First[Index];
+	Last = m_First[Index + 1];
+
+	return true;
+}
+
+// Returns 'true' if a field of the cache at Position contains the text
+bool CTextIndex::Contains(long Position, const TCHAR* pText)
+{
+	const TCHAR* pField = &m_Text[m_Starts[Position]];
+	const TCHAR* pEnd = &m_Text[0] + m_Starts[Position + 1];
+
+	while (pField < pEnd)
+	{
+		if (_tcsstr(pField, pText))
+		{
+			return true;
+		}
+
+		pField += _tcslen(pField) + 1;
+	}
+
+	return false;
+}
+
+// Adds to Result the caches whose waypoint, name or owner contains the text
+void CTextIndex::Search(const TCHAR* pText, GCCont& Result)
+{
+	long Count = m_Caches.size();
+	long Length = _tcslen(pText);
+	long Index;
+
+	if (!Count)
+	{
+		return;
+	}
+
+	// Too short to have a trigram: every cache is a candidate
+	if (Length < TEXT_INDEX_GRAM)
+	{
+		for (Index = 0; Index < Count; Index++)
+		{
+			if (Contains(Index, pText))
+			{
+				Result.push_back(m_Caches[Index]);
+			}
+		}
+
+		return;
+	}
+
+	// Posting lists of the trigrams of the text, as sizes and starts. A trigram no cache holds leaves no candidate.
+	vector<TextList>	Lists;
+	long				First, Last;
+
+	for (Index = 0; Index + TEXT_INDEX_GRAM <= Length; Index++)
+	{
+		if (!Postings(GramKey(pText + Index), First, Last))
+		{
+			return;
+		}
+
+		Lists.push_back(TextList(Last - First, First));
+	}
+
+	// Intersect the lists starting with the shortest one, so that the candidates only shrink from there
+	sort(Lists.begin(), Lists.end());
+
+	const long*		pPostings = &m_Postings[0];
+	vector<long>	Candidates(pPostings + Lists[0].second, pPostings + Lists[0].second + Lists[0].first);
+	long			List;
+
+	for (List = 1; List < Lists.size() && !Candidates.empty(); List++)
+	{
+		const long*	pFirst = pPostings + Lists[List].second;
+		const long*	pLast = pFirst + Lists[List].first;
+		long		Kept = 0;
+
+		// Both lists are sorted: each candidate is looked up from where the previous one was found
+		for (Index = 0; Index < Candidates.size() && pFirst != pLast; Index++)
+		{
+			pFirst = lower_bound(pFirst, pLast, Candidates[Index]);
+
+			if (pFirst != pLast && *pFirst == Candidates[Index])
+			{
+				Candidates[Kept++] = Candidates[Index];
+			}
+		}
+
+		Candidates.resize(Kept);
+	}
+
+	// Holding every trigram doesn't mean holding them in sequence, nor within the same field
+	for (Index = 0; Index < Candidates.size(); Index++)
+	{
+		if (Contains(Candidates[Index], pText))
+		{
+			Result.push_back(m_Caches[Candidates[Index]]);
+		}
+	}
+}
+
+// Returns the edits a fuzzy search tolerates for a text of this length
+long CTextIndex::FuzzyEdits(long Length)
+{
+	if (Length < TEXT_FUZZY_ONE)
+	{
+		return 0;
+	}
+
+	return (Length < TEXT_FUZZY_TWO) ? 1 : 2;
+}
+
+// Prepares the masks of a pattern
+void CTextIndex::Prepare(const TCHAR* pText, FuzzyPattern& Pattern)
+{
+	long Length = _tcslen(pText);
+
+	if (Length > TEXT_FUZZY_MAX)
+	{
+		Length = TEXT_FUZZY_MAX;
+	}
+
+	Pattern.Length = Length;
+	Pattern.OtherCount = 0;
+
+	ZeroMemory(Pattern.Masks, sizeof(Pattern.Masks));
+
+	for (long Index = 0; Index < Length; Index++)
+	{
+		TCHAR	Char = pText[Index];
+		DWORD	Bit = (DWORD) 1 << Index;
+
+		if (Char < 256)
+		{
+			Pattern.Masks[Char] |= Bit;
+			continue;
+		}
+
+		long Other;
+
+		for (Other = 0; Other < Pattern.OtherCount && Pattern.OtherChars[Other] != Char; Other++);
+
+		if (Other == Pattern.OtherCount)
+		{
+			Pattern.OtherChars[Other] = Char;
+			Pattern.OtherMasks[Other] = 0;
+			Pattern.OtherCount++;
+		}
+
+		Pattern.OtherMasks[Other] |= Bit;
+	}
+}
+
+// Returns the fewest edits making the pattern part of the text (Myers, searching variant).
+// Pv and Mv hold the vertical deltas (+1 and -1) of the current column of the edit distance matrix, one bit per
+// character of the pattern. The match may start anywhere in the text, so the first row of the matrix stays at 0
+// and no carry enters the horizontal deltas. Score follows the last row: the edits for the whole pattern.
+long CTextIndex::Distance(const FuzzyPattern& Pattern, const TCHAR* pText)
+{
+	DWORD	Pv = ~(DWORD) 0;
+	DWORD	Mv = 0;
+	DWORD	Last = (DWORD) 1 << (Pattern.Length - 1);
+	long	Score = Pattern.Length;
+	long	Best = Score;
+
+	for (; *pText; pText++)
+	{
+		TCHAR	Char = *pText;
+		DWORD	Eq = 0;
+
+		if (Char < 256)
+		{
+			Eq = Pattern.Masks[Char];
+		}
+		else
+		{
+			for (long Other = 0; Other < Pattern.OtherCount; Other++)
+			{
+				if (Pattern.OtherChars[Other] == Char)
+				{
+					Eq = Pattern.OtherMasks[Other];
+					break;
+				}
+			}
+		}
+
+		DWORD Xv = Eq | Mv;
+		DWORD Xh = (((Eq & Pv) + Pv) ^ Pv) | Eq;
+		DWORD Ph = Mv | ~(Xh | Pv);
+		DWORD Mh = Pv & Xh;
+
+		if (Ph & Last)
+		{
+			Score++;
+		}
+		else if (Mh & Last)
+		{
+			Score--;
+		}
+
+		Ph <<= 1;
+		Mh <<= 1;
+
+		Pv = Mh | ~(Xv | Ph);
+		Mv = Ph & Xv;
+
+		if (Score < Best)
+		{
+			Best = Score;
+
+			if (!Best)
+			{
+				break;
+			}
+		}
+	}
+
+	return Best;
+}
+
+// Returns the fewest edits making the pattern part of a field of the cache at Position, or MaxEdits + 1
+long CTextIndex::Edits(long Position, const FuzzyPattern& Pattern, long MaxEdits)
+{
+	const TCHAR*	pField = &m_Text[m_Starts[Position]];
+	const TCHAR*	pEnd = &m_Text[0] + m_Starts[Position + 1];
+	long			Best = MaxEdits + 1;
+
+	while (pField < pEnd && Best)
+	{
+		long Needed = Distance(Pattern, pField);
+
+		if (Needed < Best)
+		{
+			Best = Needed;
+		}
+
+		pField += _tcslen(pField) + 1;
+	}
+
+	return Best;
+}
+
+// Retrieves the positions of the caches that may be within MaxEdits of the text, from the trigrams they share with it.
+// An edit changes at most three trigrams of the text: a cache missing more than 3 * MaxEdits of them is too far.
+bool CTextIndex::FuzzyCandidates(const TCHAR* pText, long Length, long MaxEdits, vector<long>& Candidates)
+{
+	vector<DWORD>	Keys;
+	long			Index;
+
+	for (Index = 0; Index + TEXT_INDEX_GRAM <= Length; Index++)
+	{
+		Keys.push_back(GramKey(pText + Index));
+	}
+
+	sort(Keys.begin(), Keys.end());
+	Keys.erase(unique(Keys.begin(), Keys.end()), Keys.end());
+
+	long Needed = (long) Keys.size() - TEXT_INDEX_GRAM * MaxEdits;
+
+	if (Needed <= 0)
+	{
+		return false;
+	}
+
+	// Number of trigrams of the text each cache holds. A text has less than 256 of them.
+	long			Count = m_Caches.size();
+	vector<BYTE>	Shared(Count, 0);
+	long			First, Last;
+
+	for (vector<DWORD>::iterator itKey = Keys.begin(); itKey != Keys.end(); itKey++)
+	{
+		if (Postings(*itKey, First, Last))
+		{
+			for (Index = First; Index < Last; Index++)
+			{
+				Shared[m_Postings[Index]]++;
+			}
+		}
+	}
+
+	for (Index = 0; Index < Count; Index++)
+	{
+		if (Shared[Index] >= Needed)
+		{
+			Candidates.push_back(Index);
+		}
+	}
+
+	return true;
+}
+
+// Adds to Matches the caches whose waypoint, name or owner contains the text give or take MaxEdits edits
+void CTextIndex::FuzzySearch(const TCHAR* pText, long MaxEdits, const vector<long>* pCandidates, TextMatchCont& Matches)
+{
+	FuzzyPattern	Pattern;
+	vector<long>	Candidates;
+	long			Index;
+
+	Prepare(pText, Pattern);
+
+	if (m_Caches.empty() || !Pattern.Length)
+	{
+		return;
+	}
+
+	// Unless the caller already narrowed them down, the trigrams rule out most caches
+	if (!pCandidates && FuzzyCandidates(pText, Pattern.Length, MaxEdits, Candidates))
+	{
+		pCandidates = &Candidates;
+	}
+
+	long Size = pCandidates ? pCandidates->size() : m_Caches.size();
+
+	for (Index = 0; Index < Size; Index++)
+	{
+		long Position = pCandidates ? (*pCandidates)[Index] : Index;
+		long Needed = Edits(Position, Pattern, MaxEdits);
+
+		if (Needed <= MaxEdits)
+		{
+			Matches.push_back(TextMatch(Needed, Position));
+		}
+	}
+
+	sort(Matches.begin(), Matches.end());
+}
@@ -0,0 +1,127 @@
+#ifndef _INC_CTextIndex
+	#define _INC_CTextIndex
+
+#include "CommonDefs.h"
+#include "CGpxParser.h"
+#include <vector>
+
+using namespace std;
+
+// Match of a fuzzy search: the edits needed and the position of the cache in the index
+typedef pair<long, long>			TextMatch;
+typedef vector<TextMatch>			TextMatchCont;
+typedef vector<TextMatch>::iterator	itTextMatch;
+
+// Pattern of a fuzzy search, prepared for Myers' bit-parallel edit distance: one bit per character of the pattern,
+// set in the mask of each character where it occurs. Characters below 256 have their masks in a table, the others
+// in a short list.
+typedef struct {
+	long	Length;
+	DWORD	Masks[256];
+	long	OtherCount;
+	TCHAR	OtherChars[32];
+	DWORD	OtherMasks[32];
+} FuzzyPattern;
+
+// Inverted index of the trigrams (runs of three characters) of the waypoint, name and owner of the loaded caches.
+// The text of the caches is lowercased once, when the index is built, and kept with each field terminated by a
+// null character. For each trigram, the index keeps the ascending positions of the caches whose text holds it.
+// A partial match query intersects the posting lists of the trigrams of the searched text, starting with the
+// shortest one, and only looks for the text in the caches left. A text shorter than a trigram is looked for in
+// every cache, still without lowercasing anything again.
+// The three characters of a trigram are folded into a DWORD, which is exact for the characters below 0x400.
+// Two trigrams sharing a key only add candidates, which the search then rejects.
+// A fuzzy search tolerates a few edits (characters inserted, deleted or replaced), which a mistyped name needs.
+// A text within k edits of the pattern still holds all but 3k of its trigrams: the caches sharing fewer trigrams
+// are skipped, the others are measured with Myers' bit-parallel algorithm and ranked by the edits needed.
+// The index holds pointers to the caches: it must be rebuilt whenever the parser loads another file.
+class CTextIndex
+{
+	// Characters in a trigram
+	#define TEXT_INDEX_GRAM		3
+	// Longest pattern of a fuzzy search: one bit per character in a DWORD. The characters beyond are ignored.
+	#define TEXT_FUZZY_MAX		32
+	// Shortest patterns tolerating one and two edits
+	#define TEXT_FUZZY_ONE		4
+	#define TEXT_FUZZY_TWO		8
+
+protected:
+	// Caches in the order of the cache list
+	GCCont			m_Caches;
+
+	// Lowercased text of the caches, and where the text of each cache starts (plus the end of the last one)
+	vector<TCHAR>	m_Text;
+	vector<long>	m_Starts;
+
+	// Sorted trigram keys, where their posting lists start (plus the end of the last one), and the posting lists
+	vector<DWORD>	m_Keys;
+	vector<long>	m_First;
+	vector<long>	m_Postings;
+
+	// Incremented each time the index is built or emptied
+	long			m_Revision;
+
+public:
+	CTextIndex();
+
+	// Indexes the caches currently loaded by the parser
+	void	Build(CGpxParser& Parser);
+
+	// Empties the index
+	void	Reset();
+
+	// Returns 'true' if the index contains no cache
+	bool	IsEmpty();
+
+	// Returns the number of caches indexed
+	long	GetCacheCount();
+
+	// Returns a cache by its position in the index
+	CGeoCache*	GetCache(long Position);
+
+	// Returns a number that changes each time the index is built or emptied
+	long	GetRevision();
+
+	// Adds to Result the caches whose waypoint, name or owner contains the text, which must already be lowercase
+	// (see Lower()). The index is only read: several threads may search it at the same time.
+	void	Search(const TCHAR* pText, GCCont& Result);
+
+	// Adds to Matches the caches whose waypoint, name or owner contains the text give or take MaxEdits edits, ranked
+	// by the edits needed then by position. The text must already be lowercase. When pCandidates isn't null, only
+	// the caches at these (ascending) positions are looked at.
+	void	FuzzySearch(const TCHAR* pText, long MaxEdits, const vector<long>* pCandidates, TextMatchCont& Matches);
+
+	// Returns the edits a fuzzy search tolerates for a text of this length
+	static long	FuzzyEdits(long Length);
+
+	// Lowercases a character the way the index and the search filter do
+	static TCHAR	Lower(TCHAR Char);
+
+protected:
+	// Appends a field, lowercased and terminated, to the text of the caches
+	void	AddField(const String& Field);
+
+	// Returns the key of the trigram starting at pGram
+	static DWORD	GramKey(const TCHAR* pGram);
+
+	// Retrieves the posting list of a trigram key. Returns 'false' if no cache holds the trigram.
+	bool	Postings(DWORD Key, long& First, long& Last);
+
+	// Returns 'true' if a field of the cache at Position contains the text
+	bool	Contains(long Position, const TCHAR* pText);
+
+	// Returns the fewest edits making the pattern part of a field of the cache at Position, or MaxEdits + 1
+	long	Edits(long Position, const FuzzyPattern& Pattern, long MaxEdits);
+
+	// Retrieves the positions of the caches that may be within MaxEdits of the text, from the trigrams they share with it.
+	// Returns 'false' if the text is too short for the trigrams to rule any cache out.
+	bool	FuzzyCandidates(const TCHAR* pText, long Length, long MaxEdits, vector<long>& Candidates);
+
+	// Prepares the masks of a pattern
+	static void	Prepare(const TCHAR* pText, FuzzyPattern& Pattern);
+
+	// Returns the fewest edits making the pattern part of the text (Myers, searching variant)
+	static long	Distance(const FuzzyPattern& Pattern, const TCHAR* pText);
+};
+
+#endif
@@ -1,9 +1,13 @@
 // Description:  Coordinate calculations.
 
 #include "Coord.h"
+#include <windows.h>
+#include <float.h>
+#include <stdlib.h>
 
 #define PI                 3.14159265358979
 #define EPSILON            5.e-14
+#define VINCENTY_MAX_ITERATIONS  100
 
 // Ellipsoid is initialized to WGS84 ellipsoid.
 const CEllipsoid CLatLon::m_Ellipsoid = CEllipsoid(6378137.00, 298.257223563);
@@ -11,6 +15,10 @@ const CEllipsoid CLatLon::m_Ellipsoid = CEllipsoid(6378137.00, 298.257223563);
 const double CLatLon::m_Radius = 6366707.01896486;
 // Degrees to radians conversion.
 const double CLatLon::m_Deg2Rad = 1.74532925199433E-02;
+// Number of Vincenty computations that did not converge.
+long CLatLon::m_VincentyFallbacks = 0;
+// Largest relative difference between the spherical and the WGS84 distances.
+const double CLatLon::m_HaversineError = 0.006;
 // UTM Zone letters.
 const std::string CLatLon::m_strZoneLetters = "CDEFGHJKLMNPQRSTUVWX";
 
@@ -758,6 +766,7 @@ double CLatLon::VincentyDistance(CLatLon& P, double *pForwardAzimuth, double *pR
    double lambda = omega;
 
    double testlambda, ss1, ss2, ss, cs, tansigma, sinalpha, cosalpha, cosalpha2, c2sm, c, dDeltaLambda;
+   int iIterations = 0;
 
    do {
       testlambda = lambda;
@@ -770,11 +779,17 @@ double CLatLon::VincentyDistance(CLatLon& P, double *pForwardAzimuth, double *pR
       dtmp = asin(sinalpha);
       cosalpha = cos(dtmp);
       cosalpha2 = cosalpha * cosalpha; 
-      c2sm = cs - 2.*sinu1*sinu2/cosalpha2;
+      // Both points on the equator
+      c2sm = (cosalpha2 != 0.) ? cs - 2.*sinu1*sinu2/cosalpha2 : 0.;
       c = flat/16. * cosalpha2*(4. + flat*(4. - 3.*cosalpha2));
-      lambda = omega + (1. - c)*flat*sinalpha*(asin(ss) + c*ss*(c2sm + c*cs*(-1. + 2.*c2sm*c2sm)));
+      lambda = omega + (1. - c)*flat*sinalpha*(atan2(ss, cs) + c*ss*(c2sm + c*cs*(-1. + 2.*c2sm*c2sm)));
       dDeltaLambda = fabs(testlambda - lambda);
-   } while (dDeltaLambda > EPSILON);
+   } while (dDeltaLambda > EPSILON && ++iIterations < VINCENTY_MAX_ITERATIONS);
+
+   // Nearly antipodal points may not converge.
+   if (_isnan(lambda) || dDeltaLambda > EPSILON) {
+      return SphericalFallback(P, pForwardAzimuth, pReverseAzimuth);
+   }
 
    double u2 = cosalpha2 * (a0*a0 - b0*b0)/(b0*b0);
    double a = 1. + (u2 / 16384.) * (4096. + u2 * (-768. + u2 * (320. - 175. * u2)));
@@ -783,7 +798,7 @@ double CLatLon::VincentyDistance(CLatLon& P, double *pForwardAzimuth, double *pR
    double dsigma = b * ss * (c2sm + (b / 4.) * (cs * (-1. + 2. * c2sm*c2sm) 
                  - (b / 6.) * c2sm * (-3. + 4. * ss*ss) * (-3. + 4. * c2sm*c2sm)));
 
-   double s = b0 * a * (asin(ss) - dsigma);
+   double s = b0 * a * (atan2(ss, cs) - dsigma);
 
    double alpha12 = atan2(cosu2 * sin(lambda), (cosu1 * sinu2 - sinu1 * cosu2 * cos(lambda)))/m_Deg2Rad;
    double alpha21 = atan2(cosu1 * sin(lambda), (-sinu1 * cosu2 + cosu1 * sinu2 * cos(lambda)))/m_Deg2Rad;
@@ -794,6 +809,44 @@ double CLatLon::VincentyDistance(CLatLon& P, double *pForwardAzimuth, double *pR
    return s;
 }
 
+// -------------------------------------------------------------------------
+// METHOD:  CLatLon::SphericalFallback()
+/*! 
+   \brief  Computes the great-circle distance and azimuths to P when the
+           Vincenty iteration fails to converge.
+
+   \return  [double] - Distance between this point and P in meters.
+
+   \param P [CLatLon&] - Point to which to compute distance.
+   \param pForwardAzimuth [double *] - Receives the forward azimuth in degrees.
+   \param pReverseAzimuth [double *] - Receives the reverse azimuth in degrees.
+
+   Only happens for nearly antipodal points, where the spherical result is
+   within a few tenths of a percent.  Each call is counted in
+   m_VincentyFallbacks, which the distance threads share.  The distance
+   comes from CPreparedPoint::SphericalDistance(): the acos() of
+   SphericalDistance() goes out of its domain for antipodal points.
+*/
+// -------------------------------------------------------------------------
+double CLatLon::SphericalFallback(CLatLon& P, double *pForwardAzimuth, double *pReverseAzimuth)
+{
+   InterlockedIncrement(&m_VincentyFallbacks);
+
+   double dLat1 = m_Deg2Rad * m_Latitude;
+   double dLat2 = m_Deg2Rad * P.m_Latitude;
+   double dDeltaLong = m_Deg2Rad * (P.m_Longitude - m_Longitude);
+
+   double alpha12 = atan2(sin(dDeltaLong) * cos(dLat2),
+                          cos(dLat1) * sin(dLat2) - sin(dLat1) * cos(dLat2) * cos(dDeltaLong)) / m_Deg2Rad;
+   double alpha21 = atan2(-sin(dDeltaLong) * cos(dLat1),
+                          cos(dLat2) * sin(dLat1) - sin(dLat2) * cos(dLat1) * cos(dDeltaLong)) / m_Deg2Rad;
+
+   *pForwardAzimuth = fmod(alpha12 + 360., 360.);
+   *pReverseAzimuth = fmod(alpha21 + 360., 360.);
+
+   return CPreparedPoint(*this).SphericalDistance(CPreparedPoint(P));
+}
+
 // -------------------------------------------------------------------------
 // METHOD:  CLatLon::VincentyProjection()
 /*! 
@@ -1186,6 +1239,536 @@ CCartesianCoord CLatLon::SphericalCross(CLatLon& P)
                           cos(dLat1) * cos(dLat2) * sin(-2.*dDeltaLong));
 }
 
+// -------------------------------------------------------------------------
+// METHOD:  CPreparedPoint::Prepare()
+/*! 
+   \brief  Sets the coordinates of the point and computes the trigonometric
+           terms used by the distance computations.
+
+   \param dLat [double] - Latitude in degrees.
+   \param dLon [double] - Longitude in degrees.
+*/
+// -------------------------------------------------------------------------
+void CPreparedPoint::Prepare(double dLat, double dLon)
+{
+   m_Latitude = dLat;
+   m_Longitude = dLon;
+
+   double dLatRad = dLat * CLatLon::m_Deg2Rad;
+   m_LongRad = dLon * CLatLon::m_Deg2Rad;
+
+   m_SinLat = sin(dLatRad);
+   m_CosLat = cos(dLatRad);
+   m_SinLong = sin(m_LongRad);
+   m_CosLong = cos(m_LongRad);
+
+   // tan(u) = (1 - f) * tan(lat), normalized so that it also holds at the poles.
+   double r = 1. - 1./CLatLon::m_Ellipsoid.m_fInv;
+   double dNorm = sqrt(r*r * m_SinLat*m_SinLat + m_CosLat*m_CosLat);
+
+   m_SinU = r * m_SinLat / dNorm;
+   m_CosU = m_CosLat / dNorm;
+}
+
+// -------------------------------------------------------------------------
+// METHOD:  CPreparedPoint::SphericalDistance()
+/*! 
+   \brief  Computes great-circle distance from this point to point P.
+
+   \return  [double] - Distance between this point and P in meters.
+
+   \param P [const CPreparedPoint&] - Point to which to compute distance.
+
+   Derives the haversine of the angle between the points from the chord
+   between their unit vectors, so it costs a single atan2 and stays
+   accurate for small distances.
+*/
+// -------------------------------------------------------------------------
+double CPreparedPoint::SphericalDistance(const CPreparedPoint& P) const
+{
+   double dx = m_CosLat * m_CosLong - P.m_CosLat * P.m_CosLong;
+   double dy = m_CosLat * m_SinLong - P.m_CosLat * P.m_SinLong;
+   double dz = m_SinLat - P.m_SinLat;
+   double h = (dx*dx + dy*dy + dz*dz) / 4.;
+
+   if (h > 1.) {
+      h = 1.;
+   }
+
+   return 2. * CLatLon::m_Radius * atan2(sqrt(h), sqrt(1. - h));
+}
+
+// -------------------------------------------------------------------------
+// METHOD:  CPreparedPoint::VincentyDistance()
+/*! 
+   \brief  Calculates the distance and forward and reverse azimuths between 
+           this point and P using the Vincenty method.
+
+   \return  [double] - Distance between this point and P in meters.
+
+   \param P [const CPreparedPoint&] - Point to which to compute distance.
+   \param pForwardAzimuth [double *] - Receives the forward azimuth in
+                                       degrees.
+   \param pReverseAzimuth [double *] - Receives the reverse azimuth in
+                                       degrees.  May be null.
+
+   Same method as CLatLon::VincentyDistance().  The reduced latitudes come
+   from the prepared points, the first iteration uses the sine and cosine
+   of the longitude difference derived from the prepared terms, and the
+   azimuths reuse the terms of the last iteration.
+*/
+// -------------------------------------------------------------------------
+double CPreparedPoint::VincentyDistance(const CPreparedPoint& P, double *pForwardAzimuth, double *pReverseAzimuth) const
+{
+   if (m_Latitude == P.m_Latitude
+      && m_Longitude == P.m_Longitude) {
+      *pForwardAzimuth = 0.;
+      if (pReverseAzimuth) {
+         *pReverseAzimuth = 0.;
+      }
+      return 0.;
+   }
+
+   double a0 = CLatLon::m_Ellipsoid.m_a;
+   double flat = 1./CLatLon::m_Ellipsoid.m_fInv;
+   double b0 = a0 * (1. - flat);
+
+   double sinu1 = m_SinU;
+   double cosu1 = m_CosU;
+   double sinu2 = P.m_SinU;
+   double cosu2 = P.m_CosU;
+
+   double omega = P.m_LongRad - m_LongRad;
+   double lambda = omega;
+   double sinlambda = P.m_SinLong * m_CosLong - P.m_CosLong * m_SinLong;
+   double coslambda = P.m_CosLong * m_CosLong + P.m_SinLong * m_SinLong;
+
+   double newlambda, ss1, ss2, ss, cs, sinalpha, cosalpha2, c2sm, c, sigma;
+   int iIterations = 0;
+
+   for (;;) {
+      ss1 = cosu2 * sinlambda;
+      ss2 = cosu1 * sinu2 - sinu1 * cosu2 * coslambda;
+      ss = sqrt(ss1*ss1 + ss2*ss2);
+      cs = sinu1 * sinu2 + cosu1 * cosu2 * coslambda;
+      sinalpha = cosu1 * ss1 / ss;
+      cosalpha2 = 1. - sinalpha * sinalpha;
+      // Both points on the equator
+      c2sm = (cosalpha2 != 0.) ? cs - 2.*sinu1*sinu2/cosalpha2 : 0.;
+      c = flat/16. * cosalpha2*(4. + flat*(4. - 3.*cosalpha2));
+      sigma = atan2(ss, cs);
+      newlambda = omega + (1. - c)*flat*sinalpha*(sigma + c*ss*(c2sm + c*cs*(-1. + 2.*c2sm*c2sm)));
+
+      if (fabs(newlambda - lambda) <= EPSILON || ++iIterations >= VINCENTY_MAX_ITERATIONS) {
+         break;
+      }
+
+      lambda = newlambda;
+      sinlambda = sin(lambda);
+      coslambda = cos(lambda);
+   }
+
+   // Nearly antipodal points may not converge.
+   if (_isnan(newlambda) || fabs(newlambda - lambda) > EPSILON) {
+      return SphericalFallback(P, pForwardAzimuth, pReverseAzimuth);
+   }
+
+   double u2 = cosalpha2 * (a0*a0 - b0*b0)/(b0*b0);
+   double a = 1. + (u2 / 16384.) * (4096. + u2 * (-768. + u2 * (320. - 175. * u2)));
+   double b = (u2 / 1024.) * (256. + u2 * (-128. + u2 * (74. - 47. * u2)));
+
+   double dsigma = b * ss * (c2sm + (b / 4.) * (cs * (-1. + 2. * c2sm*c2sm) 
+                 - (b / 6.) * c2sm * (-3. + 4. * ss*ss) * (-3. + 4. * c2sm*c2sm)));
+
+   // lambda is within EPSILON of its final value: its terms give the azimuths.
+   *pForwardAzimuth = fmod(atan2(ss1, ss2)/CLatLon::m_Deg2Rad + 360., 360.);
+
+   if (pReverseAzimuth) {
+      double alpha21 = atan2(cosu1 * sinlambda, (-sinu1 * cosu2 + cosu1 * sinu2 * coslambda))/CLatLon::m_Deg2Rad;
+      *pReverseAzimuth = fmod(alpha21 + 180., 360.);
+   }
+
+   return b0 * a * (sigma - dsigma);
+}
+
+// -------------------------------------------------------------------------
+// METHOD:  CPreparedPoint::SphericalFallback()
+/*! 
+   \brief  Computes the great-circle distance and azimuths to P when the
+           Vincenty iteration fails to converge.
+
+   \return  [double] - Distance between this point and P in meters.
+
+   \param P [const CPreparedPoint&] - Point to which to compute distance.
+   \param pForwardAzimuth [double *] - Receives the forward azimuth in degrees.
+   \param pReverseAzimuth [double *] - Receives the reverse azimuth in
+                                       degrees.  May be null.
+
+   Counted in CLatLon::m_VincentyFallbacks, like CLatLon::SphericalFallback().
+*/
+// -------------------------------------------------------------------------
+double CPreparedPoint::SphericalFallback(const CPreparedPoint& P, double *pForwardAzimuth, double *pReverseAzimuth) const
+{
+   InterlockedIncrement(&CLatLon::m_VincentyFallbacks);
+
+   double sindl = P.m_SinLong * m_CosLong - P.m_CosLong * m_SinLong;
+   double cosdl = P.m_CosLong * m_CosLong + P.m_SinLong * m_SinLong;
+
+   double alpha12 = atan2(sindl * P.m_CosLat,
+                          m_CosLat * P.m_SinLat - m_SinLat * P.m_CosLat * cosdl) / CLatLon::m_Deg2Rad;
+
+   *pForwardAzimuth = fmod(alpha12 + 360., 360.);
+
+   if (pReverseAzimuth) {
+      double alpha21 = atan2(-sindl * m_CosLat,
+                             P.m_CosLat * m_SinLat - P.m_SinLat * m_CosLat * cosdl) / CLatLon::m_Deg2Rad;
+      *pReverseAzimuth = fmod(alpha21 + 360., 360.);
+   }
+
+   return SphericalDistance(P);
+}
+
+// -------------------------------------------------------------------------
+// METHOD:  CPreparedPoint::VincentyDistances()
+/*! 
+   \brief  Calculates the distance and forward azimuth from this point to
+           each point of an array using the Vincenty method.
+
+   \param pPoints [const CPreparedPoint *] - Points.
+   \param lCount [long] - Number of points in the array.
+   \param pDistance [double *] - Receives the distances in meters.
+   \param pForwardAzimuth [double *] - Receives the forward azimuths in 
+                                       degrees.
+*/
+// -------------------------------------------------------------------------
+void CPreparedPoint::VincentyDistances(const CPreparedPoint *pPoints, long lCount,
+                                       double *pDistance, double *pForwardAzimuth) const
+{
+   for (long i = 0; i < lCount; i++) {
+      pDistance[i] = VincentyDistance(pPoints[i], &pForwardAzimuth[i], NULL);
+   }
+}
+
+// -------------------------------------------------------------------------
+// METHOD:  CPreparedPoint::HaversineDistances()
+/*! 
+   \brief  Estimates the distance and forward azimuth from this point to
+           each point of an array on a sphere.
+
+   \param pPoints [const CPreparedPoint *] - Points.
+   \param lCount [long] - Number of points in the array.
+   \param pDistance [double *] - Receives the distances in meters.
+   \param pForwardAzimuth [double *] - Receives the forward azimuths in 
+                                       degrees.
+
+   The distances are within CLatLon::m_HaversineError (relative) of the
+   Vincenty distances; the worst case, about 0.52%, is for short north-
+   south distances near the equator.  The azimuths are only approximate
+   and can be far off for long distances.  Costs two atan2 calls per
+   point, so it is used to sort out the points that are clearly inside or
+   outside of a radius.
+*/
+// -------------------------------------------------------------------------
+void CPreparedPoint::HaversineDistances(const CPreparedPoint *pPoints, long lCount,
+                                        double *pDistance, double *pForwardAzimuth) const
+{
+   double sindl, cosdl, h;
+
+   for (long i = 0; i < lCount; i++) {
+      const CPreparedPoint& P = pPoints[i];
+
+      pDistance[i] = SphericalDistance(P);
+
+      sindl = P.m_SinLong * m_CosLong - P.m_CosLong * m_SinLong;
+      cosdl = P.m_CosLong * m_CosLong + P.m_SinLong * m_SinLong;
+
+      h = atan2(sindl * P.m_CosLat,
+                m_CosLat * P.m_SinLat - m_SinLat * P.m_CosLat * cosdl) / CLatLon::m_Deg2Rad;
+      pForwardAzimuth[i] = fmod(h + 360., 360.);
+   }
+}
+
+// -------------------------------------------------------------------------
+// METHOD:  CPreparedPoint::SegmentDistance()
+/*! 
+   \brief  Computes the great-circle distance from this point to the
+           shorter great-circle arc between P1 and P2.
+
+   \return  [double] - Distance in meters.
+
+   \param P1 [const CPreparedPoint&] - First end of the arc.
+   \param P2 [const CPreparedPoint&] - Second end of the arc.
+
+   This is the cross-track distance when the foot of the perpendicular
+   falls on the arc, the distance to the nearest end otherwise.  Unlike
+   CLatLon::SphericalDistance(P1, P2), the test uses the unit vectors of
+   the points, so it holds for long arcs.
+*/
+// -------------------------------------------------------------------------
+double CPreparedPoint::SegmentDistance(const CPreparedPoint& P1, const CPreparedPoint& P2) const
+{
+   CCartesianCoord A = P1.ToSphericalCartesian() / CLatLon::m_Radius;
+   CCartesianCoord B = P2.ToSphericalCartesian() / CLatLon::m_Radius;
+   CCartesianCoord C = ToSphericalCartesian() / CLatLon::m_Radius;
+   CCartesianCoord N = A.cross(B);
+
+   double dNorm = N.Norm();
+
+   // Same or antipodal ends: no single arc joins them.
+   if (dNorm > EPSILON) {
+      N /= dNorm;
+
+      // Is C on the side of A's plane toward B and on the side of B's plane toward A?
+      CCartesianCoord AC = A.cross(C);
+      CCartesianCoord CB = C.cross(B);
+
+      if (AC.dot(N) >= 0. && CB.dot(N) >= 0.) {
+         double dSin = fabs(N.dot(C));
+         if (dSin > 1.) {
+            dSin = 1.;
+         }
+         return CLatLon::m_Radius * asin(dSin);
+      }
+   }
+
+   double d1 = SphericalDistance(P1);
+   double d2 = SphericalDistance(P2);
+
+   return (d1 < d2) ? d1 : d2;
+}
+
+// -------------------------------------------------------------------------
+// METHOD:  CPreparedPoint::ArcLatitudes()
+/*! 
+   \brief  Computes the range of latitudes covered by the shorter 
+           great-circle arc between this point and P.
+
+   \param P [const CPreparedPoint&] - Other end of the arc.
+   \param pMinLat [double *] - Receives the smallest latitude in degrees.
+   \param pMaxLat [double *] - Receives the largest latitude in degrees.
+
+   The arc bulges toward the pole beyond its ends when it crosses the
+   vertex of its great circle.
+*/
+// -------------------------------------------------------------------------
+void CPreparedPoint::ArcLatitudes(const CPreparedPoint& P, double *pMinLat, double *pMaxLat) const
+{
+   *pMinLat = (m_Latitude < P.m_Latitude) ? m_Latitude : P.m_Latitude;
+   *pMaxLat = (m_Latitude > P.m_Latitude) ? m_Latitude : P.m_Latitude;
+
+   CCartesianCoord A = ToSphericalCartesian() / CLatLon::m_Radius;
+   CCartesianCoord B = P.ToSphericalCartesian() / CLatLon::m_Radius;
+   CCartesianCoord N = A.cross(B);
+
+   double dNorm = N.Norm();
+
+   if (dNorm <= EPSILON) {
+      return;
+   }
+
+   N /= dNorm;
+
+   // Northern vertex: the point of the great circle closest to the north pole.
+   CCartesianCoord V(-N.m_z * N.m_x, -N.m_z * N.m_y, 1. - N.m_z * N.m_z);
+   double dVertex = V.Norm();
+
+   // The great circle is the equator.
+   if (dVertex <= EPSILON) {
+      return;
+   }
+
+   V /= dVertex;
+
+   CCartesianCoord AV = A.cross(V);
+   CCartesianCoord VB = V.cross(B);
+   double dLat = asin(V.m_z) / CLatLon::m_Deg2Rad;
+
+   if (AV.dot(N) >= 0. && VB.dot(N) >= 0.) {
+      *pMaxLat = dLat;
+   }
+
+   // Southern vertex.
+   V = -V;
+   AV = A.cross(V);
+   VB = V.cross(B);
+
+   if (AV.dot(N) >= 0. && VB.dot(N) >= 0.) {
+      *pMinLat = -dLat;
+   }
+}
+
+// -------------------------------------------------------------------------
+// METHOD:  CPreparedPoint::ToCartesian()
+/*! 
+   \brief  Converts lat/lon into Cartesian coordinates using ellipsoid.
+
+   \return  [CCartesianCoord] - Cartesian coordinates in meters.
+*/
+// -------------------------------------------------------------------------
+CCartesianCoord CPreparedPoint::ToCartesian(void) const
+{
+   double flat = 1./CLatLon::m_Ellipsoid.m_fInv;
+   double ecc2 = 2. * flat - flat * flat;
+   double r = CLatLon::m_Ellipsoid.m_a / sqrt(1. - ecc2 * m_SinLat * m_SinLat);
+
+   return CCartesianCoord(r * m_CosLong * m_CosLat,
+                          r * m_SinLong * m_CosLat,
+                          r * (1. - ecc2) * m_SinLat);
+}
+
+// -------------------------------------------------------------------------
+// METHOD:  CPreparedPoint::ToSphericalCartesian()
+/*! 
+   \brief  Converts lat/lon into Cartesian coordinates using spheroid.
+
+   \return  [CCartesianCoord] - Cartesian coordinates in meters.
+*/
+// -------------------------------------------------------------------------
+CCartesianCoord CPreparedPoint::ToSphericalCartesian(void) const
+{
+   return CCartesianCoord(CLatLon::m_Radius * m_CosLong * m_CosLat,
+                          CLatLon::m_Radius * m_SinLong * m_CosLat,
+                          CLatLon::m_Radius * m_SinLat);
+}
+
+#ifdef _DEBUG
+// -------------------------------------------------------------------------
+// METHOD:  CPreparedPoint::CheckDistances()
+/*! 
+   \brief  Checks the batch distances against CLatLon::VincentyDistance().
+
+   \return  [long] - Number of points that don't agree.
+
+   \param lSamples [long] - Number of random centers within 60 degrees of
+                            the equator, each checked against a batch of
+                            CHECK_BATCH_SIZE random points within 30
+                            degrees of it, half of them within 0.03 degrees.
+
+   VincentyDistances() must give exactly the results of VincentyDistance()
+   for each point, and both must be within 1e-6 meters and 1e-6 degrees of
+   CLatLon::VincentyDistance(), which derives the reduced latitudes through
+   atan/sin/cos instead of the prepared terms.
+*/
+// -------------------------------------------------------------------------
+long CPreparedPoint::CheckDistances(long lSamples)
+{
+   #define CHECK_BATCH_SIZE  64
+
+   CPreparedPoint Points[CHECK_BATCH_SIZE];
+   double dDistance[CHECK_BATCH_SIZE];
+   double dAzimuth[CHECK_BATCH_SIZE];
+   double dForward, dReverse, dSingle, dReference, dDelta;
+   long lFailures = 0;
+
+   srand(31);
+
+   for (long lSample = 0; lSample < lSamples; lSample++) {
+      CLatLon C(-60. + 120. * rand() / RAND_MAX, -180. + 360. * rand() / RAND_MAX);
+      CPreparedPoint Center(C);
+      long i;
+
+      for (i = 0; i < CHECK_BATCH_SIZE; i++) {
+         Points[i].Prepare(C.m_Latitude + (-30. + 60. * rand() / RAND_MAX) * ((i % 2) ? 1. : 0.001),
+                           C.m_Longitude + (-30. + 60. * rand() / RAND_MAX) * ((i % 2) ? 1. : 0.001));
+      }
+
+      Center.VincentyDistances(Points, CHECK_BATCH_SIZE, dDistance, dAzimuth);
+
+      for (i = 0; i < CHECK_BATCH_SIZE; i++) {
+         CLatLon P(Points[i].m_Latitude, Points[i].m_Longitude);
+
+         dSingle = Center.VincentyDistance(Points[i], &dForward, NULL);
+         dReference = C.VincentyDistance(P, &dDelta, &dReverse);
+
+         // Azimuths near north wrap around
+         dDelta = fabs(dAzimuth[i] - dDelta);
+         if (dDelta > 180.) {
+            dDelta = 360. - dDelta;
+         }
+
+         if (dDistance[i] != dSingle || dAzimuth[i] != dForward
+            || fabs(dDistance[i] - dReference) > 1.e-6 || dDelta > 1.e-6) {
+            lFailures++;
+         }
+      }
+   }
+
+   return lFailures;
+}
+
+// -------------------------------------------------------------------------
+// METHOD:  CPreparedPoint::CheckFallbacks()
+/*! 
+   \brief  Checks that the Vincenty distances end and stay within bounds
+           for the pairs where the iteration has trouble.
+
+   \return  [long] - Number of pairs that fail the checks.
+
+   \param lSamples [long] - Number of pairs of each kind: random points,
+                            points on the equator and nearly antipodal
+                            points.
+
+   Both CLatLon::VincentyDistance() and CPreparedPoint::VincentyDistance()
+   must return finite distances within m_HaversineError of the great-circle
+   distance, and azimuths from 0 to 360 degrees.  The nearly antipodal
+   pairs must make the iteration fall back at least once.
+*/
+// -------------------------------------------------------------------------
+long CPreparedPoint::CheckFallbacks(long lSamples)
+{
+   double dLat1, dLong1, dLat2, dLong2, dForward, dReverse, dDistance, dSpherical;
+   long lFallbacks = CLatLon::m_VincentyFallbacks;
+   long lFailures = 0;
+
+   srand(32);
+
+   for (long i = 0; i < 3 * lSamples; i++) {
+      dLat1 = -90. + 180. * rand() / RAND_MAX;
+      dLong1 = -180. + 360. * rand() / RAND_MAX;
+      dLat2 = -90. + 180. * rand() / RAND_MAX;
+      dLong2 = -180. + 360. * rand() / RAND_MAX;
+
+      if (i % 3 == 1) {
+         dLat1 = 0.;
+         dLat2 = 0.;
+      }
+      else if (i % 3 == 2) {
+         dLat1 = -89. + 178. * rand() / RAND_MAX;
+         dLat2 = -dLat1 + (-0.5 + 1. * rand() / RAND_MAX) * ((i % 2) ? 1. : 1.e-6);
+         dLong2 = dLong1 + 180. + (-0.5 + 1. * rand() / RAND_MAX) * ((i % 2) ? 1. : 1.e-6);
+      }
+
+      CLatLon P1(dLat1, dLong1);
+      CLatLon P2(dLat2, dLong2);
+      CPreparedPoint Q1(P1);
+      CPreparedPoint Q2(P2);
+
+      dSpherical = Q1.SphericalDistance(Q2);
+
+      for (int iMethod = 0; iMethod < 2; iMethod++) {
+         if (iMethod) {
+            dDistance = Q1.VincentyDistance(Q2, &dForward, &dReverse);
+         }
+         else {
+            dDistance = P1.VincentyDistance(P2, &dForward, &dReverse);
+         }
+
+         if (_isnan(dDistance) || _isnan(dForward) || _isnan(dReverse)
+            || fabs(dDistance - dSpherical) > CLatLon::m_HaversineError * dSpherical
+            || dForward < 0. || dForward >= 360. || dReverse < 0. || dReverse >= 360.) {
+            lFailures++;
+         }
+      }
+   }
+
+   if (CLatLon::m_VincentyFallbacks == lFallbacks) {
+      lFailures++;
+   }
+
+   return lFailures;
+}
+#endif
+
 /*
 void findandreplace(std::string& strSource, std::string& strFind, std::string& strReplace)
 {
@@ -40,6 +40,8 @@ public:
    static const double m_Radius;          //!< Earth radius in meters.
    static const double m_Deg2Rad;         //!< Conversion factor.
    static const std::string m_strZoneLetters;   //!< UTM zones.
+   static long m_VincentyFallbacks;       //!< Vincenty computations that did not converge.
+   static const double m_HaversineError;  //!< Relative error bound of the spherical distances.
 
 public:
    double SphericalDistance(CLatLon& P);
@@ -90,6 +92,7 @@ public:
    static void CleanCoordString(std::string& strCoordString);
 
 protected:
+   double SphericalFallback(CLatLon& P, double *pForwardAzimuth, double *pReverseAzimuth);
    int GetZone(void);
    char GetZoneLetter(void);
    bool ConvertUTM(int iZone, char cZoneLetter, double dEasting, double dNorthing);
@@ -211,6 +214,70 @@ public:
    };
 };
 
+// -------------------------------------------------------------------------
+// CLASS:  CPreparedPoint
+/*! 
+   \brief  Latitude/longitude coordinate along with the trigonometric terms
+           used by the distance computations.
+
+   Preparing a point evaluates the sines and cosines of its latitude,
+   longitude and reduced latitude once.  The distance methods taking
+   prepared points only evaluate the terms that depend on both points,
+   which roughly halves the transcendental calls per pair.  Prepare()
+   must be called again whenever the coordinates change.
+*/
+// -------------------------------------------------------------------------
+class CPreparedPoint
+{
+public:
+   //! Default constructor.
+   CPreparedPoint() {
+      Prepare(0., 0.);
+   };
+   //! Constructor.
+   CPreparedPoint(double dLat, double dLon) {
+      Prepare(dLat, dLon);
+   };
+   //! Constructor from a CLatLon coordinate.
+   CPreparedPoint(CLatLon& P) {
+      Prepare(P.m_Latitude, P.m_Longitude);
+   };
+
+public:
+   double m_Latitude;   //!< Latitude (degrees)
+   double m_Longitude;  //!< Longitude (degrees)
+   double m_LongRad;    //!< Longitude (radians)
+   double m_SinLat;     //!< Sine of the latitude.
+   double m_CosLat;     //!< Cosine of the latitude.
+   double m_SinLong;    //!< Sine of the longitude.
+   double m_CosLong;    //!< Cosine of the longitude.
+   double m_SinU;       //!< Sine of the reduced latitude.
+   double m_CosU;       //!< Cosine of the reduced latitude.
+
+public:
+   void Prepare(double dLat, double dLon);
+
+   double SphericalDistance(const CPreparedPoint& P) const;
+   double VincentyDistance(const CPreparedPoint& P, double *pForwardAzimuth, double *pReverseAzimuth) const;
+   void VincentyDistances(const CPreparedPoint *pPoints, long lCount,
+                          double *pDistance, double *pForwardAzimuth) const;
+   void HaversineDistances(const CPreparedPoint *pPoints, long lCount,
+                           double *pDistance, double *pForwardAzimuth) const;
+   double SegmentDistance(const CPreparedPoint& P1, const CPreparedPoint& P2) const;
+   void ArcLatitudes(const CPreparedPoint& P, double *pMinLat, double *pMaxLat) const;
+
+   CCartesianCoord ToCartesian(void) const;
+   CCartesianCoord ToSphericalCartesian(void) const;
+
+#ifdef _DEBUG
+   static long CheckDistances(long lSamples);
+   static long CheckFallbacks(long lSamples);
+#endif
+
+protected:
+   double SphericalFallback(const CPreparedPoint& P, double *pForwardAzimuth, double *pReverseAzimuth) const;
+};
+
 void findandreplace(std::string& strSource, std::string& strFind, std::string& strReplace);
 void trim(std::string& strSource);
 
@@ -22,6 +22,9 @@
 #include "CFilterSearch.h"
 #include "CFilterCacheRatings.h"
 #include "CFilterCacheTB.h"
+#include "CFilterCorridor.h"
+#include "CFilterFullText.h"
+#include "CFilterExpression.h"
 #include "CListPreferencesDlg.h"
 #include "CMyAliasDlg.h"
 #include "CFieldNotesReportPrefDlg.h"
@@ -77,6 +80,12 @@ BEGIN_MESSAGE_MAP(CGpxSonarView, CListView)
 	ON_NOTIFY_REFLECT(GN_CONTEXTMENU, OnContextMenu)
 	ON_COMMAND(ID_MENU_EXPORT, OnMenuExport)
 	//}}AFX_MSG_MAP
+	ON_MESSAGE(WM_FULL_TEXT_INDEX_READY, OnFullTextIndexReady)
+	ON_MESSAGE(WM_SEARCH_CHANGED, OnSearchChanged)
+#ifdef _DEBUG
+	ON_COMMAND(ID_DEBUG_FILTERBENCHMARK, OnDebugFilterBenchmark)
+	ON_COMMAND(ID_DEBUG_SELFCHECKS, OnDebugSelfChecks)
+#endif
 END_MESSAGE_MAP()
 
 CGpxSonarView::CGpxSonarView()
@@ -102,6 +111,9 @@ CGpxSonarView::CGpxSonarView()
 	CFilterSearch*			pFilterSearch = new CFilterSearch(_T("Search"), FilterSearch);
 	CFilterCacheRatings*	pFilterRatings = new CFilterCacheRatings(_T("Cache Ratings"), FilterRatings);
 	CFilterCacheTB*			pFilterCacheTB = new CFilterCacheTB(_T("Cache With TB"), FilterTravelBugs);
+	CFilterCorridor*		pFilterCorridor = new CFilterCorridor(_T("Along A Route"), FilterCorridor);
+	CFilterFullText*		pFilterFullText = new CFilterFullText(_T("Full Text"), FilterFullText);
+	CFilterExpression*		pFilterExpression = new CFilterExpression(_T("Expression"), FilterExpression);
 
 	m_FilterMgr.Add(pFilterCacheTypes);
 	m_FilterMgr.Add(pFilterCacheContainers);
@@ -112,6 +124,18 @@ CGpxSonarView::CGpxSonarView()
 	m_FilterMgr.Add(pFilterSearch);
 	m_FilterMgr.Add(pFilterRatings);
 	m_FilterMgr.Add(pFilterCacheTB);
+	m_FilterMgr.Add(pFilterCorridor);
+	m_FilterMgr.Add(pFilterFullText);
+	m_FilterMgr.Add(pFilterExpression);
+
+	// The corridor is looked up in the index of the loaded caches, its width given in the list's units
+	pFilterCorridor->SetSpatialIndex(&m_SpatialIndex, &m_CenterCoords);
+
+	// A partial search looks up the trigrams of its text in the index of the loaded caches
+	pFilterSearch->SetTextIndex(&m_TextIndex);
+
+	// The descriptions, hints and logs are searched in an index built in the background after each load
+	pFilterFullText->SetFullTextIndex(&m_FullTextIndex);
 
 	// Default column widths expressed in pixels
 	enum ColWidths { 
@@ -196,6 +220,9 @@ CGpxSonarView::~CGpxSonarView()
 {
 	SaveConfig();
 
+	// Make sure the configuration is on disk before going away
+	m_ConfigWriter.Flush();
+
 	Cleanup();
 }
 
@@ -379,6 +406,9 @@ void CGpxSonarView::OnInitialUpdate()
 	// Load the HTML template used to create cache pages
 	m_CachePageWriter.LoadTemplate(TargetFname.c_str());
 
+	// Nearby caches are looked up in the index of the loaded caches, their distances shown in the list's units
+	m_CachePageWriter.m_NearbyWriter.SetSpatialIndex(&m_SpatialIndex, &m_CenterCoords);
+
 	#define	AUTO_SAVE_TIMER	1967
 	#define	THIRTY_SECS		30000
 
@@ -480,6 +510,9 @@ void CGpxSonarView::LoadConfig()
 			// By calling SaveConfig() here, it forces a conversion process to take place to the new format
 			SaveConfig();
 
+			// The converted file gets loaded below
+			m_ConfigWriter.Flush();
+
 			// Flush the configuration of the notes mgr and of the cache mgr
 			m_NotesMgr.SaveConfig();
 
@@ -495,6 +528,9 @@ void CGpxSonarView::LoadConfig()
 
 	Fname = Path.BuildPath(GPXSONAR_CONFIG_FILENAME_2);
 
+	// Finish a save interrupted while the file was being replaced
+	CConfigWriter::Recover(Fname);
+
 	// Check if there's a 2.x configuration filename
 	if (GetFileAttributes(Fname.c_str()) != -1)
 	{
@@ -585,7 +621,11 @@ void CGpxSonarView::SaveConfig()
 
 	String	TargetFname = Path.BuildPath(GPXSONAR_CONFIG_FILENAME_2);
 
-	CStream	ar;
+	// The stream holds a frozen copy of the settings, it gets checksummed and written to disk by the writer thread.
+	// The settings are formatted here: they're small, and copying the objects for another thread would cost as much.
+	CStream* pAr = new CStream;
+
+	CStream& ar = *pAr;
 
 	ar.SetStoring(true);
 
@@ -618,7 +658,7 @@ void CGpxSonarView::SaveConfig()
 	m_Bookmarks.Serialize(ar);
 	m_ExportLocationMgr.Serialize(ar);
 
-	ar.Save(TargetFname);
+	m_ConfigWriter.Post(TargetFname, pAr);
 
 	m_NeedToSaveChanges = false;
 
@@ -646,6 +686,25 @@ void CGpxSonarView::SetupListControl()
 }
 
 void CGpxSonarView::UpdateCacheList()
+{
+	BeginWaitCursor();
+
+	// Exact distances near the radius of the bearing/distance filter
+	RefineDistances(false);
+
+	// Apply the filters on the caches before refreshing the list
+	m_FilterMgr.Filter(m_GpxParser);
+
+	// Exact distances for the caches about to be shown
+	RefineDistances(true);
+
+	FillCacheList();
+
+	EndWaitCursor();
+}
+
+// Rebuilds the list with the caches that are in scope
+void CGpxSonarView::FillCacheList()
 {
 	LVITEM		Item;
 	itGC		C;
@@ -660,9 +719,6 @@ void CGpxSonarView::UpdateCacheList()
 
 	CacheList.DeleteAllItems();
 
-	// Apply the filters on the caches before refreshing the list
-	m_FilterMgr.Filter(m_GpxParser);
-
 	CGeoCache* pCache = m_GpxParser.First(C);
 
 	while (!m_GpxParser.EndOfCacheList(C))
@@ -808,7 +864,7 @@ void CGpxSonarView::UpdateCacheList()
 			{
 				// Bearing
 				Item.iSubItem++;
-				Item.pszText = (TCHAR*) pCache->m_Bearing.c_str();
+				Item.pszText = (TCHAR*) CFilterBearingDistance::BearingText(pCache->m_Bearing);
 				CacheList.SetItem(&Item);
 			}
 
@@ -888,6 +944,12 @@ void CGpxSonarView::LoadGpxFile(CString& GpxFilename)
 
 	GpxLoadStatus Status;
 	
+	// The indexes and the results kept by the filters point to the caches about to be deleted
+	m_SpatialIndex.Reset();
+	m_TextIndex.Reset();
+	m_FullTextIndex.Reset();
+	m_FilterMgr.Invalidate();
+
 	Status = m_GpxParser.Load((LPCTSTR)GpxFilename);
 
 	switch (Status)
@@ -917,6 +979,12 @@ void CGpxSonarView::LoadGpxFile(CString& GpxFilename)
 
 		ReconnectIgnoredCaches();
 
+		m_SpatialIndex.Build(m_GpxParser);
+		m_TextIndex.Build(m_GpxParser);
+
+		// Takes its copy of the list before the list gets sorted
+		m_FullTextIndex.Start(m_GpxParser, (LPCTSTR) GpxFilename, m_hWnd);
+
 		{ // These 3 calls must be together
 			ComputeDistanceBearing();
 			UpdateCacheList();
@@ -1069,94 +1137,291 @@ void CGpxSonarView::ReconnectIgnoredCaches()
 {
 	CFilterCacheLists* pFCL = (CFilterCacheLists*) m_FilterMgr.Find(FilterCacheLists);
 
-	itGC it;
+	BeginWaitCursor();
+
+	// The caches get filtered once the list is refreshed
+	pFCL->Reconnect(m_GpxParser);
+
+	EndWaitCursor();
+}
 
+void CGpxSonarView::ComputeDistanceBearing()
+{
 	BeginWaitCursor();
 
+	itGC	it;
+	GCCont	Caches;
+
+	CFilterBearingDistance* pFBD = (CFilterBearingDistance*) m_FilterMgr.Find(FilterBearingDistance);
+
 	CGeoCache* pCache = m_GpxParser.First(it);
 
 	while (!m_GpxParser.EndOfCacheList(it))
 	{
-		// Lookup the Id of the cache...
-		if (pFCL->Find(pCache->m_GsCacheId))
+		if (pFBD->IsEnabled() && !m_SpatialIndex.IsEmpty())
 		{
-			// Flag the cache as ignored if found
-			pCache->m_Ignored = true;
+			// Only the caches around the center are looked at below
+			pCache->m_Distance = DISTANCE_UNKNOWN;
+			pCache->m_DistanceState = GD_None;
+			pCache->m_Bearing = GB_Unknown;
+		}
+		else
+		{
+			Caches.push_back(pCache);
 		}
-
-		// Run the cache through the filter to determine if it's still in scope
-		pFCL->OnFilterCache(pCache);
 
 		pCache = m_GpxParser.Next(it);
-	}	
+	}
+
+	// The caches beyond the radius of the filter can't be shown: their distance is not needed
+	if (pFBD->IsEnabled() && !m_SpatialIndex.IsEmpty())
+	{
+		m_SpatialIndex.Radius(m_CenterCoords.m_Latitude, m_CenterCoords.m_Longitude, pFBD->m_Distance * m_CenterCoords.GetDistanceUnits(), Caches);
+	}
+
+	// Most caches are far from the radius of the filter and are never shown: an estimate is enough for them.
+	// RefineDistances() computes the exact distance of the others.
+	EstimateDistances(Caches);
+
+	// Sort the actual cache container according to their distance from the center
+	m_GpxParser.SortByDistance();
 
 	EndWaitCursor();
 }
 
-void CGpxSonarView::ComputeDistanceBearing()
+// Estimates the distance and the bearing of the caches in a single batch. Returns 'true' if there were any.
+bool CGpxSonarView::EstimateDistances(GCCont& Caches)
 {
-	CCoords	CachePoint;
+	long Count = Caches.size();
 
-	double		Units = m_CenterCoords.GetDistanceUnits();
-	
-	double		ForwardAzimuth, ReverseAzimuth;
+	if (!Count)
+	{
+		return false;
+	}
 
-	BeginWaitCursor();
+	// Gather the coordinates so that the distances are estimated in a single batch
+	vector<CPreparedPoint>	Points(Count);
+	vector<double>			Distance(Count);
+	vector<double>			Azimuth(Count);
+	CPreparedPoint			Center(m_CenterCoords);
+	long					Index;
 
-	itGC it;
+	for (Index = 0; Index < Count; Index++)
+	{
+		Points[Index] = Caches[Index]->m_Point;
+	}
 
-	CGeoCache* pCache = m_GpxParser.First(it);
+	Center.HaversineDistances(&Points[0], Count, &Distance[0], &Azimuth[0]);
 
-	while (!m_GpxParser.EndOfCacheList(it))
+	for (Index = 0; Index < Count; Index++)
 	{
-		// Distance
-		CachePoint.SetDecimal(pCache->m_Lat, pCache->m_Long);
+		SetDistanceBearing(Caches[Index], Distance[Index], Azimuth[Index], GD_Approx);
+	}
 
-		pCache->m_Distance = (m_CenterCoords.VincentyDistance(CachePoint, &ForwardAzimuth, &ReverseAzimuth)) / Units;
+	return true;
+}
 
-		// Bearing
-		if ((ForwardAzimuth >= 338.0 && ForwardAzimuth <= 360.0) || (ForwardAzimuth >= 0.0 && ForwardAzimuth < 24.0))
-		{
-			pCache->m_Bearing = BEARING_NORTH;
-		}
-		else if (ForwardAzimuth >= 24.0 && ForwardAzimuth < 70.0)
-		{
-			pCache->m_Bearing = BEARING_NORTHEAST;
-		}
-		else if (ForwardAzimuth >= 70.0 && ForwardAzimuth < 116.0)
+// Replaces the distance estimates with exact distances for the caches that may fall within the radius
+// of the bearing/distance filter or, when InScopeOnly is true, for the caches shown in the list.
+void CGpxSonarView::RefineDistances(bool InScopeOnly)
+{
+	double	Limit = 0.0;
+	bool	UseIndex = false;
+	bool	Estimated = false;
+	itGC	it;
+	GCCont	Candidates;
+	GCCont	Unknown;
+
+	CFilterBearingDistance* pFBD = (CFilterBearingDistance*) m_FilterMgr.Find(FilterBearingDistance);
+
+	if (!InScopeOnly)
+	{
+		// Beyond this, the cache is outside of the radius whatever its exact distance.
+		// Within it, the exact distance decides, and so does the exact bearing.
+		Limit = pFBD->m_Distance * (1.0 + CLatLon::m_HaversineError);
+
+		// The index returns every cache that may be within the limit, including the ones
+		// whose distance is unknown because the radius grew since ComputeDistanceBearing()
+		if (pFBD->IsEnabled() && !m_SpatialIndex.IsEmpty())
 		{
-			pCache->m_Bearing = BEARING_EAST;
+			m_SpatialIndex.Radius(m_CenterCoords.m_Latitude, m_CenterCoords.m_Longitude, pFBD->m_Distance * m_CenterCoords.GetDistanceUnits(), Candidates);
+
+			UseIndex = true;
 		}
-		else if (ForwardAzimuth >= 116.0 && ForwardAzimuth < 162.0)
+	}
+
+	if (!UseIndex)
+	{
+		CGeoCache* pCache = m_GpxParser.First(it);
+
+		while (!m_GpxParser.EndOfCacheList(it))
 		{
-			pCache->m_Bearing = BEARING_SOUTHEAST;
+			Candidates.push_back(pCache);
+
+			pCache = m_GpxParser.Next(it);
 		}
-		else if (ForwardAzimuth >= 162.0 && ForwardAzimuth < 208.0)
+	}
+
+	// The caches left without a distance while the filter was enabled, and that the filters may now look at
+	// (the filter was disabled, or its radius grew), get an estimate before the filters compare it
+	if (!InScopeOnly)
+	{
+		for (it = Candidates.begin(); it != Candidates.end(); it++)
 		{
-			pCache->m_Bearing = BEARING_SOUTH;
+			if ((*it)->m_DistanceState == GD_None)
+			{
+				Unknown.push_back(*it);
+			}
 		}
-		else if (ForwardAzimuth >= 208.0 && ForwardAzimuth < 254.0)
+
+		Estimated = EstimateDistances(Unknown);
+
+		// Only the caches near the radius need their exact distance
+		if (!pFBD->IsEnabled())
 		{
-			pCache->m_Bearing = BEARING_SOUTHWEST;
+			if (Estimated)
+			{
+				m_GpxParser.SortByDistance();
+			}
+
+			return;
 		}
-		else if (ForwardAzimuth >= 254.0 && ForwardAzimuth < 300.0)
+	}
+
+	GCCont					Refine;
+	vector<CPreparedPoint>	Points;
+
+	for (it = Candidates.begin(); it != Candidates.end(); it++)
+	{
+		CGeoCache* pCache = *it;
+
+		if (pCache->m_DistanceState != GD_Exact)
 		{
-			pCache->m_Bearing = BEARING_WEST;
+			if ((InScopeOnly && pCache->m_InScope) || (!InScopeOnly && pCache->m_Distance <= Limit))
+			{
+				Refine.push_back(pCache);
+				Points.push_back(pCache->m_Point);
+			}
 		}
-		else if (ForwardAzimuth >= 300.0 && ForwardAzimuth < 338.0)
+	}
+
+	long Count = Refine.size();
+
+	if (!Count)
+	{
+		if (Estimated)
 		{
-			pCache->m_Bearing = BEARING_NORTHWEST;
+			m_GpxParser.SortByDistance();
 		}
-		else
+
+		return;
+	}
+
+	vector<double>	Distance(Count);
+	vector<double>	Azimuth(Count);
+	CPreparedPoint	Center(m_CenterCoords);
+
+	Center.VincentyDistances(&Points[0], Count, &Distance[0], &Azimuth[0]);
+
+	for (long Index = 0; Index < Count; Index++)
+	{
+		SetDistanceBearing(Refine[Index], Distance[Index], Azimuth[Index], GD_Exact);
+	}
+
+	// The order may have changed slightly
+	m_GpxParser.SortByDistance();
+}
+
+// Sets the distance and the bearing of a cache from a distance in meters and an azimuth in degrees
+void CGpxSonarView::SetDistanceBearing(CGeoCache* pCache, double Meters, double Azimuth, GcDistance State)
+{
+	// Distance
+	pCache->m_Distance = Meters / m_CenterCoords.GetDistanceUnits();
+	pCache->m_DistanceState = State;
+
+	// Bearing
+	pCache->m_Bearing = CFilterBearingDistance::BearingFromAzimuth(Azimuth);
+}
+
+// Updates the distances and the list after the center coordinates changed. When the same caches
+// remain in scope, only the distance and bearing cells that changed are updated.
+void CGpxSonarView::Recenter()
+{
+	BeginWaitCursor();
+
+	ComputeDistanceBearing();
+
+	RefineDistances(false);
+
+	m_FilterMgr.Filter(m_GpxParser);
+
+	RefineDistances(true);
+
+	CListCtrl&	CacheList = GetListCtrl();
+	int			Rows = CacheList.GetItemCount();
+	int			Row;
+	bool		SameScope = (Rows != 0);
+	long		InScope = 0;
+	itGC		it;
+
+	// Same number of caches in scope...
+	CGeoCache* pCache = m_GpxParser.First(it);
+
+	while (!m_GpxParser.EndOfCacheList(it))
+	{
+		if (pCache->m_InScope)
 		{
-			pCache->m_Bearing = _T("?");
+			InScope++;
 		}
 
 		pCache = m_GpxParser.Next(it);
 	}
 
-	// Sort the actual cache container according to their distance from the center
-	m_GpxParser.SortByDistance();
+	SameScope = SameScope && (InScope == Rows);
+
+	// ...and each of them already in the list
+	for (Row = 0; SameScope && Row < Rows; Row++)
+	{
+		SameScope = ((CGeoCache*) CacheList.GetItemData(Row))->m_InScope;
+	}
+
+	if (!SameScope)
+	{
+		FillCacheList();
+	}
+	else
+	{
+		int		DistCol = GetColumnById(ColDist);
+		int		BearingCol = GetColumnById(ColBearing);
+		TCHAR	Buffer[20];
+
+		for (Row = 0; Row < Rows; Row++)
+		{
+			pCache = (CGeoCache*) CacheList.GetItemData(Row);
+
+			if (DistCol != -1)
+			{
+				_stprintf(Buffer, _T("%.02f"), pCache->m_Distance);
+
+				if (CacheList.GetItemText(Row, DistCol) != Buffer)
+				{
+					CacheList.SetItemText(Row, DistCol, Buffer);
+				}
+			}
+
+			if (BearingCol != -1)
+			{
+				const TCHAR* pBearing = CFilterBearingDistance::BearingText(pCache->m_Bearing);
+
+				if (CacheList.GetItemText(Row, BearingCol) != pBearing)
+				{
+					CacheList.SetItemText(Row, BearingCol, pBearing);
+				}
+			}
+		}
+	}
+
+	SortByIncreasingDistance();
 
 	EndWaitCursor();
 }
@@ -1806,13 +2071,9 @@ void CGpxSonarView::OnMenuSetascenter()
 	{
 		m_CenterCoords.SetDecimal(m_pCurrCache->m_Lat, m_pCurrCache->m_Long);
 		
-		{ // These 3 calls must be together
-			ComputeDistanceBearing();
-			UpdateCacheList();
-			SortByIncreasingDistance();
+		Recenter();
 
-			m_NeedToSaveChanges = true;
-		}
+		m_NeedToSaveChanges = true;
 	}	
 }
 
@@ -1962,10 +2223,67 @@ void CGpxSonarView::OnGpxfileinfo()
 	
 	Dlg.m_SavedGpxFilename = m_SavedGpxFilename;
 	Dlg.m_pNotesMgr = &m_NotesMgr;
+	Dlg.m_pFilterMgr = &m_FilterMgr;
 
 	Dlg.DoModal();
 }
 
+#ifdef _DEBUG
+// Times a filtering pass from scratch with 1, 2, 4... threads. The passes forget the results kept by the filters
+// and set the caches in scope again: the list is refreshed afterwards.
+void CGpxSonarView::OnDebugFilterBenchmark()
+{
+	#define MAX_BENCHMARK_SIZE	48
+
+	TCHAR	Line[MAX_BENCHMARK_SIZE];
+	String	Report;
+
+	BeginWaitCursor();
+
+	for (long Threads = 1; Threads <= FILTER_MAX_THREADS; Threads *= 2)
+	{
+		_sntprintf(Line, MAX_BENCHMARK_SIZE, _T("%li Thread(s): %lu ms\r\n"), Threads, m_FilterMgr.Benchmark(m_GpxParser, Threads));
+
+		Report += Line;
+	}
+
+	EndWaitCursor();
+
+	UpdateCacheList();
+	SortByIncreasingDistance();
+
+	MessageBox(Report.c_str(), _T("Filter Benchmark"), MB_OK | MB_ICONINFORMATION);
+}
+
+// Runs the checks that the modules keep for their debug builds and reports the failures of each
+void CGpxSonarView::OnDebugSelfChecks()
+{
+	#define SELF_CHECK_SAMPLES	200
+	#define MAX_SELF_CHECK_SIZE	64
+
+	TCHAR	Line[MAX_SELF_CHECK_SIZE];
+	String	Report;
+
+	BeginWaitCursor();
+
+	_sntprintf(Line, MAX_SELF_CHECK_SIZE, _T("Batch distances: %li failure(s)\r\n"), CPreparedPoint::CheckDistances(SELF_CHECK_SAMPLES));
+	Report += Line;
+
+	_sntprintf(Line, MAX_SELF_CHECK_SIZE, _T("Vincenty fallbacks: %li failure(s)\r\n"), CPreparedPoint::CheckFallbacks(SELF_CHECK_SAMPLES));
+	Report += Line;
+
+	CPath Path;
+
+	_sntprintf(Line, MAX_SELF_CHECK_SIZE, _T("Config snapshots: %li failure(s)\r\n"),
+		CConfigWriter::CheckSnapshots(Path.BuildPath(_T("\\Docs\\ConfigWriterCheck.dat")), SELF_CHECK_SAMPLES));
+	Report += Line;
+
+	EndWaitCursor();
+
+	MessageBox(Report.c_str(), _T("Self Checks"), MB_OK | MB_ICONINFORMATION);
+}
+#endif
+
 void CGpxSonarView::OnMenuFileReportsFieldnotes() 
 {
 	if (!m_LastFieldNotesReport.IsEmpty())
@@ -2040,6 +2358,53 @@ void CGpxSonarView::OnMenuFilters()
 	}	
 }
 
+// The full text index of the loaded caches is ready: a full text filter can now take effect
+LRESULT CGpxSonarView::OnFullTextIndexReady(WPARAM wParam, LPARAM lParam)
+{
+	CFilterBase* pFilter = m_FilterMgr.Find(FilterFullText);
+
+	if (pFilter && pFilter->IsEnabled() && m_FullTextIndex.IsReady())
+	{
+		UpdateCacheList();
+		SortByIncreasingDistance();
+	}
+
+	return 0;
+}
+
+// The quick search dialog changed the search while the text was being typed. Returns the number of caches listed.
+LRESULT CGpxSonarView::OnSearchChanged(WPARAM wParam, LPARAM lParam)
+{
+	CListCtrl&		CacheList = GetListCtrl();
+	CFilterSearch*	pSearch = (CFilterSearch*) m_FilterMgr.Find(FilterSearch);
+
+	UpdateCacheList();
+	SortByIncreasingDistance();
+
+	// The list is sorted by distance: the closest match to the text is pointed out
+	CGeoCache* pBest = pSearch->IsEnabled() ? pSearch->GetBestMatch() : 0;
+
+	if (pBest)
+	{
+		LVFINDINFO	Find;
+
+		Find.flags = LVFI_PARAM;
+		Find.lParam = (LPARAM) pBest;
+
+		int Item = CacheList.FindItem(&Find);
+
+		if (Item != -1)
+		{
+			CacheList.SetItemState(Item, LVIS_SELECTED | LVIS_FOCUSED, LVIS_SELECTED | LVIS_FOCUSED);
+			CacheList.EnsureVisible(Item, false);
+		}
+	}
+
+	m_NeedToSaveChanges = true;
+
+	return CacheList.GetItemCount();
+}
+
 void CGpxSonarView::OnMenuListoptionsCentercoords() 
 {
 	CCenterCoordsDlg Dlg;
@@ -2058,13 +2423,9 @@ void CGpxSonarView::OnMenuListoptionsCentercoords()
 				Dlg.m_LatDeg, Dlg.m_LatMinMmm, Dlg.m_LatChar,
 				Dlg.m_LongDeg, Dlg.m_LongMinMmm, Dlg.m_LongChar);
 
-		{ // These 3 calls must be together
-			ComputeDistanceBearing();
-			UpdateCacheList();
-			SortByIncreasingDistance();
+		Recenter();
 
-			m_NeedToSaveChanges = true;
-		}
+		m_NeedToSaveChanges = true;
 	}
 
 	::SHSipPreference(m_hWnd, SIP_FORCEDOWN);
@@ -2209,6 +2570,7 @@ void CGpxSonarView::OnQuickSearch()
 	Dlg.m_pSearch = (CFilterSearch*) pFilterMgr->Find(FilterSearch);
 	Dlg.m_ShowEnableSearch = true;
 	Dlg.m_EnableSearch = Dlg.m_pSearch->IsEnabled();
+	Dlg.m_hLiveWnd = m_hWnd;
 
 	if (Dlg.DoModal() == IDOK)
 	{
@@ -2227,6 +2589,9 @@ void CGpxSonarView::OnFileExit()
 
 	SaveConfig();
 
+	// Make sure the configuration is on disk before quitting
+	m_ConfigWriter.Flush();
+
 	Cleanup();
 
 	PostMessage(WM_QUIT);
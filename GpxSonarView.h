@@ -18,6 +18,10 @@
 #include "CCacheReportsPref.h"
 #include "CCacheMgr.h"
 #include "CExportLocationMgr.h"
+#include "CConfigWriter.h"
+#include "CSpatialIndex.h"
+#include "CTextIndex.h"
+#include "CFullTextIndex.h"
 #include "IDB_CACHES.h"
 
 #include "CHeading.h"
@@ -56,6 +60,10 @@ public:
 	CFilterMgr				m_FilterMgr;
 	CWPMgr					m_Bookmarks;
 	CGpxParser				m_GpxParser;
+	CSpatialIndex			m_SpatialIndex;
+	CTextIndex				m_TextIndex;
+	// Declared after the parser: the indexing thread must stop before the caches go away
+	CFullTextIndex			m_FullTextIndex;
 	CGeoCache*				m_pCurrCache;
 	CSearchDlg*				m_pSearchDlg;
 	CWnd*					m_pWndMenu;
@@ -65,6 +73,7 @@ public:
 	CTBMgr					m_TBMgr;
 	CCacheReportsPref		m_CacheReportPref;
 	CExportLocationMgr		m_ExportLocationMgr;
+	CConfigWriter			m_ConfigWriter;
 	CString					m_SavedGpxFilename;
 	CString					m_LastCacheDetails;
 	CString					m_LastFieldNotesReport;
@@ -105,11 +114,27 @@ protected:
 
 	void	SetupListControl();
 	void	UpdateCacheList();
+	void	FillCacheList();
 	void	SelectCurrentCache();
 	void	ResizeListControl();
 
 	void	ComputeDistanceBearing();
 
+	// Updates the distances and the list after the center coordinates changed. When the same caches
+	// remain in scope, only the distance and bearing cells that changed are updated.
+	void	Recenter();
+
+	// Replaces the distance estimates with exact distances for the caches that may fall within the radius
+	// of the bearing/distance filter or, when InScopeOnly is true, for the caches shown in the list.
+	// Without InScopeOnly, the caches left without a distance that the filters may now look at are estimated first.
+	void	RefineDistances(bool InScopeOnly);
+
+	// Estimates the distance and the bearing of the caches in a single batch. Returns 'true' if there were any.
+	bool	EstimateDistances(GCCont& Caches);
+
+	// Sets the distance and the bearing of a cache from a distance in meters and an azimuth in degrees
+	void	SetDistanceBearing(CGeoCache* pCache, double Meters, double Azimuth, GcDistance State);
+
 	// Upon loading a GPX file, remove the travel bugs from caches according to their location.
 	void	SynchronizeTravelBugs();
 
@@ -195,6 +220,12 @@ protected:
 	afx_msg void OnToolsFieldnotescleaner();
 	afx_msg void OnMenuExport();
 	//}}AFX_MSG
+	afx_msg LRESULT OnFullTextIndexReady(WPARAM wParam, LPARAM lParam);
+	afx_msg LRESULT OnSearchChanged(WPARAM wParam, LPARAM lParam);
+#ifdef _DEBUG
+	afx_msg void OnDebugFilterBenchmark();
+	afx_msg void OnDebugSelfChecks();
+#endif
 	DECLARE_MESSAGE_MAP()
 
 	void	OnContextMenu(CWnd* pWnd, CPoint point) ;
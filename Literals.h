@@ -47,5 +47,6 @@
 #define EXPORT_LOCATION					_T("\\Export\\")
 #define FIELD_NOTES_REPORT_TEMPLATE		_T("\\Docs\\FieldNotesReportTpl.htm")
 #define TEXT_STORE						_T("\\Docs\\TextStore.dat")
+#define FULL_TEXT_INDEX					_T("\\Docs\\FullTextIndex.dat")
 
 #endif
@@ -58,6 +58,8 @@
 #define IDD_EXPORT_PREFS                168
 #define IDI_PLAY                        171
 #define IDI_RECORD                      172
+#define IDD_FILTER_CORRIDOR             174
+#define IDD_FILTER_EXPRESSION           175
 #define IDC_HIDE_DISABLED               1000
 #define IDC_CACHE_LIST                  1001
 #define IDC_CACHELIST                   1002
@@ -124,6 +126,7 @@
 #define IDC_MATCH2                      1030
 #define IDC_NO_IMG_TAGS                 1030
 #define IDC_SAVE                        1031
+#define IDC_MATCH3                      1031
 #define IDC_EXPORT_OPTIONS              1031
 #define IDC_DELETE                      1032
 #define IDC_EXPORT                      1032
@@ -132,6 +135,7 @@
 #define IDC_CACHE_TB_LIST               1034
 #define IDC_MemUsage                    1034
 #define IDC_GO                          1034
+#define IDC_ROUTE_ORDER                 1035
 #define IDC_MY_TB_LIST                  1035
 #define IDC_PROJECT                     1035
 #define IDC_RADIO2                      1035
@@ -211,6 +215,8 @@
 #define ID_TOOLS_EXPORT_WAYPOINTS_TOEXPLORISTSDFILE 32812
 #define ID_TOOLS_EXPORT_WAYPOINTS_TOOZIEXPLORERFILE 32813
 #define ID_MENU_EXPORT                  32815
+#define ID_DEBUG_FILTERBENCHMARK        32816
+#define ID_DEBUG_SELFCHECKS             32817
 #define IDS_NEW                         65000
 #define IDS_FILE                        65001
 #define IDS_MHELP                       65002
@@ -223,9 +229,9 @@
 // 
 #ifdef APSTUDIO_INVOKED
 #ifndef APSTUDIO_READONLY_SYMBOLS
-#define _APS_NEXT_RESOURCE_VALUE        174
-#define _APS_NEXT_COMMAND_VALUE         32816
-#define _APS_NEXT_CONTROL_VALUE         1035
+#define _APS_NEXT_RESOURCE_VALUE        176
+#define _APS_NEXT_COMMAND_VALUE         32818
+#define _APS_NEXT_CONTROL_VALUE         1036
 #define _APS_NEXT_SYMED_VALUE           101
 #endif
 #endif
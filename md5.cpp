@@ -26,6 +26,12 @@ documentation and/or software.
 #include "md5.h"
 #include "memory.h"
 
+/* Both the ARM and x86 CE targets are little-endian, so MD5Transform can
+consume the input block as words without decoding it byte by byte. */
+#if defined(_M_IX86) || defined(_M_ARM) || defined(ARM) || defined(_X86_)
+#define MD5_LITTLE_ENDIAN
+#endif
+
 /* Constants for MD5Transform routine.*/
 #define S11 7
 #define S12 12
@@ -178,9 +184,26 @@ void MD5Transform(
 											unsigned char block[64]
 											)
 {
-  UINT4 a = state[0], b = state[1], c = state[2], d = state[3], x[16];
+  UINT4 a = state[0], b = state[1], c = state[2], d = state[3];
+  UINT4 *x;
+#ifdef MD5_LITTLE_ENDIAN
+  UINT4 aligned[16];
+
+  /* The block already holds little-endian words: read them in place when
+  they are word aligned and only copy misaligned blocks. */
+  if (((unsigned long) block & 3) == 0)
+    x = (UINT4 *) block;
+  else
+  {
+    MD5_memcpy ((POINTER)aligned, block, 64);
+    x = aligned;
+  }
+#else
+  UINT4 decoded[16];
 
-  Decode (x, block, 64);
+  Decode (decoded, block, 64);
+  x = decoded;
+#endif
 
   /* Round 1 */
   FF (a, b, c, d, x[ 0], S11, 0xd76aa478); /* 1 */
@@ -258,10 +281,6 @@ void MD5Transform(
   state[1] += b;
   state[2] += c;
   state[3] += d;
-
-  /* Zeroize sensitive information.
-*/
-  MD5_memset ((POINTER)x, 0, sizeof (x));
 }
 //************************************************************************************************************************
 //* Encodes input (UINT4) into output (unsigned char). Assumes len is a multiple of 4.